@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# benchmarkSweep.sh
+#
+# Sweep the frames-in-flight, minimum swap chain image count and present mode of the triangle program,
+# and record the throughput and input latency of each combination as CSV.
+#
+# Usage: ./benchmarkSweep.sh <PATH_TO_TRIANGLE> [FRAMES] [OUTPUT_CSV]
+
+set -euo pipefail
+
+if [ $# -lt 1 ]
+then
+    echo "Usage: $0 <PATH_TO_TRIANGLE> [FRAMES] [OUTPUT_CSV]"
+    exit 1
+fi
+
+TRIANGLE=$1
+FRAMES=${2:-1000}
+OUTPUT=${3:-benchmarkSweep.csv}
+
+echo "frames_in_flight,min_image_count,present_mode,fps,latency_p50_ms,latency_p95_ms,latency_p99_ms" > $OUTPUT
+
+for PRESENT_MODE in fifo fifo-relaxed mailbox immediate
+do
+    for MIN_IMAGE_COUNT in 2 3 4
+    do
+        for FRAMES_IN_FLIGHT in 1 2 3 4
+        do
+            LOG=$(TRIANGLE_FRAMES_IN_FLIGHT=$FRAMES_IN_FLIGHT \
+                  TRIANGLE_MIN_IMAGE_COUNT=$MIN_IMAGE_COUNT \
+                  TRIANGLE_PRESENT_MODE=$PRESENT_MODE \
+                  $TRIANGLE --frames $FRAMES --no-pipeline-cache 2>&1) || {
+                echo "Failed: $PRESENT_MODE, $MIN_IMAGE_COUNT images, $FRAMES_IN_FLIGHT frames in flight"
+                continue
+            }
+
+            FPS=$(echo "$LOG" | sed -n 's/.*(\([0-9.]*\) frames per second).*/\1/p' | tail -n 1)
+            LATENCY=$(echo "$LOG" | awk '/^Input latency/ { print $4 "," $5 "," $6 }' | tail -n 1)
+            echo "$FRAMES_IN_FLIGHT,$MIN_IMAGE_COUNT,$PRESENT_MODE,$FPS,$LATENCY" | tee -a $OUTPUT
+        done
+    done
+done
@@ -1,5 +1,29 @@
+# Compile a GLSL shader of a TARGET program into SPIR-V.  The shader stage is deduced by glslc from the file
+# extension of SHADER: .vert, .tesc, .tese, .geom, .frag, or .comp.
+#
+# Options:
+#   EMBED
+#       Embed the SPIR-V into TARGET, as a generated C++ source file defining an aligned array of its words, rather
+#       than installing the .spv file.  The shader is then found by vkbase::FindEmbeddedShader, under the file name
+#       of the .spv file.  Every shader is embedded if EMBED_SHADERS is ON.
 function(vulkan_shader TARGET SHADER)
 
+    set(options
+        EMBED
+    )
+    cmake_parse_arguments(
+        args
+        "${options}"
+        ""
+        ""
+        ${ARGN}
+    )
+
+    get_filename_component(SHADER_STAGE ${SHADER} LAST_EXT)
+    if (NOT SHADER_STAGE MATCHES "^\\.(vert|tesc|tese|geom|frag|comp)$")
+        message(FATAL_ERROR "Unknown shader stage of ${SHADER}.")
+    endif()
+
 	# All shaders for a sample are found here.
     set(SHADER_OUTPUT_PATH ${CMAKE_BINARY_DIR}/shaders/${SHADER}.spv)
 
@@ -17,6 +41,24 @@ function(vulkan_shader TARGET SHADER)
 	set_source_files_properties(${SHADER_OUTPUT_PATH} PROPERTIES GENERATED TRUE)
 	target_sources(${TARGET} PRIVATE ${SHADER_OUTPUT_PATH})
 
+    # Generate, and compile into the target, a source file holding the SPIR-V words.
+    if (args_EMBED OR EMBED_SHADERS)
+        set(EMBED_OUTPUT_PATH ${CMAKE_BINARY_DIR}/shaders/embedded/${SHADER}.spv.cpp)
+        get_filename_component(EMBED_OUTPUT_DIR ${EMBED_OUTPUT_PATH} DIRECTORY)
+        file(MAKE_DIRECTORY ${EMBED_OUTPUT_DIR})
+        add_custom_command(
+            OUTPUT ${EMBED_OUTPUT_PATH}
+            COMMAND ${CMAKE_COMMAND}
+                -DSPIRV_PATH=${SHADER_OUTPUT_PATH}
+                -DOUTPUT_PATH=${EMBED_OUTPUT_PATH}
+                -P ${CMAKE_SOURCE_DIR}/cmake/scripts/EmbedSpirv.cmake
+            DEPENDS ${SHADER_OUTPUT_PATH} ${CMAKE_SOURCE_DIR}/cmake/scripts/EmbedSpirv.cmake
+            VERBATIM)
+        set_source_files_properties(${EMBED_OUTPUT_PATH} PROPERTIES GENERATED TRUE)
+        target_sources(${TARGET} PRIVATE ${EMBED_OUTPUT_PATH})
+        return()
+    endif()
+
     install(
         FILES
             ${SHADER_OUTPUT_PATH}
@@ -0,0 +1,50 @@
+# Generate a C++ source file embedding the SPIR-V words of a compiled shader, and registering them with
+# vkbase::GetEmbeddedShaders under the file name of the shader.
+#
+# Run as a script, with the variables:
+#   SPIRV_PATH
+#       Path to the compiled .spv file.
+#   OUTPUT_PATH
+#       Path of the C++ source file to generate.
+
+get_filename_component(SHADER_NAME ${SPIRV_PATH} NAME)
+string(MAKE_C_IDENTIFIER ${SHADER_NAME} SHADER_IDENTIFIER)
+
+file(READ ${SPIRV_PATH} SPIRV_HEX HEX)
+string(LENGTH "${SPIRV_HEX}" SPIRV_HEX_LENGTH)
+math(EXPR SPIRV_HEX_REMAINDER "${SPIRV_HEX_LENGTH} % 8")
+if (SPIRV_HEX_LENGTH EQUAL 0 OR NOT SPIRV_HEX_REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${SPIRV_PATH} is not a whole number of 32-bit words.")
+endif()
+
+# SPIR-V produced by glslc is little-endian: reverse the bytes of each word into a literal, 8 words per line.
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " SPIRV_WORDS "${SPIRV_HEX}")
+string(REPEAT "0x[0-9a-f]+u, " 8 SPIRV_LINE_PATTERN)
+string(REGEX REPLACE "(${SPIRV_LINE_PATTERN})" "\\1\n    " SPIRV_WORDS "${SPIRV_WORDS}")
+string(REPLACE " \n" "\n" SPIRV_WORDS "${SPIRV_WORDS}")
+string(STRIP "${SPIRV_WORDS}" SPIRV_WORDS)
+
+file(WRITE ${OUTPUT_PATH}.tmp
+"// Generated from ${SHADER_NAME} by cmake/scripts/EmbedSpirv.cmake.  Do not edit.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <vkbase/embeddedShaders.h>
+
+namespace
+{
+alignas( 4 ) constexpr uint32_t s_${SHADER_IDENTIFIER}[] = {
+    ${SPIRV_WORDS}
+};
+
+const vkbase::EmbeddedShaderRegistration
+    s_${SHADER_IDENTIFIER}Registration( \"${SHADER_NAME}\", s_${SHADER_IDENTIFIER}, sizeof( s_${SHADER_IDENTIFIER} ) );
+} // namespace
+")
+
+# Only touch the output if it changed, so an unchanged shader does not trigger a re-compile.
+configure_file(${OUTPUT_PATH}.tmp ${OUTPUT_PATH} COPYONLY)
+file(REMOVE ${OUTPUT_PATH}.tmp)
@@ -0,0 +1,35 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+// The fragment shader of shader.frag, modulated by the texture of the instance, sampled out of the array of
+// textures of the bindless descriptor set.
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragTextureSlot;
+
+layout(location = 0) out vec4 outColor;
+
+// Iterations of artificial work per fragment, for making shading expensive.  Specialized at pipeline creation, so
+// the loop is unrolled, or removed entirely, by the driver's compiler.
+layout(constant_id = 0) const uint c_shadingIterations = 0;
+
+// Slot of instances without a resident texture.  Their slot in the array may hold a stale descriptor, or none.
+const uint c_noTextureSlot = 0xffffffffu;
+
+layout(set = 0, binding = 1) uniform sampler2D textures[];
+
+void main() {
+    vec3 color = fragColor;
+    for (uint iteration = 0; iteration < c_shadingIterations; ++iteration) {
+        color = clamp(color + 1e-7 * sin(gl_FragCoord.xyx * float(iteration + 1)), 0.0, 1.0);
+    }
+
+    // The slot varies between the instances of a draw, so indexing with it must be marked non-uniform.
+    if (fragTextureSlot != c_noTextureSlot) {
+        color *= texture(textures[nonuniformEXT(fragTextureSlot)], fragTexCoord).rgb;
+    }
+
+    outColor = vec4(color, 1.0);
+}
@@ -0,0 +1,56 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+// The vertex shader of shader.vert, reading its instance, and the slot of the texture it samples, out of the
+// array of buffers of the bindless descriptor set.
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTextureSlot;
+
+// Per-draw parameters.
+layout(push_constant) uniform DrawParameters {
+    float meshScale;
+    uint instanceOffset;
+} drawParameters;
+
+struct Instance {
+    vec2 offset;
+    float scale;
+    float rotation;
+    vec3 color;
+    float depth;
+};
+
+// Slots of the buffers, in the array of buffers.
+const uint c_instanceBufferSlot = 0;
+const uint c_textureSlotBufferSlot = 1;
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+    Instance instances[];
+} instanceBuffers[];
+
+layout(std430, set = 0, binding = 0) readonly buffer TextureSlots {
+    uint textureSlots[];
+} textureSlotBuffers[];
+
+void main() {
+    uint instanceIndex = drawParameters.instanceOffset + gl_InstanceIndex;
+    Instance instance = instanceBuffers[c_instanceBufferSlot].instances[instanceIndex];
+
+    vec2 position = inPosition * drawParameters.meshScale * instance.scale;
+    float c = cos(instance.rotation);
+    float s = sin(instance.rotation);
+    position = vec2(c * position.x - s * position.y, s * position.x + c * position.y);
+
+    gl_Position = vec4(position + instance.offset, instance.depth, 1.0);
+    fragColor = inColor * instance.color;
+
+    // The mesh spans [-0.5, 0.5] on both axes.
+    fragTexCoord = inPosition + 0.5;
+    fragTextureSlot = textureSlotBuffers[c_textureSlotBufferSlot].textureSlots[instanceIndex];
+}
@@ -2,731 +2,4242 @@
 #include <GLFW/glfw3.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
+#include <deque>
+#include <dirent.h>
+#include <exception>
+#include <fcntl.h>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <optional>
 #include <set>
 #include <stdexcept>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include <vkbase/deletionQueue.h>
+#include <vkbase/embeddedShaders.h>
 #include <vkbase/fileSystem.h>
+#include <vkbase/jobSystem.h>
+#include <vkbase/memoryAllocator.h>
+#include <vkbase/buffer.h>
+#include <vkbase/frameGraph.h>
+#include <vkbase/pipelineCache.h>
+#include <vkbase/profiler.h>
+#include <vkbase/queue.h>
+#include <vkbase/shaderRegistry.h>
+#include <vkbase/shaderWatcher.h>
+#include <vkbase/descriptors.h>
+#include <vkbase/pipelinePermutations.h>
+#include <vkbase/specialization.h>
 #include <vkbase/support.h>
+#include <vkbase/texture.h>
+#include <vkbase/timelineSemaphore.h>
 
-static constexpr int s_maxFramesInFlight = 2;
+// Bounds, and default, of the number of frames which can be in flight at once.
+static constexpr uint32_t s_minFramesInFlight     = 1;
+static constexpr uint32_t s_maxFramesInFlight     = 4;
+static constexpr uint32_t s_defaultFramesInFlight = 2;
 
-/// \class TriangleApplication
+// Capacity of the staging ring, through which vertex and index data is uploaded.
+static constexpr VkDeviceSize s_stagingRingCapacity = 16 * 1024 * 1024;
+
+// Capacity of the staging ring of the texture streamer, shared by its batches of uploads in flight.
+static constexpr VkDeviceSize s_textureStagingRingCapacity = 8 * 1024 * 1024;
+
+// Number of frames between each step of the window of textures requested by the frames.
+static constexpr uint64_t s_textureScrollFrames = 8;
+
+// Number of descriptor sets allocated from each descriptor pool of a frame in flight, before the frame is given
+// another pool.
+static constexpr uint32_t s_descriptorSetsPerPool = 16;
+
+// Slots of the arrays of the bindless descriptor set, further bounded by the limits of the device.
+static constexpr uint32_t s_bindlessBufferCapacity  = 1024;
+static constexpr uint32_t s_bindlessTextureCapacity = 16384;
+
+// Bindless buffer slots of the instance buffer, and of the texture slot of each instance, read by bindless.vert.
+static constexpr uint32_t s_instanceBufferSlot    = 0;
+static constexpr uint32_t s_textureSlotBufferSlot = 1;
+
+// Texture slot of the instances without a resident texture, which bindless.frag does not sample.
+static constexpr uint32_t s_noTextureSlot = UINT32_MAX;
+
+// Default workgroup size of cull.comp.
+static constexpr uint32_t s_defaultCullWorkgroupSize = 64;
+
+// Upper bound of threads recording command buffers.
+static constexpr uint32_t s_maxRecordThreads = 64;
+
+// Number of recording jobs per recording thread, for balancing the load across threads.
+static constexpr uint32_t s_recordJobsPerThread = 4;
+
+// Number of frames drawn in headless mode, or by the frame loop benchmark, if not specified.
+static constexpr uint64_t s_defaultHeadlessFrameCount  = 100;
+static constexpr uint64_t s_defaultBenchmarkFrameCount = 1000;
+
+/// Phases of a frame, measured by the profiler.
+enum ProfilePhase : uint32_t
+{
+    ProfilePhase_Frame = 0,         // All of DrawFrame, on the CPU.
+    ProfilePhase_FenceWait,         // Waiting for the frame in flight to complete.
+    ProfilePhase_Acquire,           // Acquiring the next swap chain image.
+    ProfilePhase_Record,            // Resetting the frame's command pool, and recording its command buffer.
+    ProfilePhase_UpdateInstances,   // Writing the frame's instance data.
+    ProfilePhase_StreamTextures,    // Requesting the frame's textures, and submitting uploads and evictions.
+    ProfilePhase_UpdateDescriptors, // Allocating and writing the frame's descriptor sets.
+    ProfilePhase_Submit,            // Submitting the command buffer.
+    ProfilePhase_Present,           // Queueing the image for presentation.
+    ProfilePhase_GpuRenderPass,     // Execution of the render pass, on the GPU.
+    ProfilePhase_InputLatency,      // From polling input, to the CPU observing completion of the frame drawn with it.
+};
+
+/// Policy for selecting the present mode of the swap chain.
+enum PresentModePolicy : uint32_t
+{
+    PresentModePolicy_Default = 0, // MAILBOX if available, otherwise FIFO.
+    PresentModePolicy_Fifo,
+    PresentModePolicy_FifoRelaxed,
+    PresentModePolicy_Mailbox,
+    PresentModePolicy_Immediate,
+};
+
+/// Parse the present mode policy named \p i_name.
+static PresentModePolicy ParsePresentModePolicy( const std::string& i_name )
+{
+    if ( i_name == "default" )
+    {
+        return PresentModePolicy_Default;
+    }
+    else if ( i_name == "fifo" )
+    {
+        return PresentModePolicy_Fifo;
+    }
+    else if ( i_name == "fifo-relaxed" )
+    {
+        return PresentModePolicy_FifoRelaxed;
+    }
+    else if ( i_name == "mailbox" )
+    {
+        return PresentModePolicy_Mailbox;
+    }
+    else if ( i_name == "immediate" )
+    {
+        return PresentModePolicy_Immediate;
+    }
+
+    throw std::runtime_error( "Unknown present mode " + i_name );
+}
+
+/// How frame completion is tracked, between the CPU and GPU.
+enum SyncMode : uint32_t
+{
+    SyncMode_Default = 0, // Timeline semaphores if supported, otherwise fences.
+    SyncMode_Timeline,    // A timeline semaphore, signaled with the number of each frame.
+    SyncMode_Fences,      // A fence per frame in flight.
+};
+
+/// Parse a synchronization mode from its command line name.
+static SyncMode ParseSyncMode( const std::string& i_name )
+{
+    if ( i_name == "default" )
+    {
+        return SyncMode_Default;
+    }
+    else if ( i_name == "timeline" )
+    {
+        return SyncMode_Timeline;
+    }
+    else if ( i_name == "fences" )
+    {
+        return SyncMode_Fences;
+    }
+
+    throw std::runtime_error( "Unknown synchronization mode " + i_name );
+}
+
+/// Command line names of the depth formats, in order of preference.
+static const std::pair< const char*, VkFormat > s_depthFormats[] = {
+    {"d32", VK_FORMAT_D32_SFLOAT},
+    {"d32s8", VK_FORMAT_D32_SFLOAT_S8_UINT},
+    {"d24s8", VK_FORMAT_D24_UNORM_S8_UINT},
+    {"d16", VK_FORMAT_D16_UNORM},
+};
+
+/// Parse a depth format from its command line name.  "auto" is parsed as VK_FORMAT_UNDEFINED.
+static VkFormat ParseDepthFormat( const std::string& i_name )
+{
+    if ( i_name == "auto" )
+    {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    for ( const std::pair< const char*, VkFormat >& depthFormat : s_depthFormats )
+    {
+        if ( i_name == depthFormat.first )
+        {
+            return depthFormat.second;
+        }
+    }
+
+    throw std::runtime_error( "Unknown depth format " + i_name );
+}
+
+/// The command line name of \p i_format.
+static const char* GetDepthFormatName( VkFormat i_format )
+{
+    for ( const std::pair< const char*, VkFormat >& depthFormat : s_depthFormats )
+    {
+        if ( i_format == depthFormat.second )
+        {
+            return depthFormat.first;
+        }
+    }
+
+    return "unknown";
+}
+
+/// Order in which the instances are drawn.
+enum DrawOrder : uint32_t
+{
+    DrawOrder_None = 0,     // The order of the grid, row by row.
+    DrawOrder_FrontToBack,  // Nearest first, so occluded fragments fail the depth test before being shaded.
+    DrawOrder_BackToFront,  // Farthest first, the worst case for early depth testing.
+};
+
+/// Parse a draw order from its command line name.
+static DrawOrder ParseDrawOrder( const std::string& i_name )
+{
+    if ( i_name == "none" )
+    {
+        return DrawOrder_None;
+    }
+    else if ( i_name == "front-to-back" )
+    {
+        return DrawOrder_FrontToBack;
+    }
+    else if ( i_name == "back-to-front" )
+    {
+        return DrawOrder_BackToFront;
+    }
+
+    throw std::runtime_error( "Unknown draw order " + i_name );
+}
+
+/// \struct Vertex
 ///
-/// A simple app which draws a triangle using the Vulkan API, in a window.
-class TriangleApplication
+/// Interleaved vertex attributes, as consumed by shader.vert.
+struct Vertex
 {
-public:
-    explicit TriangleApplication( const std::string& i_executablePath )
-        : m_executablePath( i_executablePath )
+    float m_position[ 2 ];
+    float m_color[ 3 ];
+
+    /// Describe the layout of a vertex in the vertex buffer.
+    static VkVertexInputBindingDescription GetBindingDescription()
+    {
+        VkVertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding                         = 0;
+        bindingDescription.stride                          = sizeof( Vertex );
+        bindingDescription.inputRate                       = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescription;
+    }
+
+    /// Describe each attribute of the vertex, by its shader location.
+    static std::array< VkVertexInputAttributeDescription, 2 > GetAttributeDescriptions()
+    {
+        std::array< VkVertexInputAttributeDescription, 2 > attributeDescriptions = {};
+        attributeDescriptions[ 0 ].binding                                       = 0;
+        attributeDescriptions[ 0 ].location                                      = 0;
+        attributeDescriptions[ 0 ].format                                        = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[ 0 ].offset                                        = offsetof( Vertex, m_position );
+        attributeDescriptions[ 1 ].binding                                       = 0;
+        attributeDescriptions[ 1 ].location                                      = 1;
+        attributeDescriptions[ 1 ].format                                        = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[ 1 ].offset                                        = offsetof( Vertex, m_color );
+        return attributeDescriptions;
+    }
+};
+
+/// \struct InstanceData
+///
+/// Per-instance attributes, laid out as the std430 Instance struct of shader.vert.
+struct InstanceData
+{
+    float m_offset[ 2 ]; // Translation, in normalized device coordinates.
+    float m_scale;       // Uniform scale of the mesh.
+    float m_rotation;    // Rotation of the mesh, in radians.
+    float m_color[ 3 ];  // Multiplied with the vertex colors.
+    float m_depth;       // Depth of the mesh, in normalized device coordinates.
+};
+
+/// \struct DrawParameters
+///
+/// Push constants of each draw, laid out as the DrawParameters block of shader.vert.
+struct DrawParameters
+{
+    float    m_meshScale;      // Scale of the mesh, shared by all instances.
+    uint32_t m_instanceOffset; // Index of the first instance of this frame, in the instance buffer.
+};
+
+/// \struct CullParameters
+///
+/// Push constants of the culling compute shader, laid out as the CullParameters block of cull.comp.
+struct CullParameters
+{
+    float    m_frustumPlanes[ 4 ][ 4 ]; // (normal.x, normal.y, unused, distance) of each plane bounding the view.
+    float    m_meshRadius;              // Radius of the bounding circle of the mesh.
+    uint32_t m_objectCount;             // Number of objects to cull.
+    uint32_t m_instanceOffset;          // Index of the frame's first object, in the instance buffer.
+    uint32_t m_commandOffset;           // Index of the frame's first command, in the draw command buffer.
+    uint32_t m_countIndex;              // Index of the frame's draw count, in the draw count buffer.
+    uint32_t m_indexCount;              // Number of indices of the mesh.
+};
+
+/// Specialization constants of cull.comp.
+enum CullConstant : size_t
+{
+    CullConstant_WorkgroupSize = 0, // Number of objects culled per workgroup.
+    CullConstant_Compact,           // Write visible commands contiguously, and count them.
+};
+
+using CullSpecialization = vkbase::Specialization< vkbase::SpecializationConstant< 0, uint32_t >,
+                                                   vkbase::SpecializationConstant< 1, VkBool32 > >;
+
+/// Specialization constants of shader.frag.
+enum FragmentConstant : size_t
+{
+    FragmentConstant_ShadingIterations = 0, // Iterations of artificial shading work per fragment.
+};
+
+using FragmentSpecialization = vkbase::Specialization< vkbase::SpecializationConstant< 0, uint32_t > >;
+
+// Number of combinations of topology, culling and blending the permutations of the graphics pipeline cycle through.
+static constexpr uint32_t s_pipelineVariantStateCount = 2 * 3 * 2;
+
+/// Set the topology, culling and blending of the \p i_variantIndex'th permutation of the graphics pipeline: a
+/// triangle list if the index is even, otherwise a strip; back, no, then front face culling for each pair of
+/// indices; and blending for the second half of every s_pipelineVariantStateCount indices.
+static void SetPipelineVariantState( uint32_t i_variantIndex, vkbase::PipelineVariant& o_variant )
+{
+    const VkPrimitiveTopology topologies[] = {VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+                                              VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP};
+    const VkCullModeFlags     cullModes[]  = {VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_NONE, VK_CULL_MODE_FRONT_BIT};
+
+    o_variant.m_topology    = topologies[ i_variantIndex % 2 ];
+    o_variant.m_cullMode    = cullModes[ i_variantIndex / 2 % 3 ];
+    o_variant.m_blendEnable = i_variantIndex / 6 % 2 == 1;
+}
+
+/// Can the \p i_variantIndex'th permutation of the graphics pipeline draw the scene?  The index buffer holds a
+/// triangle list, and front faces are culled by the front face culling variants, so only triangle list variants
+/// culling back faces, or none, draw it as the default pipeline does.
+static bool IsDrawablePipelineVariant( uint32_t i_variantIndex )
+{
+    vkbase::PipelineVariant variant;
+    SetPipelineVariantState( i_variantIndex, variant );
+    return variant.m_topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST && variant.m_cullMode != VK_CULL_MODE_FRONT_BIT;
+}
+
+/// Generate the geometry of \p i_triangleCount triangles.  A single triangle covers the center of the
+/// viewport, whereas multiple triangles are laid out in a grid across it.
+static void
+GenerateTriangles( uint32_t i_triangleCount, std::vector< Vertex >& o_vertices, std::vector< uint32_t >& o_indices )
+{
+    o_vertices.clear();
+    o_indices.clear();
+    o_vertices.reserve( 3 * i_triangleCount );
+    o_indices.reserve( 3 * i_triangleCount );
+
+    if ( i_triangleCount == 1 )
+    {
+        o_vertices = {{{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+                      {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+                      {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}};
+        o_indices  = {0, 1, 2};
+        return;
+    }
+
+    uint32_t columns  = static_cast< uint32_t >( std::ceil( std::sqrt( static_cast< double >( i_triangleCount ) ) ) );
+    uint32_t rows     = ( i_triangleCount + columns - 1 ) / columns;
+    float    cellSize = 2.0f / columns;
+    float    rowSize  = 2.0f / rows;
+    for ( uint32_t triangleIndex = 0; triangleIndex < i_triangleCount; ++triangleIndex )
+    {
+        float x = -1.0f + ( triangleIndex % columns ) * cellSize;
+        float y = -1.0f + ( triangleIndex / columns ) * rowSize;
+        float u = static_cast< float >( triangleIndex % columns ) / columns;
+        float v = static_cast< float >( triangleIndex / columns ) / rows;
+
+        uint32_t baseIndex = static_cast< uint32_t >( o_vertices.size() );
+        o_vertices.push_back( {{x + 0.5f * cellSize, y}, {1.0f, u, v}} );
+        o_vertices.push_back( {{x + cellSize, y + rowSize}, {u, 1.0f, v}} );
+        o_vertices.push_back( {{x, y + rowSize}, {u, v, 1.0f}} );
+        o_indices.push_back( baseIndex );
+        o_indices.push_back( baseIndex + 1 );
+        o_indices.push_back( baseIndex + 2 );
+    }
+}
+
+/// Generate texture \p i_textureIndex, of \p i_size by \p i_size texels, into \p o_image: a checkerboard tinted with a
+/// color of its own, so that the textures are told apart.
+static void GenerateTexture( uint32_t i_textureIndex, uint32_t i_size, vkbase::DecodedImage& o_image )
+{
+    const uint32_t hash      = i_textureIndex * 2654435761u;
+    const uint8_t  tint[ 3 ] = {static_cast< uint8_t >( 64 + ( hash >> 24 ) % 192 ),
+                               static_cast< uint8_t >( 64 + ( hash >> 16 ) % 192 ),
+                               static_cast< uint8_t >( 64 + ( hash >> 8 ) % 192 )};
+
+    o_image.m_width  = i_size;
+    o_image.m_height = i_size;
+    o_image.m_texels.resize( static_cast< size_t >( i_size ) * i_size * 4 );
+
+    const uint32_t cellSize = std::max( i_size / 8, 1u );
+    for ( uint32_t y = 0; y < i_size; ++y )
+    {
+        for ( uint32_t x = 0; x < i_size; ++x )
+        {
+            const bool dark  = ( ( x / cellSize ) + ( y / cellSize ) ) % 2 != 0;
+            uint8_t*   texel = o_image.m_texels.data() + ( static_cast< size_t >( y ) * i_size + x ) * 4;
+            for ( uint32_t channel = 0; channel < 3; ++channel )
+            {
+                texel[ channel ] = dark ? tint[ channel ] / 2 : tint[ channel ];
+            }
+
+            texel[ 3 ] = 255;
+        }
+    }
+}
+
+/// Depth of instance \p i_instanceIndex, scattered pseudo-randomly across [0, 1) so that the order of the grid
+/// says nothing about which instances are in front.
+static float GetInstanceDepth( uint32_t i_instanceIndex )
+{
+    // Knuth's multiplicative hash.  The top 24 bits are exactly representable as a float.
+    return static_cast< float >( ( i_instanceIndex * 2654435761u ) >> 8 ) / 16777216.0f;
+}
+
+/// \struct ApplicationOptions
+///
+/// Runtime options of the TriangleApplication, parsed from the command line.
+struct ApplicationOptions
+{
+    // Render into offscreen images, without a window, surface, or swap chain.
+    bool m_headless = false;
+
+    // Number of frames to draw before exiting.  0 means run until the window is closed.
+    uint64_t m_frameCount = 0;
+
+    // Path to write the last rendered frame to, as a PPM image (headless only).
+    std::string m_outputPath;
+
+    // Fail if the swap chain is recreated, while the window is not resized.
+    bool m_frameLoopBenchmark = false;
+
+    // Index of the physical device to use, or a case-insensitive substring of its name.  Empty selects the
+    // highest scoring suitable device.
+    std::string m_deviceSelector;
+
+    // Print the physical devices, and why each was selected or rejected, then exit.
+    bool m_listDevices = false;
+
+    // Number of frames which can be recorded by the CPU while previous frames are executing on the GPU.
+    uint32_t m_framesInFlight = s_defaultFramesInFlight;
+
+    // Minimum number of images requested for the swap chain.  0 requests one more than the surface minimum.
+    uint32_t m_minImageCount = 0;
+
+    // Present mode of the swap chain.
+    PresentModePolicy m_presentMode = PresentModePolicy_Default;
+
+    // How frame completion is tracked.
+    SyncMode m_syncMode = SyncMode_Default;
+
+    // Number of triangles to upload and draw.
+    uint32_t m_triangleCount = 1;
+
+    // Number of draw calls the triangles are split into, recorded every frame.
+    uint32_t m_drawsPerFrame = 1;
+
+    // Number of instances of the mesh drawn by each draw call.
+    uint32_t m_instanceCount = 1;
+
+    // Size of the grid of instances, relative to the view.  Instances outside of the view are culled when GPU
+    // culling is enabled.
+    float m_sceneScale = 1.0f;
+
+    // Size of each instance, relative to its cell of the grid.  Instances overlap when greater than 1.
+    float m_instanceScale = 1.0f;
+
+    // Order the instances are drawn in, by depth.
+    DrawOrder m_drawOrder = DrawOrder_None;
+
+    // Depth test against a depth buffer, of m_depthFormat.
+    bool m_depthTest = true;
+
+    // Format of the depth buffer.  VK_FORMAT_UNDEFINED selects the most precise format supported.
+    VkFormat m_depthFormat = VK_FORMAT_UNDEFINED;
+
+    // Number of samples per pixel, resolved at the end of the scene pass.  Clamped to the sample counts
+    // supported by the device.
+    uint32_t m_sampleCount = 1;
+
+    // Length of a chain of post-processing passes compiled at startup, in a frame graph of its own, to report the
+    // transient memory saved by aliasing.  0 disables the report.
+    uint32_t m_frameGraphChainLength = 0;
+
+    // Cull instances against the view frustum in a compute shader, and draw the visible ones indirectly.
+    bool m_gpuCulling = false;
+
+    // Workgroup size of the culling compute shader, clamped to the device's limits.
+    uint32_t m_cullWorkgroupSize = s_defaultCullWorkgroupSize;
+
+    // Iterations of artificial work in the fragment shader, for making shading expensive.
+    uint32_t m_shadingIterations = 0;
+
+    // Submit all work to the graphics queue, even if the device has dedicated compute and transfer queue
+    // families.
+    bool m_singleQueue = false;
+
+    // Number of threads recording the draw calls into secondary command buffers.  0 records them inline into
+    // the primary command buffer, on the main thread.
+    uint32_t m_recordThreads = 0;
+
+    // Number of permutations of the graphics pipeline to build at startup, in parallel, on top of the one
+    // drawn with, and the number of threads building them.  0 threads uses one per core.
+    uint32_t m_pipelineVariantCount = 0;
+    uint32_t m_pipelineBuildThreads = 0;
+
+    // Index of the permutation built with --pipeline-variants to draw with, looked up among the built
+    // permutations, instead of the default pipeline.
+    std::optional< uint32_t > m_drawVariant;
+
+    // Print a summary of frame timings every N frames.  0 only prints the summary on exit.
+    uint64_t m_profileInterval = 0;
+
+    // Path to write a Chrome trace of the frame timings to, on exit.
+    std::string m_tracePath;
+
+    // Load and save the persistent pipeline cache.
+    bool m_usePipelineCache = true;
+
+    // Path to the persistent pipeline cache.  Empty uses a file per device in the user's cache directory.
+    std::string m_pipelineCachePath;
+
+    // Directory of the GLSL sources to watch, recompiling them and swapping in a new graphics pipeline when they
+    // change.  Empty disables watching.
+    std::string m_watchShadersDirectory;
+
+    // GLSL compiler used when watching shaders.
+    std::string m_glslcPath = "glslc";
+
+    // Number of textures to stream, of which each frame requests a sliding window, one per instance.  0 disables
+    // texture streaming.
+    uint32_t m_textureCount = 0;
+
+    // Size of the generated textures, in texels along each side.
+    uint32_t m_textureSize = 512;
+
+    // Directory of binary PPM images to decode the textures from, instead of generating them.
+    std::string m_textureDirectory;
+
+    // Memory budget of the resident textures, in MiB.
+    uint32_t m_textureBudget = 64;
+
+    // Index all buffers and textures out of a single descriptor set per frame in flight, with
+    // VK_EXT_descriptor_indexing, so that streamed textures are sampled.
+    bool m_bindless = false;
+};
+
+/// Print the command line usage of this program.
+static void PrintUsage( const char* i_programName )
+{
+    printf( "Usage: %s [OPTIONS]\n"
+            "\n"
+            "Options:\n"
+            "  --headless         Render into offscreen images, without a window or swap chain.\n"
+            "  --frames <N>       Number of frames to draw before exiting.\n"
+            "  --output <PATH>    Write the last rendered frame to PATH as a PPM image (headless only).\n"
+            "  --frame-loop-benchmark\n"
+            "                     Draw frames, and fail if the swap chain is recreated without a window resize.\n"
+            "  --device <NAME|INDEX>\n"
+            "                     Use the device at INDEX, or whose name contains NAME, as listed by --list-devices.\n"
+            "  --list-devices     Print the devices, their scores, and why each was selected or rejected, then exit.\n"
+            "  --frames-in-flight <N>\n"
+            "                     Number of frames in flight, between 1 and 4.  Default: 2.\n"
+            "  --min-image-count <N>\n"
+            "                     Minimum number of swap chain images.  Default: surface minimum + 1.\n"
+            "  --present-mode <default|fifo|fifo-relaxed|mailbox|immediate>\n"
+            "                     Present mode of the swap chain.  Default: mailbox if available, otherwise fifo.\n"
+            "  --sync <default|timeline|fences>\n"
+            "                     Track frame completion with a timeline semaphore, or fences.  Default: timeline\n"
+            "                     if supported, otherwise fences.\n"
+            "  --triangles <N>    Number of triangles to upload and draw, laid out in a grid.  Default: 1.\n"
+            "  --draws-per-frame <N>\n"
+            "                     Number of draw calls the triangles are split into.  Default: 1.\n"
+            "  --instances <N>    Number of instances of the mesh to draw, laid out in a grid.  Default: 1.\n"
+            "  --scene-scale <S>  Size of the grid of instances, relative to the view.  Default: 1.\n"
+            "  --instance-scale <S>\n"
+            "                     Size of each instance, relative to its cell of the grid.  Default: 1.\n"
+            "  --sort <none|front-to-back|back-to-front>\n"
+            "                     Order the instances are drawn in, by depth.  Default: none.\n"
+            "  --depth-format <auto|none|d32|d32s8|d24s8|d16>\n"
+            "                     Format of the depth buffer, or none to disable depth testing.  Default: auto,\n"
+            "                     i.e. the most precise format supported.\n"
+            "  --msaa <1|2|4|8>   Number of samples per pixel, clamped to those supported by the device.  Default: 1.\n"
+            "  --frame-graph-chain <N>\n"
+            "                     Compile a chain of N post-processing passes at startup, and print the memory of\n"
+            "                     their transient images with and without aliasing.  Default: 0.\n"
+            "  --gpu-culling      Cull instances in a compute shader, and draw them with indirect draw calls.\n"
+            "  --cull-workgroup-size <N>\n"
+            "                     Workgroup size of the culling compute shader.  Default: 64.\n"
+            "  --shading-iterations <N>\n"
+            "                     Iterations of artificial work per fragment, specialized into the fragment shader.\n"
+            "                     Default: 0.\n"
+            "  --single-queue     Submit uploads and compute work to the graphics queue, instead of dedicated\n"
+            "                     transfer and compute queues.\n"
+            "  --record-threads <N>\n"
+            "                     Record draw calls into secondary command buffers on N threads.  Default: 0,\n"
+            "                     i.e. record them inline on the main thread.\n"
+            "  --pipeline-variants <N>\n"
+            "                     Build N permutations of the graphics pipeline at startup, varying topology,\n"
+            "                     culling, blending and specialization constants.  Default: 0.\n"
+            "  --draw-variant <N>\n"
+            "                     Draw with the N'th permutation built by --pipeline-variants, counting from 0,\n"
+            "                     instead of the default pipeline.  Within each run of 12 permutations, even ones\n"
+            "                     draw triangle lists and odd ones strips; 0-1 cull back faces, 2-3 none and 4-5\n"
+            "                     front faces; 6-11 repeat these with blending.  Each run adds a shading\n"
+            "                     iteration.  The scene is a triangle list, drawn with back faces culled, so only\n"
+            "                     N %% 12 of 0, 2, 6 or 8 draws it correctly, and other values are rejected.\n"
+            "  --pipeline-threads <N>\n"
+            "                     Number of threads building pipeline permutations.  Default: 0, i.e. one per core.\n"
+            "  --profile-interval <N>\n"
+            "                     Print a summary of frame timings every N frames.\n"
+            "  --trace <PATH>     Write a Chrome trace (chrome://tracing) of frame timings to PATH on exit.\n"
+            "  --pipeline-cache <PATH>\n"
+            "                     Load and save the pipeline cache at PATH.  Default: a file per device, in\n"
+            "                     $XDG_CACHE_HOME or ~/.cache.\n"
+            "  --no-pipeline-cache\n"
+            "                     Do not load or save the pipeline cache, i.e. always compile pipelines cold.\n"
+            "  --watch-shaders <DIR>\n"
+            "                     Recompile shader.vert and shader.frag, or bindless.vert and bindless.frag, in DIR\n"
+            "                     when they change, and swap in the rebuilt graphics pipeline.\n"
+            "  --glslc <PATH>     GLSL compiler used by --watch-shaders.  Default: glslc, found on the PATH.\n"
+            "  --textures <N>     Stream N textures, requesting a window of them, one per instance, which slides\n"
+            "                     across all of them over time.  Default: 0.\n"
+            "  --texture-size <N> Size of the generated textures, in texels.  Default: 512.\n"
+            "  --texture-dir <DIR>\n"
+            "                     Decode the textures from the binary PPM images in DIR, instead of generating them.\n"
+            "  --texture-budget <MIB>\n"
+            "                     Memory budget of the resident textures, further bounded by the memory available\n"
+            "                     to the process if VK_EXT_memory_budget is supported.  Default: 64.\n"
+            "  --bindless         Index buffers and textures out of one descriptor set bound per frame, with\n"
+            "                     VK_EXT_descriptor_indexing, sampling the streamed textures.\n"
+            "  --help             Print this message.\n"
+            "\n"
+            "Environment variables:\n"
+            "  TRIANGLE_FRAMES_IN_FLIGHT, TRIANGLE_MIN_IMAGE_COUNT, TRIANGLE_PRESENT_MODE\n"
+            "                     Defaults for the options of the same name, overridden by the command line.\n",
+            i_programName );
+}
+
+/// Parse \p i_value, of the environment variable named \p i_name, as an unsigned integer.  Throws naming the
+/// variable and its value if it is not one.
+static uint32_t ParseEnvironmentInteger( const char* i_name, const std::string& i_value )
+{
+    size_t        parsedLength = 0;
+    unsigned long value        = 0;
+    try
+    {
+        value = std::stoul( i_value, &parsedLength );
+    }
+    catch ( const std::exception& )
+    {
+        parsedLength = 0;
+    }
+
+    if ( parsedLength == 0 || parsedLength != i_value.size() || value > UINT32_MAX )
+    {
+        throw std::runtime_error( std::string( "Invalid value of " ) + i_name + ": \"" + i_value +
+                                  "\", expected an unsigned integer" );
+    }
+
+    return static_cast< uint32_t >( value );
+}
+
+/// Read defaults of the options which tune latency and throughput from environment variables, so batch
+/// runs can be configured without changing their command lines.
+///
+/// \param o_options the options to write into.
+static void ParseEnvironment( ApplicationOptions& o_options )
+{
+    if ( const char* value = getenv( "TRIANGLE_FRAMES_IN_FLIGHT" ) )
+    {
+        o_options.m_framesInFlight = ParseEnvironmentInteger( "TRIANGLE_FRAMES_IN_FLIGHT", value );
+    }
+
+    if ( const char* value = getenv( "TRIANGLE_MIN_IMAGE_COUNT" ) )
+    {
+        o_options.m_minImageCount = ParseEnvironmentInteger( "TRIANGLE_MIN_IMAGE_COUNT", value );
+    }
+
+    if ( const char* value = getenv( "TRIANGLE_PRESENT_MODE" ) )
+    {
+        o_options.m_presentMode = ParsePresentModePolicy( value );
+    }
+}
+
+/// Parse the command line arguments \p i_argv into ApplicationOptions.
+///
+/// \param o_options the options to write into.
+///
+/// \return false if the program should exit without running.
+static bool ParseCommandLine( int i_argc, char** i_argv, ApplicationOptions& o_options )
+{
+    ParseEnvironment( o_options );
+
+    for ( int argIndex = 1; argIndex < i_argc; ++argIndex )
+    {
+        std::string arg( i_argv[ argIndex ] );
+
+        // Fetch the value following an option which requires one.
+        auto nextValue = [&]() -> std::string {
+            if ( argIndex + 1 >= i_argc )
+            {
+                throw std::runtime_error( "Missing value for option " + arg );
+            }
+
+            return std::string( i_argv[ ++argIndex ] );
+        };
+
+        if ( arg == "--headless" )
+        {
+            o_options.m_headless = true;
+        }
+        else if ( arg == "--frames" )
+        {
+            o_options.m_frameCount = std::stoull( nextValue() );
+        }
+        else if ( arg == "--output" )
+        {
+            o_options.m_outputPath = nextValue();
+        }
+        else if ( arg == "--frame-loop-benchmark" )
+        {
+            o_options.m_frameLoopBenchmark = true;
+        }
+        else if ( arg == "--frames-in-flight" )
+        {
+            o_options.m_framesInFlight = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--min-image-count" )
+        {
+            o_options.m_minImageCount = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--present-mode" )
+        {
+            o_options.m_presentMode = ParsePresentModePolicy( nextValue() );
+        }
+        else if ( arg == "--sync" )
+        {
+            o_options.m_syncMode = ParseSyncMode( nextValue() );
+        }
+        else if ( arg == "--triangles" )
+        {
+            o_options.m_triangleCount = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--draws-per-frame" )
+        {
+            o_options.m_drawsPerFrame = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--instances" )
+        {
+            o_options.m_instanceCount = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--scene-scale" )
+        {
+            o_options.m_sceneScale = std::stof( nextValue() );
+        }
+        else if ( arg == "--instance-scale" )
+        {
+            o_options.m_instanceScale = std::stof( nextValue() );
+        }
+        else if ( arg == "--sort" )
+        {
+            o_options.m_drawOrder = ParseDrawOrder( nextValue() );
+        }
+        else if ( arg == "--depth-format" )
+        {
+            std::string value       = nextValue();
+            o_options.m_depthTest   = value != "none";
+            o_options.m_depthFormat = o_options.m_depthTest ? ParseDepthFormat( value ) : VK_FORMAT_UNDEFINED;
+        }
+        else if ( arg == "--msaa" )
+        {
+            o_options.m_sampleCount = static_cast< uint32_t >( std::stoul( nextValue() ) );
+            if ( o_options.m_sampleCount != 1 && o_options.m_sampleCount != 2 && o_options.m_sampleCount != 4 &&
+                 o_options.m_sampleCount != 8 )
+            {
+                throw std::runtime_error( "Sample count must be 1, 2, 4 or 8." );
+            }
+        }
+        else if ( arg == "--frame-graph-chain" )
+        {
+            o_options.m_frameGraphChainLength = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--gpu-culling" )
+        {
+            o_options.m_gpuCulling = true;
+        }
+        else if ( arg == "--cull-workgroup-size" )
+        {
+            o_options.m_cullWorkgroupSize = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--shading-iterations" )
+        {
+            o_options.m_shadingIterations = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--device" )
+        {
+            o_options.m_deviceSelector = nextValue();
+        }
+        else if ( arg == "--list-devices" )
+        {
+            o_options.m_listDevices = true;
+        }
+        else if ( arg == "--single-queue" )
+        {
+            o_options.m_singleQueue = true;
+        }
+        else if ( arg == "--record-threads" )
+        {
+            o_options.m_recordThreads = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--pipeline-variants" )
+        {
+            o_options.m_pipelineVariantCount = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--draw-variant" )
+        {
+            o_options.m_drawVariant = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--pipeline-threads" )
+        {
+            o_options.m_pipelineBuildThreads = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--profile-interval" )
+        {
+            o_options.m_profileInterval = std::stoull( nextValue() );
+        }
+        else if ( arg == "--trace" )
+        {
+            o_options.m_tracePath = nextValue();
+        }
+        else if ( arg == "--pipeline-cache" )
+        {
+            o_options.m_pipelineCachePath = nextValue();
+        }
+        else if ( arg == "--no-pipeline-cache" )
+        {
+            o_options.m_usePipelineCache = false;
+        }
+        else if ( arg == "--watch-shaders" )
+        {
+            o_options.m_watchShadersDirectory = nextValue();
+        }
+        else if ( arg == "--glslc" )
+        {
+            o_options.m_glslcPath = nextValue();
+        }
+        else if ( arg == "--textures" )
+        {
+            o_options.m_textureCount = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--texture-size" )
+        {
+            o_options.m_textureSize = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--texture-dir" )
+        {
+            o_options.m_textureDirectory = nextValue();
+        }
+        else if ( arg == "--texture-budget" )
+        {
+            o_options.m_textureBudget = static_cast< uint32_t >( std::stoul( nextValue() ) );
+        }
+        else if ( arg == "--bindless" )
+        {
+            o_options.m_bindless = true;
+        }
+        else if ( arg == "--help" )
+        {
+            PrintUsage( i_argv[ 0 ] );
+            return false;
+        }
+        else
+        {
+            throw std::runtime_error( "Unknown option " + arg );
+        }
+    }
+
+    if ( o_options.m_framesInFlight < s_minFramesInFlight || o_options.m_framesInFlight > s_maxFramesInFlight )
+    {
+        throw std::runtime_error( "The number of frames in flight must be between " +
+                                  std::to_string( s_minFramesInFlight ) + " and " +
+                                  std::to_string( s_maxFramesInFlight ) );
+    }
+
+    if ( o_options.m_triangleCount == 0 )
+    {
+        throw std::runtime_error( "--triangles must be at least 1" );
+    }
+
+    if ( o_options.m_drawsPerFrame == 0 || o_options.m_drawsPerFrame > o_options.m_triangleCount )
+    {
+        throw std::runtime_error( "--draws-per-frame must be between 1 and the number of triangles" );
+    }
+
+    if ( o_options.m_instanceCount == 0 )
+    {
+        throw std::runtime_error( "--instances must be at least 1" );
+    }
+
+    if ( o_options.m_sceneScale <= 0.0f )
+    {
+        throw std::runtime_error( "--scene-scale must be positive" );
+    }
+
+    if ( o_options.m_gpuCulling && o_options.m_drawsPerFrame != 1 )
+    {
+        throw std::runtime_error( "--gpu-culling draws every instance with one indirect draw call, so does not "
+                                  "support --draws-per-frame" );
+    }
+
+    if ( o_options.m_textureSize == 0 || o_options.m_textureSize > 16384 )
+    {
+        throw std::runtime_error( "--texture-size must be between 1 and 16384" );
+    }
+
+    if ( o_options.m_recordThreads > s_maxRecordThreads )
+    {
+        throw std::runtime_error( "--record-threads must be at most " + std::to_string( s_maxRecordThreads ) );
+    }
+
+    if ( o_options.m_drawVariant.has_value() && o_options.m_drawVariant.value() >= o_options.m_pipelineVariantCount )
+    {
+        throw std::runtime_error( "--draw-variant must be less than --pipeline-variants" );
+    }
+
+    if ( o_options.m_drawVariant.has_value() && !IsDrawablePipelineVariant( o_options.m_drawVariant.value() ) )
+    {
+        throw std::runtime_error( "--draw-variant " + std::to_string( o_options.m_drawVariant.value() ) +
+                                  " draws triangle strips, or culls front faces, so cannot draw the triangle list "
+                                  "of the scene; N % 12 must be 0, 2, 6 or 8" );
+    }
+
+    if ( !o_options.m_outputPath.empty() && !o_options.m_headless )
+    {
+        throw std::runtime_error( "--output is only supported with --headless" );
+    }
+
+    if ( o_options.m_frameLoopBenchmark && o_options.m_headless )
+    {
+        throw std::runtime_error( "--frame-loop-benchmark requires a window and swap chain" );
+    }
+
+    if ( ( o_options.m_headless || o_options.m_frameLoopBenchmark ) && o_options.m_frameCount == 0 )
+    {
+        o_options.m_frameCount = o_options.m_headless ? s_defaultHeadlessFrameCount : s_defaultBenchmarkFrameCount;
+    }
+
+    return true;
+}
+
+/// \class TriangleApplication
+///
+/// A simple app which draws a triangle using the Vulkan API, in a window.
+///
+/// In headless mode, the triangle is drawn into device-local offscreen images instead, which can be
+/// read back into a file or discarded.  No window system is required, so a software implementation
+/// such as lavapipe or SwiftShader can be used.
+class TriangleApplication
+{
+public:
+    explicit TriangleApplication( const std::string& i_executablePath, const ApplicationOptions& i_options )
+        : m_executablePath( i_executablePath )
+        , m_options( i_options )
+    {
+        m_profiler.SetKeepTrace( !m_options.m_tracePath.empty() );
+    }
+
+    /// Begin executing the TriangleApplication.
+    void Run()
+    {
+        if ( m_options.m_listDevices )
+        {
+            ListDevices();
+            return;
+        }
+
+        if ( !m_options.m_headless )
+        {
+            InitWindow();
+        }
+
+        InitVulkan();
+        MainLoop();
+
+        if ( !m_options.m_outputPath.empty() )
+        {
+            WriteImage( m_lastImageIndex, m_options.m_outputPath );
+        }
+
+        Teardown();
+
+        if ( m_options.m_frameLoopBenchmark )
+        {
+            CheckFrameLoopBenchmark();
+        }
+    }
+
+private:
+    /// \struct SwapChainSupportDetails
+    ///
+    /// Swap chain details.
+    struct SwapChainSupportDetails
+    {
+        VkSurfaceCapabilitiesKHR          m_capabilities;
+        std::vector< VkSurfaceFormatKHR > m_formats;
+        std::vector< VkPresentModeKHR >   m_presentModes;
+    };
+
+    /// \struct QueueFamilyIndices
+    ///
+    /// Internal structure for encoding queue family support, queried from the physical device.
+    struct QueueFamilyIndices
+    {
+        std::optional< uint32_t > m_graphicsFamily;
+        std::optional< uint32_t > m_presentFamily;
+        std::optional< uint32_t > m_computeFamily;  // Family with compute, but not graphics, support.
+        std::optional< uint32_t > m_transferFamily; // Family with transfer, but neither graphics nor compute, support.
+
+        /// Convenience method for checking if all the queue families that are required for this application
+        /// are found.  Presentation is not required when \p i_requirePresent is false (headless).
+        bool IsComplete( bool i_requirePresent = true ) const
+        {
+            return m_graphicsFamily.has_value() && ( m_presentFamily.has_value() || !i_requirePresent );
+        }
+    };
+
+    static void FramebufferResizeCallback( GLFWwindow* i_window, int i_width, int i_height )
+    {
+        TriangleApplication* app = reinterpret_cast< TriangleApplication* >( glfwGetWindowUserPointer( i_window ) );
+
+        // Events received before the swap chain is recreated are handled by the same recreation.
+        if ( !app->m_framebufferResized )
+        {
+            app->m_resizeRequestCount++;
+        }
+
+        app->m_framebufferResized = true;
+        app->m_resizeEventCount++;
+    }
+
+    // Initialize a window.
+    void InitWindow()
+    {
+        glfwInit();
+
+        glfwWindowHint( GLFW_CLIENT_API, GLFW_NO_API );
+
+        m_window = glfwCreateWindow( m_windowWidth, m_windowHeight, m_windowTitle, nullptr, nullptr );
+        glfwSetWindowUserPointer( m_window, this );
+        glfwSetFramebufferSizeCallback( m_window, FramebufferResizeCallback );
+    }
+
+    std::vector< const char* > GetRequiredExtensions() const
+    {
+        std::vector< const char* > extensions;
+
+        // Enable gflw interface extensions.  Not needed in headless mode, which has no surface.
+        if ( !m_options.m_headless )
+        {
+            uint32_t     glfwExtensionCount = 0;
+            const char** glfwExtensions     = glfwGetRequiredInstanceExtensions( &glfwExtensionCount );
+            extensions.insert( extensions.end(), glfwExtensions, glfwExtensions + glfwExtensionCount );
+        }
+
+        if ( m_enableValidationLayers )
+        {
+            extensions.push_back( VK_EXT_DEBUG_UTILS_EXTENSION_NAME );
+        }
+
+        // Needed to query support of timeline semaphores, the descriptor indexing features and limits of bindless
+        // descriptors, and the memory budget bounding streamed textures, which are all optional.
+        const bool properties2Needed =
+            m_options.m_syncMode != SyncMode_Fences || m_options.m_bindless || m_options.m_textureCount > 0;
+        if ( properties2Needed &&
+             vkbase::IsVulkanExtensionSupported( VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME ) )
+        {
+            extensions.push_back( VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME );
+        }
+
+        return extensions;
+    }
+
+    // Create the vulkan instance.
+    void CreateVulkanInstance()
+    {
+        // Information about the application.
+        VkApplicationInfo appInfo  = {};
+        appInfo.sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pApplicationName   = "Hello Triangle";
+        appInfo.applicationVersion = VK_MAKE_VERSION( 1, 0, 0 );
+        appInfo.pEngineName        = "No Engine";
+        appInfo.engineVersion      = VK_MAKE_VERSION( 1, 0, 0 );
+        appInfo.apiVersion         = VK_API_VERSION_1_0;
+
+        // Instance creation info.
+        VkInstanceCreateInfo createInfo = {};
+        createInfo.sType                = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        createInfo.pApplicationInfo     = &appInfo;
+
+        // Check extensions support.
+        if ( m_enableValidationLayers && !vkbase::CheckVulkanLayersSupport( m_validationLayers ) )
+        {
+            throw std::runtime_error( "Missing vulkan layers, abort!" );
+        }
+
+        VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo;
+        if ( m_enableValidationLayers )
+        {
+            createInfo.enabledLayerCount   = static_cast< uint32_t >( m_validationLayers.size() );
+            createInfo.ppEnabledLayerNames = m_validationLayers.data();
+
+            PopulateDebugMessengerCreateInfo( debugCreateInfo );
+            createInfo.pNext = ( VkDebugUtilsMessengerCreateInfoEXT* ) &debugCreateInfo;
+        }
+        else
+        {
+            createInfo.enabledLayerCount = 0;
+            createInfo.pNext             = nullptr;
+        }
+
+        // Check extensions support.
+        std::vector< const char* > extensions = GetRequiredExtensions();
+        if ( !vkbase::CheckVulkanExtensionsSupport( extensions ) )
+        {
+            throw std::runtime_error( "Missing vulkan extensions, abort!" );
+        }
+
+        createInfo.enabledExtensionCount   = extensions.size();
+        createInfo.ppEnabledExtensionNames = extensions.data();
+
+        m_physicalDeviceProperties2Enabled =
+            std::find_if( extensions.begin(), extensions.end(), []( const char* i_extension ) {
+                return strcmp( i_extension, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME ) == 0;
+            } ) != extensions.end();
+
+        // Create the vulkan instance.
+        if ( vkCreateInstance( &createInfo, nullptr, &m_instance ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create vulkan instance." );
+        }
+    }
+
+    /// Utility method for populating the the debug messenger create info.
+    void PopulateDebugMessengerCreateInfo( VkDebugUtilsMessengerCreateInfoEXT& o_createInfo ) const
+    {
+        o_createInfo                 = {};
+        o_createInfo.sType           = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+        o_createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
+                                       VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+                                       VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+        o_createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+                                   VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+                                   VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+        o_createInfo.pfnUserCallback = DebugCallback;
+    }
+
+    // Setup the debug messenger.
+    void SetupDebugMessenger()
+    {
+        if ( !m_enableValidationLayers )
+        {
+            return;
+        }
+
+        VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
+        PopulateDebugMessengerCreateInfo( createInfo );
+        if ( CreateDebugUtilsMessengerEXT( m_instance, &createInfo, nullptr, &m_debugMessenger ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "failed to set up debug messenger!" );
+        }
+    }
+
+    SwapChainSupportDetails QuerySwapChainSupport( VkPhysicalDevice i_device ) const
+    {
+        SwapChainSupportDetails details;
+
+        // Query capabilities.
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR( i_device, m_surface, &details.m_capabilities );
+
+        // Query available formats
+        uint32_t formatCount;
+        vkGetPhysicalDeviceSurfaceFormatsKHR( i_device, m_surface, &formatCount, nullptr );
+        if ( formatCount != 0 )
+        {
+            details.m_formats.resize( formatCount );
+            vkGetPhysicalDeviceSurfaceFormatsKHR( i_device, m_surface, &formatCount, details.m_formats.data() );
+        }
+
+        // Presentation modes.
+        uint32_t presentModeCount;
+        vkGetPhysicalDeviceSurfacePresentModesKHR( i_device, m_surface, &presentModeCount, nullptr );
+        if ( presentModeCount != 0 )
+        {
+            details.m_presentModes.resize( presentModeCount );
+            vkGetPhysicalDeviceSurfacePresentModesKHR( i_device,
+                                                       m_surface,
+                                                       &presentModeCount,
+                                                       details.m_presentModes.data() );
+        }
+
+        return details;
+    }
+
+    /// Query if the current device supports
+    QueueFamilyIndices FindQueueFamilies( VkPhysicalDevice i_device ) const
+    {
+        QueueFamilyIndices indices;
+
+        // Get available queue families.
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties( i_device, &queueFamilyCount, nullptr );
+        std::vector< VkQueueFamilyProperties > queueFamilies( queueFamilyCount );
+        vkGetPhysicalDeviceQueueFamilyProperties( i_device, &queueFamilyCount, queueFamilies.data() );
+
+        for ( size_t familyIndex = 0; familyIndex < queueFamilies.size(); ++familyIndex )
+        {
+            const VkQueueFamilyProperties& queueFamily = queueFamilies[ familyIndex ];
+
+            // Present support.  There is no surface to present to in headless mode.
+            if ( !m_options.m_headless && !indices.m_presentFamily.has_value() )
+            {
+                VkBool32 presentSupport = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR( i_device, familyIndex, m_surface, &presentSupport );
+                if ( presentSupport )
+                {
+                    indices.m_presentFamily = familyIndex;
+                }
+            }
+
+            // Graphics support.
+            if ( ( queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT ) && !indices.m_graphicsFamily.has_value() )
+            {
+                indices.m_graphicsFamily = familyIndex;
+            }
+
+            // Dedicated compute and transfer families, whose queues typically map onto separate hardware engines,
+            // so their work overlaps rendering.
+            const VkQueueFlags queueFlags = queueFamily.queueFlags;
+            if ( ( queueFlags & VK_QUEUE_COMPUTE_BIT ) && !( queueFlags & VK_QUEUE_GRAPHICS_BIT ) &&
+                 !indices.m_computeFamily.has_value() )
+            {
+                indices.m_computeFamily = familyIndex;
+            }
+
+            if ( ( queueFlags & VK_QUEUE_TRANSFER_BIT ) &&
+                 !( queueFlags & ( VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT ) ) &&
+                 !indices.m_transferFamily.has_value() )
+            {
+                indices.m_transferFamily = familyIndex;
+            }
+
+            if ( indices.IsComplete( !m_options.m_headless ) && indices.m_computeFamily.has_value() &&
+                 indices.m_transferFamily.has_value() )
+            {
+                break;
+            }
+        }
+
+        return indices;
+    }
+
+    /// Check if the optional extension \p i_extensionName is supported, for \p i_device.
+    bool IsDeviceExtensionSupported( VkPhysicalDevice i_device, const char* i_extensionName ) const
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties( i_device, nullptr, &extensionCount, nullptr );
+
+        std::vector< VkExtensionProperties > availableExtensions( extensionCount );
+        vkEnumerateDeviceExtensionProperties( i_device, nullptr, &extensionCount, availableExtensions.data() );
+
+        for ( const VkExtensionProperties& extension : availableExtensions )
+        {
+            if ( strcmp( extension.extensionName, i_extensionName ) == 0 )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Check if \p i_device meets the requirements of the application.
+    ///
+    /// \param o_reason why the device is not suitable, if it is not.
+    bool IsDeviceSuitable( VkPhysicalDevice i_device, std::string& o_reason ) const
+    {
+        QueueFamilyIndices indices = FindQueueFamilies( i_device );
+        if ( !indices.m_graphicsFamily.has_value() )
+        {
+            o_reason = "no graphics queue";
+            return false;
+        }
+
+        // Offscreen rendering does not present.
+        if ( !m_options.m_headless && !indices.m_presentFamily.has_value() )
+        {
+            o_reason = "cannot present to the window surface";
+            return false;
+        }
+
+        for ( const char* extensionName : GetRequiredDeviceExtensions() )
+        {
+            if ( !IsDeviceExtensionSupported( i_device, extensionName ) )
+            {
+                o_reason = std::string( "missing extension " ) + extensionName;
+                return false;
+            }
+        }
+
+        if ( !m_options.m_headless )
+        {
+            SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport( i_device );
+            if ( swapChainSupport.m_formats.empty() || swapChainSupport.m_presentModes.empty() )
+            {
+                o_reason = "no surface formats or present modes";
+                return false;
+            }
+        }
+
+        // Features required by the options.
+        VkPhysicalDeviceFeatures features;
+        vkGetPhysicalDeviceFeatures( i_device, &features );
+        if ( m_options.m_gpuCulling && ( !features.multiDrawIndirect || !features.drawIndirectFirstInstance ) )
+        {
+            o_reason = "GPU culling requires multiDrawIndirect and drawIndirectFirstInstance";
+            return false;
+        }
+
+        if ( m_options.m_syncMode == SyncMode_Timeline && !IsTimelineSemaphoreSupported( i_device ) )
+        {
+            o_reason = "timeline semaphores are not supported";
+            return false;
+        }
+
+        return true;
+    }
+
+    /// Check if \p i_device supports timeline semaphores.
+    bool IsTimelineSemaphoreSupported( VkPhysicalDevice i_device ) const
+    {
+        return m_physicalDeviceProperties2Enabled &&
+               IsDeviceExtensionSupported( i_device, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME ) &&
+               vkbase::IsTimelineSemaphoreSupported( m_instance, i_device );
+    }
+
+    /// \struct DeviceCandidate
+    ///
+    /// A physical device considered by SelectPhysicalDevice, and how it was scored.
+    struct DeviceCandidate
+    {
+        VkPhysicalDevice           m_device = VK_NULL_HANDLE;
+        uint32_t                   m_index  = 0; // Index of the device, in enumeration order.
+        VkPhysicalDeviceProperties m_properties;
+        VkDeviceSize               m_deviceLocalMemory = 0; // Size of the largest device local memory heap.
+        bool                       m_suitable          = false;
+        std::string                m_reason;       // Why the device is not suitable, or the breakdown of its score.
+        uint64_t                   m_score    = 0; // Higher is preferred.
+        bool                       m_selected = false;
+    };
+
+    /// Score \p io_candidate, preferring discrete over integrated over virtual over CPU devices, then more
+    /// device local memory, then larger limits and support for optional features.  The device type dominates:
+    /// the other terms sum to less than the gap between types.
+    void ScoreDevice( DeviceCandidate& io_candidate ) const
+    {
+        uint64_t typeScore = 0;
+        switch ( io_candidate.m_properties.deviceType )
+        {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            typeScore = 6000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            typeScore = 4000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            typeScore = 2000;
+            break;
+        default:
+            typeScore = 0;
+            break;
+        }
+
+        // 100 per GiB of device local memory, up to 16 GiB.
+        const uint64_t memoryScore =
+            std::min< uint64_t >( io_candidate.m_deviceLocalMemory / ( 1024 * 1024 * 1024 ), 16 ) * 100;
+
+        // Up to 32, for the maximum 2D image dimension, in units of 1024 texels.
+        const uint64_t limitScore =
+            std::min< uint64_t >( io_candidate.m_properties.limits.maxImageDimension2D / 1024, 32 );
+
+        // 50 for each optional feature the application makes use of.
+        QueueFamilyIndices indices      = FindQueueFamilies( io_candidate.m_device );
+        uint64_t           featureScore = 0;
+        featureScore += indices.m_computeFamily.has_value() ? 50 : 0;
+        featureScore += indices.m_transferFamily.has_value() ? 50 : 0;
+        featureScore += IsTimelineSemaphoreSupported( io_candidate.m_device ) ? 50 : 0;
+        featureScore +=
+            IsDeviceExtensionSupported( io_candidate.m_device, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME ) ? 50 : 0;
+
+        io_candidate.m_score  = typeScore + memoryScore + limitScore + featureScore;
+        io_candidate.m_reason = "type " + std::to_string( typeScore ) + " + memory " + std::to_string( memoryScore ) +
+                                " + limits " + std::to_string( limitScore ) + " + features " +
+                                std::to_string( featureScore );
+    }
+
+    /// Does \p i_candidate match the --device option, by index or by a case-insensitive substring of its name?
+    bool MatchesDeviceSelector( const DeviceCandidate& i_candidate ) const
+    {
+        const std::string& selector = m_options.m_deviceSelector;
+        if ( selector.empty() )
+        {
+            return true;
+        }
+
+        if ( std::all_of( selector.begin(), selector.end(), []( unsigned char i_char ) { return isdigit( i_char ); } ) )
+        {
+            return std::stoul( selector ) == i_candidate.m_index;
+        }
+
+        std::string name    = i_candidate.m_properties.deviceName;
+        std::string pattern = selector;
+        for ( std::string* text : {&name, &pattern} )
+        {
+            std::transform( text->begin(), text->end(), text->begin(), []( unsigned char i_char ) {
+                return static_cast< char >( tolower( i_char ) );
+            } );
+        }
+
+        return name.find( pattern ) != std::string::npos;
+    }
+
+    /// Select the highest scoring suitable physical device, among those matching the --device option.  With
+    /// --list-devices, print every device, its score, and why it was selected or rejected.
+    void SelectPhysicalDevice()
+    {
+        uint32_t deviceCount = 0;
+        vkEnumeratePhysicalDevices( m_instance, &deviceCount, nullptr );
+        if ( deviceCount == 0 )
+        {
+            throw std::runtime_error( "Failed to find graphics device with Vulkan support." );
+        }
+
+        std::vector< VkPhysicalDevice > devices( deviceCount, VK_NULL_HANDLE );
+        vkEnumeratePhysicalDevices( m_instance, &deviceCount, devices.data() );
+
+        std::vector< DeviceCandidate > candidates( deviceCount );
+        DeviceCandidate*               selected = nullptr;
+        for ( uint32_t deviceIndex = 0; deviceIndex < deviceCount; ++deviceIndex )
+        {
+            DeviceCandidate& candidate = candidates[ deviceIndex ];
+            candidate.m_device         = devices[ deviceIndex ];
+            candidate.m_index          = deviceIndex;
+            vkGetPhysicalDeviceProperties( candidate.m_device, &candidate.m_properties );
+
+            VkPhysicalDeviceMemoryProperties memoryProperties;
+            vkGetPhysicalDeviceMemoryProperties( candidate.m_device, &memoryProperties );
+            for ( uint32_t heapIndex = 0; heapIndex < memoryProperties.memoryHeapCount; ++heapIndex )
+            {
+                const VkMemoryHeap& heap = memoryProperties.memoryHeaps[ heapIndex ];
+                if ( heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT )
+                {
+                    candidate.m_deviceLocalMemory = std::max( candidate.m_deviceLocalMemory, heap.size );
+                }
+            }
+
+            if ( !MatchesDeviceSelector( candidate ) )
+            {
+                candidate.m_reason = "does not match --device " + m_options.m_deviceSelector;
+                continue;
+            }
+
+            candidate.m_suitable = IsDeviceSuitable( candidate.m_device, candidate.m_reason );
+            if ( !candidate.m_suitable )
+            {
+                continue;
+            }
+
+            ScoreDevice( candidate );
+            if ( selected == nullptr || candidate.m_score > selected->m_score )
+            {
+                selected = &candidate;
+            }
+        }
+
+        if ( selected != nullptr )
+        {
+            selected->m_selected = true;
+            m_physicalDevice     = selected->m_device;
+        }
+
+        if ( m_options.m_listDevices )
+        {
+            for ( const DeviceCandidate& candidate : candidates )
+            {
+                printf( "[%u] %s (%s, %.1f GiB device local memory, Vulkan %u.%u.%u)\n",
+                        candidate.m_index,
+                        candidate.m_properties.deviceName,
+                        GetDeviceTypeName( candidate.m_properties.deviceType ),
+                        candidate.m_deviceLocalMemory / ( 1024.0 * 1024.0 * 1024.0 ),
+                        VK_VERSION_MAJOR( candidate.m_properties.apiVersion ),
+                        VK_VERSION_MINOR( candidate.m_properties.apiVersion ),
+                        VK_VERSION_PATCH( candidate.m_properties.apiVersion ) );
+                if ( candidate.m_suitable )
+                {
+                    printf( "    %s: score %llu = %s\n",
+                            candidate.m_selected ? "Selected" : "Suitable, outscored",
+                            static_cast< unsigned long long >( candidate.m_score ),
+                            candidate.m_reason.c_str() );
+                }
+                else
+                {
+                    printf( "    Rejected: %s\n", candidate.m_reason.c_str() );
+                }
+            }
+        }
+
+        if ( m_physicalDevice == VK_NULL_HANDLE )
+        {
+            throw std::runtime_error( m_options.m_deviceSelector.empty()
+                                          ? "Failed to find suitable graphics device."
+                                          : "Failed to find suitable graphics device matching --device " +
+                                                m_options.m_deviceSelector + "; see --list-devices" );
+        }
+
+        printf( "Selected device [%u] %s.\n", selected->m_index, selected->m_properties.deviceName );
+    }
+
+    /// Print the physical devices, and why each was selected or rejected, without initializing anything else.
+    void ListDevices()
+    {
+        CreateVulkanInstance();
+        if ( !m_options.m_headless )
+        {
+            InitWindow();
+            CreateSurface();
+        }
+
+        try
+        {
+            SelectPhysicalDevice();
+        }
+        catch ( const std::exception& e )
+        {
+            printf( "%s\n", e.what() );
+        }
+
+        if ( !m_options.m_headless )
+        {
+            vkDestroySurfaceKHR( m_instance, m_surface, nullptr );
+            glfwDestroyWindow( m_window );
+            glfwTerminate();
+        }
+
+        vkDestroyInstance( m_instance, nullptr );
+    }
+
+    void CreateLogicalDevice()
+    {
+        QueueFamilyIndices indices = FindQueueFamilies( m_physicalDevice );
+
+        // Without dedicated compute or transfer families, that work is submitted to the graphics queue.
+        const uint32_t graphicsFamily = indices.m_graphicsFamily.value();
+        const uint32_t computeFamily =
+            m_options.m_singleQueue ? graphicsFamily : indices.m_computeFamily.value_or( graphicsFamily );
+        const uint32_t transferFamily =
+            m_options.m_singleQueue ? graphicsFamily : indices.m_transferFamily.value_or( graphicsFamily );
+
+        std::vector< VkDeviceQueueCreateInfo > queueCreateInfos;
+        std::set< uint32_t > uniqueQueueFamilies = {graphicsFamily, computeFamily, transferFamily};
+        if ( indices.m_presentFamily.has_value() )
+        {
+            uniqueQueueFamilies.insert( indices.m_presentFamily.value() );
+        }
+
+        float queuePriority = 1.0f;
+        for ( uint32_t queueFamily : uniqueQueueFamilies )
+        {
+            VkDeviceQueueCreateInfo queueCreateInfo = {};
+            queueCreateInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queueCreateInfo.queueFamilyIndex        = queueFamily;
+            queueCreateInfo.queueCount              = 1;
+            queueCreateInfo.pQueuePriorities        = &queuePriority;
+            queueCreateInfos.push_back( queueCreateInfo );
+        }
+
+        // Indirect draws of multiple objects, each selecting its instance with firstInstance, for GPU culling.
+        VkPhysicalDeviceFeatures deviceFeatures = {};
+        if ( m_options.m_gpuCulling )
+        {
+            VkPhysicalDeviceFeatures supportedFeatures;
+            vkGetPhysicalDeviceFeatures( m_physicalDevice, &supportedFeatures );
+            if ( !supportedFeatures.multiDrawIndirect || !supportedFeatures.drawIndirectFirstInstance )
+            {
+                throw std::runtime_error( "GPU culling requires the multiDrawIndirect and drawIndirectFirstInstance "
+                                          "features" );
+            }
+
+            deviceFeatures.multiDrawIndirect         = VK_TRUE;
+            deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+        }
+
+        /// Create logical device.
+        VkDeviceCreateInfo createInfo   = {};
+        createInfo.sType                = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pQueueCreateInfos    = queueCreateInfos.data();
+        createInfo.queueCreateInfoCount = static_cast< uint32_t >( queueCreateInfos.size() );
+        createInfo.pEnabledFeatures     = &deviceFeatures;
+
+        std::vector< const char* > deviceExtensions = GetRequiredDeviceExtensions();
+
+        // Draw only as many indirect commands as the culling shader counted, if supported.  Otherwise, every
+        // object's command is drawn, with culled objects drawing zero instances.
+        m_drawIndirectCountSupported =
+            m_options.m_gpuCulling &&
+            IsDeviceExtensionSupported( m_physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+        if ( m_drawIndirectCountSupported )
+        {
+            deviceExtensions.push_back( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+        }
+
+        // Track frame completion with a timeline semaphore, if supported.  Otherwise, fall back to fences.
+        m_useTimelineSemaphores =
+            m_options.m_syncMode != SyncMode_Fences && IsTimelineSemaphoreSupported( m_physicalDevice );
+        if ( m_options.m_syncMode == SyncMode_Timeline && !m_useTimelineSemaphores )
+        {
+            throw std::runtime_error( "Timeline semaphores are not supported by the device" );
+        }
+
+        // Bound the memory of streamed textures by what the device reports as available, if supported.
+        m_memoryBudgetEnabled = m_options.m_textureCount > 0 && m_physicalDeviceProperties2Enabled &&
+                                IsDeviceExtensionSupported( m_physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME );
+        if ( m_memoryBudgetEnabled )
+        {
+            deviceExtensions.push_back( VK_EXT_MEMORY_BUDGET_EXTENSION_NAME );
+        }
+
+        VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+        timelineFeatures.timelineSemaphore = VK_TRUE;
+        if ( m_useTimelineSemaphores )
+        {
+            deviceExtensions.push_back( VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME );
+            createInfo.pNext = &timelineFeatures;
+        }
+
+        // Bindless descriptors index unbounded arrays of update-after-bind descriptors.  VK_EXT_descriptor_indexing
+        // depends on VK_KHR_maintenance3.
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = vkbase::GetBindlessFeatures();
+        if ( m_options.m_bindless )
+        {
+            if ( !m_physicalDeviceProperties2Enabled ||
+                 !IsDeviceExtensionSupported( m_physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME ) ||
+                 !IsDeviceExtensionSupported( m_physicalDevice, VK_KHR_MAINTENANCE3_EXTENSION_NAME ) ||
+                 !vkbase::IsBindlessSupported( m_instance, m_physicalDevice ) )
+            {
+                throw std::runtime_error( "Bindless descriptors are not supported by the device" );
+            }
+
+            deviceExtensions.push_back( VK_KHR_MAINTENANCE3_EXTENSION_NAME );
+            deviceExtensions.push_back( VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME );
+            indexingFeatures.pNext = const_cast< void* >( createInfo.pNext );
+            createInfo.pNext       = &indexingFeatures;
+        }
+
+        createInfo.enabledExtensionCount   = static_cast< uint32_t >( deviceExtensions.size() );
+        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+        if ( m_enableValidationLayers )
+        {
+            createInfo.enabledLayerCount   = static_cast< uint32_t >( m_validationLayers.size() );
+            createInfo.ppEnabledLayerNames = m_validationLayers.data();
+        }
+        else
+        {
+            createInfo.enabledLayerCount = 0;
+        }
+
+        if ( vkCreateDevice( m_physicalDevice, &createInfo, nullptr, &m_device ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create logical device." );
+        }
+
+        if ( m_drawIndirectCountSupported )
+        {
+            m_cmdDrawIndexedIndirectCount = reinterpret_cast< PFN_vkCmdDrawIndexedIndirectCountKHR >(
+                vkGetDeviceProcAddr( m_device, "vkCmdDrawIndexedIndirectCountKHR" ) );
+            m_drawIndirectCountSupported = m_cmdDrawIndexedIndirectCount != nullptr;
+        }
+
+        // Get handles to the command queues.
+        m_graphicsQueue.Init( m_device, graphicsFamily );
+        m_computeQueue.Init( m_device, computeFamily );
+        m_transferQueue.Init( m_device, transferFamily );
+        if ( indices.m_presentFamily.has_value() )
+        {
+            vkGetDeviceQueue( m_device, indices.m_presentFamily.value(), 0, &m_presentQueue );
+        }
+
+        printf( "Queue families: graphics %u, compute %u, transfer %u.\n",
+                graphicsFamily,
+                computeFamily,
+                transferFamily );
+
+        // Device memory of buffers and transient images is sub-allocated from large blocks.
+        m_allocator.Init( m_physicalDevice, m_device );
+        m_shaderRegistry.Init( m_device );
+        m_descriptorLayoutCache.Init( m_device );
+    }
+
+    /// The device extensions required by this application.  Headless rendering does not need a swap chain.
+    std::vector< const char* > GetRequiredDeviceExtensions() const
+    {
+        if ( m_options.m_headless )
+        {
+            return {};
+        }
+
+        return {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    }
+
+    /// Find the index of a memory type on the physical device, which is allowed by \p i_typeFilter and has all
+    /// the requested \p i_properties.
+    uint32_t FindMemoryType( uint32_t i_typeFilter, VkMemoryPropertyFlags i_properties ) const
+    {
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties( m_physicalDevice, &memoryProperties );
+
+        for ( uint32_t typeIndex = 0; typeIndex < memoryProperties.memoryTypeCount; ++typeIndex )
+        {
+            if ( ( i_typeFilter & ( 1 << typeIndex ) ) &&
+                 ( memoryProperties.memoryTypes[ typeIndex ].propertyFlags & i_properties ) == i_properties )
+            {
+                return typeIndex;
+            }
+        }
+
+        throw std::runtime_error( "Failed to find suitable memory type." );
+    }
+
+    /// Debug callback handling.
+    static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback( VkDebugUtilsMessageSeverityFlagBitsEXT      i_messageSeverity,
+                                                         VkDebugUtilsMessageTypeFlagsEXT             i_messageType,
+                                                         const VkDebugUtilsMessengerCallbackDataEXT* i_pCallbackData,
+                                                         void*                                       i_pUserData )
+    {
+        std::cerr << "validation layer: " << i_pCallbackData->pMessage << std::endl;
+
+        // Should the vulkan call, which triggered this debug callback, be aborted?
+        return VK_FALSE;
+    }
+
+    /// Retrieve the create debug messenger function.  It is an extension, so we must fetch the function
+    /// pointer with vkGetInstanceProcAddr.
+    VkResult CreateDebugUtilsMessengerEXT( VkInstance                                i_instance,
+                                           const VkDebugUtilsMessengerCreateInfoEXT* i_pCreateInfo,
+                                           const VkAllocationCallbacks*              i_pAllocator,
+                                           VkDebugUtilsMessengerEXT*                 o_pDebugMessenger )
+    {
+        PFN_vkCreateDebugUtilsMessengerEXT func =
+            ( PFN_vkCreateDebugUtilsMessengerEXT ) vkGetInstanceProcAddr( i_instance,
+                                                                          "vkCreateDebugUtilsMessengerEXT" );
+        if ( func != nullptr )
+        {
+            return func( i_instance, i_pCreateInfo, i_pAllocator, o_pDebugMessenger );
+        }
+        else
+        {
+            return VK_ERROR_EXTENSION_NOT_PRESENT;
+        }
+    }
+
+    void DestroyDebugUtilsMessengerEXT( VkInstance                   i_instance,
+                                        VkDebugUtilsMessengerEXT     o_debugMessenger,
+                                        const VkAllocationCallbacks* i_pAllocator )
+    {
+        PFN_vkDestroyDebugUtilsMessengerEXT func =
+            ( PFN_vkDestroyDebugUtilsMessengerEXT ) vkGetInstanceProcAddr( i_instance,
+                                                                           "vkDestroyDebugUtilsMessengerEXT" );
+        if ( func != nullptr )
+        {
+            func( i_instance, o_debugMessenger, i_pAllocator );
+        }
+    }
+
+    /// Choose a preferred surface format.
+    VkSurfaceFormatKHR SelectSwapSurfaceFormat( const std::vector< VkSurfaceFormatKHR >& i_availableFormats ) const
+    {
+        for ( const VkSurfaceFormatKHR& availableFormat : i_availableFormats )
+        {
+            if ( availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB &&
+                 availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR )
+            {
+                return availableFormat;
+            }
+        }
+
+        return i_availableFormats[ 0 ];
+    }
+
+    /// Choose the present mode requested by the present mode policy.  FIFO is always available, so it is
+    /// used if the requested mode is not.
+    VkPresentModeKHR SelectSwapPresentMode( const std::vector< VkPresentModeKHR >& i_availablePresentModes ) const
+    {
+        VkPresentModeKHR requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        switch ( m_options.m_presentMode )
+        {
+        case PresentModePolicy_Default:
+        case PresentModePolicy_Mailbox:
+            requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+            break;
+        case PresentModePolicy_Fifo:
+            requestedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+            break;
+        case PresentModePolicy_FifoRelaxed:
+            requestedPresentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+            break;
+        case PresentModePolicy_Immediate:
+            requestedPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            break;
+        }
+
+        for ( const VkPresentModeKHR& availablePresentMode : i_availablePresentModes )
+        {
+            if ( availablePresentMode == requestedPresentMode )
+            {
+                return availablePresentMode;
+            }
+        }
+
+        if ( m_options.m_presentMode != PresentModePolicy_Default )
+        {
+            printf( "Requested present mode is not available, using FIFO.\n" );
+        }
+
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    /// Get the display name of \p i_presentMode.
+    static const char* GetPresentModeName( VkPresentModeKHR i_presentMode )
+    {
+        switch ( i_presentMode )
+        {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "IMMEDIATE";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "MAILBOX";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "FIFO";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "FIFO_RELAXED";
+        default:
+            return "UNKNOWN";
+        }
+    }
+
+    /// Readable name of the physical device type \p i_deviceType.
+    static const char* GetDeviceTypeName( VkPhysicalDeviceType i_deviceType )
+    {
+        switch ( i_deviceType )
+        {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return "discrete GPU";
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return "integrated GPU";
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return "virtual GPU";
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            return "CPU";
+        default:
+            return "other";
+        }
+    }
+
+    /// Choose the minimum number of swap chain images, within the bounds supported by the surface.
+    uint32_t SelectSwapImageCount( const VkSurfaceCapabilitiesKHR& i_capabilities ) const
+    {
+        uint32_t imageCount = m_options.m_minImageCount > 0 ? m_options.m_minImageCount : i_capabilities.minImageCount + 1;
+        imageCount          = std::max( imageCount, i_capabilities.minImageCount );
+        if ( i_capabilities.maxImageCount > 0 && imageCount > i_capabilities.maxImageCount )
+        {
+            imageCount = i_capabilities.maxImageCount;
+        }
+
+        return imageCount;
+    }
+
+    VkExtent2D SelectSwapExtent( const VkSurfaceCapabilitiesKHR& i_capabilities )
+    {
+        if ( i_capabilities.currentExtent.width != UINT32_MAX )
+        {
+            return i_capabilities.currentExtent;
+        }
+        else
+        {
+            int width, height;
+            glfwGetFramebufferSize( m_window, &width, &height );
+            VkExtent2D actualExtent = {( uint32_t ) width, ( uint32_t ) height};
+
+            actualExtent.width  = std::max( i_capabilities.minImageExtent.width,
+                                           std::min( i_capabilities.maxImageExtent.width, actualExtent.width ) );
+            actualExtent.height = std::max( i_capabilities.minImageExtent.height,
+                                            std::min( i_capabilities.maxImageExtent.height, actualExtent.height ) );
+
+            return actualExtent;
+        }
+    }
+
+    /// Create the swap chain.  When recreating, \p i_oldSwapChain is the swap chain being replaced, which
+    /// allows the implementation to reuse its resources and to keep presenting its images in the meantime.
+    void CreateSwapChain( VkSwapchainKHR i_oldSwapChain = VK_NULL_HANDLE )
+    {
+        SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport( m_physicalDevice );
+        VkSurfaceFormatKHR      surfaceFormat    = SelectSwapSurfaceFormat( swapChainSupport.m_formats );
+        VkPresentModeKHR        presentMode      = SelectSwapPresentMode( swapChainSupport.m_presentModes );
+        VkExtent2D              extent           = SelectSwapExtent( swapChainSupport.m_capabilities );
+
+        uint32_t                imageCount       = SelectSwapImageCount( swapChainSupport.m_capabilities );
+
+        // Create the swap chain.
+        VkSwapchainCreateInfoKHR createInfo = {};
+        createInfo.sType                    = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+        createInfo.surface                  = m_surface;
+        createInfo.minImageCount            = imageCount;
+        createInfo.imageFormat              = surfaceFormat.format;
+        createInfo.imageColorSpace          = surfaceFormat.colorSpace;
+        createInfo.imageExtent              = extent;
+        createInfo.imageArrayLayers         = 1;
+        createInfo.imageUsage               = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+        // Specify how the images in the swap chain will be used across multiple queue families.
+        QueueFamilyIndices indices              = FindQueueFamilies( m_physicalDevice );
+        uint32_t           queueFamilyIndices[] = {indices.m_graphicsFamily.value(), indices.m_presentFamily.value()};
+        if ( indices.m_graphicsFamily != indices.m_presentFamily )
+        {
+            createInfo.imageSharingMode      = VK_SHARING_MODE_CONCURRENT;
+            createInfo.queueFamilyIndexCount = 2;
+            createInfo.pQueueFamilyIndices   = queueFamilyIndices;
+        }
+        else
+        {
+            createInfo.imageSharingMode      = VK_SHARING_MODE_EXCLUSIVE;
+            createInfo.queueFamilyIndexCount = 0;       // Optional
+            createInfo.pQueueFamilyIndices   = nullptr; // Optional
+        }
+
+        // No transformation.
+        createInfo.preTransform = swapChainSupport.m_capabilities.currentTransform;
+
+        // Don't alpha-blend with other windows.
+        createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+
+        // Present mode.
+        createInfo.presentMode = presentMode;
+
+        // Do we care about the color of pixels obscured by a window in the front?
+        createInfo.clipped = VK_TRUE;
+
+        // The swap chain being replaced, if any.
+        createInfo.oldSwapchain = i_oldSwapChain;
+
+        if ( vkCreateSwapchainKHR( m_device, &createInfo, nullptr, &m_swapChain ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "failed to create swap chain!" );
+        }
+
+        // Get handles to swap chain images, which we will render into.
+        vkGetSwapchainImagesKHR( m_device, m_swapChain, &imageCount, nullptr );
+        m_swapChainImages.resize( imageCount );
+        vkGetSwapchainImagesKHR( m_device, m_swapChain, &imageCount, m_swapChainImages.data() );
+
+        // Cache image format & extent.
+        m_swapChainImageFormat = surfaceFormat.format;
+        m_swapChainExtent      = extent;
+
+        // None of the new images are in use yet.
+        m_imageFrameNumbersInFlight.assign( m_swapChainImages.size(), 0 );
+
+        if ( i_oldSwapChain == VK_NULL_HANDLE )
+        {
+            printf( "Swap chain: %zu images, present mode %s, %u frames in flight.\n",
+                    m_swapChainImages.size(),
+                    GetPresentModeName( presentMode ),
+                    m_options.m_framesInFlight );
+        }
+    }
+
+    /// Create device-local images to render into, in place of the swap chain images, for headless mode.
+    void CreateOffscreenImages()
+    {
+        m_swapChainImageFormat = s_offscreenImageFormat;
+        m_swapChainExtent      = {static_cast< uint32_t >( m_windowWidth ), static_cast< uint32_t >( m_windowHeight )};
+
+        m_swapChainImages.resize( m_options.m_framesInFlight );
+        m_offscreenImageMemory.resize( m_options.m_framesInFlight );
+        for ( size_t imageIndex = 0; imageIndex < m_swapChainImages.size(); ++imageIndex )
+        {
+            VkImageCreateInfo imageInfo = {};
+            imageInfo.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType         = VK_IMAGE_TYPE_2D;
+            imageInfo.format            = m_swapChainImageFormat;
+            imageInfo.extent            = {m_swapChainExtent.width, m_swapChainExtent.height, 1};
+            imageInfo.mipLevels         = 1;
+            imageInfo.arrayLayers       = 1;
+            imageInfo.samples           = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling            = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            // Rendered into, then optionally copied out for read back.
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+            if ( vkCreateImage( m_device, &imageInfo, nullptr, &m_swapChainImages[ imageIndex ] ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to create offscreen image." );
+            }
+
+            VkMemoryRequirements memoryRequirements;
+            vkGetImageMemoryRequirements( m_device, m_swapChainImages[ imageIndex ], &memoryRequirements );
+
+            VkMemoryAllocateInfo allocInfo = {};
+            allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize       = memoryRequirements.size;
+            allocInfo.memoryTypeIndex =
+                FindMemoryType( memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+
+            if ( vkAllocateMemory( m_device, &allocInfo, nullptr, &m_offscreenImageMemory[ imageIndex ] ) !=
+                 VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to allocate offscreen image memory." );
+            }
+
+            vkBindImageMemory( m_device, m_swapChainImages[ imageIndex ], m_offscreenImageMemory[ imageIndex ], 0 );
+        }
+    }
+
+    void TeardownOffscreenImages()
+    {
+        for ( size_t imageIndex = 0; imageIndex < m_swapChainImages.size(); ++imageIndex )
+        {
+            vkDestroyImage( m_device, m_swapChainImages[ imageIndex ], nullptr );
+            vkFreeMemory( m_device, m_offscreenImageMemory[ imageIndex ], nullptr );
+        }
+
+        m_swapChainImages.clear();
+        m_offscreenImageMemory.clear();
+    }
+
+    /// Copy the rendered image at \p i_imageIndex back to the host, and write it to \p i_filePath as a
+    /// binary PPM image.
+    void WriteImage( uint32_t i_imageIndex, const std::string& i_filePath )
+    {
+        const VkDeviceSize imageSize = m_swapChainExtent.width * m_swapChainExtent.height * 4;
+
+        // Host visible buffer to copy the image into.
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size               = imageSize;
+        bufferInfo.usage              = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkBuffer readbackBuffer;
+        if ( vkCreateBuffer( m_device, &bufferInfo, nullptr, &readbackBuffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create read back buffer." );
+        }
+
+        VkMemoryRequirements memoryRequirements;
+        vkGetBufferMemoryRequirements( m_device, readbackBuffer, &memoryRequirements );
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize       = memoryRequirements.size;
+        allocInfo.memoryTypeIndex      = FindMemoryType( memoryRequirements.memoryTypeBits,
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+
+        VkDeviceMemory readbackMemory;
+        if ( vkAllocateMemory( m_device, &allocInfo, nullptr, &readbackMemory ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to allocate read back memory." );
+        }
+
+        vkBindBufferMemory( m_device, readbackBuffer, readbackMemory, 0 );
+
+        // Record the copy.
+        VkCommandBufferAllocateInfo commandBufferInfo = {};
+        commandBufferInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        commandBufferInfo.commandPool                 = m_commandPool;
+        commandBufferInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        commandBufferInfo.commandBufferCount          = 1;
+
+        VkCommandBuffer commandBuffer;
+        if ( vkAllocateCommandBuffers( m_device, &commandBufferInfo, &commandBuffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to allocate read back command buffer." );
+        }
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer( commandBuffer, &beginInfo );
+
+        // Make the color attachment writes of the render pass visible to the transfer.
+        VkImageMemoryBarrier barrier            = {};
+        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask                   = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask                   = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.oldLayout                       = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image                           = m_swapChainImages[ i_imageIndex ];
+        barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel   = 0;
+        barrier.subresourceRange.levelCount     = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount     = 1;
+        vkCmdPipelineBarrier( commandBuffer,
+                              VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              0,
+                              0,
+                              nullptr,
+                              0,
+                              nullptr,
+                              1,
+                              &barrier );
+
+        VkBufferImageCopy region               = {};
+        region.bufferOffset                    = 0;
+        region.bufferRowLength                 = 0; // Tightly packed.
+        region.bufferImageHeight               = 0;
+        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel       = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount     = 1;
+        region.imageOffset                     = {0, 0, 0};
+        region.imageExtent                     = {m_swapChainExtent.width, m_swapChainExtent.height, 1};
+        vkCmdCopyImageToBuffer( commandBuffer,
+                                m_swapChainImages[ i_imageIndex ],
+                                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                readbackBuffer,
+                                1,
+                                &region );
+
+        vkEndCommandBuffer( commandBuffer );
+
+        vkbase::Submission submission;
+        submission.AddCommandBuffer( commandBuffer );
+        if ( m_graphicsQueue.Submit( submission ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to submit read back command buffer." );
+        }
+
+        m_graphicsQueue.WaitIdle();
+        vkFreeCommandBuffers( m_device, m_commandPool, 1, &commandBuffer );
+
+        // Write out the RGB channels.
+        void* data = nullptr;
+        vkMapMemory( m_device, readbackMemory, 0, imageSize, 0, &data );
+
+        std::ofstream file( i_filePath, std::ios::binary );
+        if ( !file.is_open() )
+        {
+            throw std::runtime_error( "Failed to open " + i_filePath + " for writing." );
+        }
+
+        file << "P6\n" << m_swapChainExtent.width << " " << m_swapChainExtent.height << "\n255\n";
+        const char* pixels = static_cast< const char* >( data );
+        for ( VkDeviceSize pixelIndex = 0; pixelIndex < imageSize / 4; ++pixelIndex )
+        {
+            file.write( pixels + pixelIndex * 4, 3 );
+        }
+
+        file.close();
+        vkUnmapMemory( m_device, readbackMemory );
+
+        vkDestroyBuffer( m_device, readbackBuffer, nullptr );
+        vkFreeMemory( m_device, readbackMemory, nullptr );
+
+        printf( "Wrote frame to %s.\n", i_filePath.c_str() );
+    }
+
+    void TeardownSwapChain()
+    {
+        m_frameGraph.Teardown( m_allocator );
+
+        vkDestroyQueryPool( m_device, m_timestampQueryPool, nullptr );
+
+        for ( VkImageView imageView : m_swapChainImageViews )
+        {
+            vkDestroyImageView( m_device, imageView, nullptr );
+        }
+
+        if ( m_options.m_headless )
+        {
+            TeardownOffscreenImages();
+        }
+        else
+        {
+            vkDestroySwapchainKHR( m_device, m_swapChain, nullptr );
+        }
+    }
+
+    /// Hand the current swap chain and its dependent objects over to the deletion queue, to be destroyed once
+    /// the frames submitted so far have completed.  The retired swap chain handle stays valid until then, so it
+    /// can be passed as the old swap chain when creating its replacement.
+    void RetireSwapChain()
+    {
+        VkDevice                              device     = m_device;
+        VkSwapchainKHR                        swapChain  = m_swapChain;
+        VkQueryPool                           queryPool  = m_timestampQueryPool;
+        std::vector< VkImageView >            imageViews = std::move( m_swapChainImageViews );
+        vkbase::MemoryAllocator*              allocator  = &m_allocator;
+        std::shared_ptr< vkbase::FrameGraph > frameGraph =
+            std::make_shared< vkbase::FrameGraph >( std::move( m_frameGraph ) );
+
+        m_swapChainImageViews.clear();
+        m_frameGraph = vkbase::FrameGraph();
+
+        m_deletionQueue.Push( m_frameNumber, [=]() {
+            frameGraph->Teardown( *allocator );
+
+            vkDestroyQueryPool( device, queryPool, nullptr );
+
+            for ( VkImageView imageView : imageViews )
+            {
+                vkDestroyImageView( device, imageView, nullptr );
+            }
+
+            vkDestroySwapchainKHR( device, swapChain, nullptr );
+        } );
+    }
+
+    /// Hand the graphics pipeline over to the deletion queue.
+    void RetirePipeline()
+    {
+        VkDevice         device           = m_device;
+        VkPipeline       graphicsPipeline = m_graphicsPipeline;
+        VkPipelineLayout pipelineLayout   = m_pipelineLayout;
+
+        std::shared_ptr< vkbase::PipelinePermutations > pipelineVariants =
+            std::make_shared< vkbase::PipelinePermutations >( std::move( m_pipelineVariants ) );
+        m_pipelineVariants = vkbase::PipelinePermutations();
+
+        m_deletionQueue.Push( m_frameNumber, [=]() {
+            pipelineVariants->Teardown( device );
+            vkDestroyPipeline( device, graphicsPipeline, nullptr );
+            vkDestroyPipelineLayout( device, pipelineLayout, nullptr );
+        } );
+    }
+
+    /// Teardown the graphics pipeline.  It only depends on the format of the swap chain images (not the extent),
+    /// so it is kept across swap chain recreation unless the format changes: the render passes of the rebuilt
+    /// frame graph are compatible with the one it was created against.
+    void TeardownPipeline()
+    {
+        m_pipelineVariants.Teardown( m_device );
+        vkDestroyPipeline( m_device, m_graphicsPipeline, nullptr );
+        vkDestroyPipelineLayout( m_device, m_pipelineLayout, nullptr );
+    }
+
+    void RecreateSwapChain()
+    {
+        // Pause application on minimization.
+        int width = 0, height = 0;
+        do
+        {
+            glfwGetFramebufferSize( m_window, &width, &height );
+            glfwWaitEvents();
+        } while ( width == 0 || height == 0 );
+
+        m_framebufferResized = false;
+
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+        // A pipeline being rebuilt from reloaded shaders uses the scene pass of the current frame graph, so
+        // finish that first.
+        std::lock_guard< std::mutex > lock( m_shaderReloadMutex );
+
+        // The device is not drained: frames in flight keep executing against the old swap chain, whose
+        // objects are destroyed through the deletion queue once those frames have completed.
+        VkSwapchainKHR oldSwapChain = m_swapChain;
+        RetireSwapChain();
+
+        VkFormat previousImageFormat = m_swapChainImageFormat;
+        CreateSwapChain( oldSwapChain );
+        CreateImageViews();
+        CreateFrameGraph();
+
+        // The viewport and scissor are dynamic state, so the pipeline only needs to be rebuilt if the
+        // render pass is no longer compatible with the swap chain images.
+        if ( m_swapChainImageFormat != previousImageFormat )
+        {
+            RetirePipeline();
+            CreateGraphicsPipeline();
+
+            // A reloaded pipeline waiting to be swapped in is not compatible with the new format, but the pipeline
+            // just created already uses the reloaded shaders.
+            if ( m_reloadedPipeline != VK_NULL_HANDLE )
+            {
+                vkDestroyPipeline( m_device, m_reloadedPipeline, nullptr );
+                m_reloadedPipelineVariants.Teardown( m_device );
+                m_reloadedPipeline = VK_NULL_HANDLE;
+                m_reloadedPipelineReady.store( false, std::memory_order_relaxed );
+            }
+        }
+
+        CreateTimestampQueryPool();
+
+        m_swapChainRecreationCount++;
+        printf( "Recreated swap chain in %.3f ms.\n", GetMillisecondsSince( startTime ) );
+    }
+
+    void CreateSurface()
+    {
+        if ( glfwCreateWindowSurface( m_instance, m_window, nullptr, &m_surface ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create window surface." );
+        }
+    }
+
+    void CreateImageViews()
+    {
+        m_swapChainImageViews.resize( m_swapChainImages.size() );
+        for ( size_t imageIndex = 0; imageIndex < m_swapChainImages.size(); imageIndex++ )
+        {
+            VkImageViewCreateInfo createInfo = {};
+            createInfo.sType                 = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            createInfo.image                 = m_swapChainImages[ imageIndex ];
+            createInfo.viewType              = VK_IMAGE_VIEW_TYPE_2D;
+            createInfo.format                = m_swapChainImageFormat;
+
+            // Do not remap components.
+            createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+            createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+            createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+            createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+            // For displaying color.
+            createInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            createInfo.subresourceRange.baseMipLevel   = 0;
+            createInfo.subresourceRange.levelCount     = 1;
+            createInfo.subresourceRange.baseArrayLayer = 0;
+            createInfo.subresourceRange.layerCount     = 1;
+
+            if ( vkCreateImageView( m_device, &createInfo, nullptr, &m_swapChainImageViews[ imageIndex ] ) !=
+                 VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to create image views." );
+            }
+        }
+    }
+
+    /// Create the pipeline cache, seeded from disk when a compatible cache from a previous run is found.  Unless a
+    /// path is given, each device has a file of its own, so switching devices does not discard the cache of another.
+    void CreatePipelineCache()
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties( m_physicalDevice, &properties );
+
+        if ( m_options.m_usePipelineCache )
+        {
+            m_pipelineCachePath = !m_options.m_pipelineCachePath.empty()
+                                      ? m_options.m_pipelineCachePath
+                                      : vkbase::GetDefaultPipelineCachePath(
+                                            vkbase::GetPipelineCacheFileName( "vulkanexamples-triangle", properties ) );
+        }
+
+        m_pipelineCache =
+            vkbase::CreatePipelineCache( m_device, properties, m_pipelineCachePath, m_pipelineCacheLoaded );
+        printf( "Pipeline cache: %s%s%s.\n",
+                m_pipelineCacheLoaded ? "warm" : "cold",
+                m_pipelineCachePath.empty() ? "" : ", ",
+                m_pipelineCachePath.c_str() );
+    }
+
+    /// Write the pipeline cache back to disk, for the next run.
+    void SavePipelineCache()
+    {
+        if ( m_pipelineCachePath.empty() )
+        {
+            return;
+        }
+
+        if ( !vkbase::SavePipelineCache( m_device, m_pipelineCache, m_pipelineCachePath ) )
+        {
+            printf( "Failed to save pipeline cache: %s.\n", m_pipelineCachePath.c_str() );
+        }
+    }
+
+    /// The number of milliseconds elapsed since \p i_startTime.
+    static double GetMillisecondsSince( const std::chrono::steady_clock::time_point& i_startTime )
+    {
+        return std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - i_startTime ).count();
+    }
+
+    /// Get the shader module of the compiled shader \p i_fileName: from its latest recompile when watching shaders,
+    /// from the SPIR-V embedded into the executable, if built with embedded shaders, otherwise from the shaders
+    /// directory next to the executable's.  Once shaders are watched, the caller must hold m_shaderReloadMutex.
+    VkShaderModule GetShaderModule( const std::string& i_fileName )
+    {
+        std::map< std::string, std::string >::const_iterator reloadedIt = m_reloadedShaderPaths.find( i_fileName );
+        if ( reloadedIt != m_reloadedShaderPaths.end() )
+        {
+            return m_shaderRegistry.GetShaderModule( reloadedIt->second );
+        }
+
+        const vkbase::EmbeddedShader* embeddedShader = vkbase::FindEmbeddedShader( i_fileName );
+        if ( embeddedShader != nullptr )
+        {
+            return m_shaderRegistry.GetShaderModule( i_fileName, embeddedShader->m_code, embeddedShader->m_size );
+        }
+
+        std::string executableDir   = vkbase::GetParentPath( m_executablePath );
+        std::string shaderDirectory = vkbase::JoinPaths( executableDir, "../shaders/" );
+        return m_shaderRegistry.GetShaderModule( vkbase::JoinPaths( shaderDirectory, i_fileName ) );
+    }
+
+    /// Choose the format of the depth buffer: the one requested on the command line, otherwise the most precise
+    /// format which the device supports as a depth attachment, with optimal tiling.
+    void ChooseDepthFormat()
+    {
+        m_depthFormat = VK_FORMAT_UNDEFINED;
+        if ( !m_options.m_depthTest )
+        {
+            return;
+        }
+
+        for ( const std::pair< const char*, VkFormat >& depthFormat : s_depthFormats )
+        {
+            if ( m_options.m_depthFormat != VK_FORMAT_UNDEFINED && m_options.m_depthFormat != depthFormat.second )
+            {
+                continue;
+            }
+
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties( m_physicalDevice, depthFormat.second, &formatProperties );
+            if ( formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT )
+            {
+                m_depthFormat = depthFormat.second;
+                printf( "Depth format: %s.\n", depthFormat.first );
+                return;
+            }
+        }
+
+        if ( m_options.m_depthFormat != VK_FORMAT_UNDEFINED )
+        {
+            throw std::runtime_error( std::string( "Depth format " ) + GetDepthFormatName( m_options.m_depthFormat ) +
+                                      " is not supported by the device." );
+        }
+
+        throw std::runtime_error( "Failed to find a supported depth format." );
+    }
+
+    /// Choose the number of samples per pixel: the largest count, up to the one requested, which the device
+    /// supports for both the color and depth attachments.
+    void ChooseSampleCount()
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties( m_physicalDevice, &properties );
+
+        VkSampleCountFlags supportedCounts = properties.limits.framebufferColorSampleCounts;
+        if ( m_depthFormat != VK_FORMAT_UNDEFINED )
+        {
+            supportedCounts &= properties.limits.framebufferDepthSampleCounts;
+        }
+
+        m_sampleCount = VK_SAMPLE_COUNT_1_BIT;
+        for ( uint32_t sampleCount = m_options.m_sampleCount; sampleCount > 1; sampleCount /= 2 )
+        {
+            if ( supportedCounts & sampleCount )
+            {
+                m_sampleCount = static_cast< VkSampleCountFlagBits >( sampleCount );
+                break;
+            }
+        }
+
+        if ( m_sampleCount != m_options.m_sampleCount )
+        {
+            printf( "%u samples per pixel are not supported, using %u.\n",
+                    m_options.m_sampleCount,
+                    static_cast< uint32_t >( m_sampleCount ) );
+        }
+    }
+
+    /// Build and compile the frame graph rendering into the swap chain images.  Rebuilt along with the swap chain.
+    void CreateFrameGraph()
+    {
+        m_frameGraph = vkbase::FrameGraph();
+
+        vkbase::FrameGraphImageDesc colorDesc;
+        colorDesc.m_format = m_swapChainImageFormat;
+        colorDesc.m_extent = m_swapChainExtent;
+
+        // Swap chain images are written once acquired, which the submission waits for at the color attachment
+        // output stage.  They are then ready for presentation, or for read back when rendering offscreen.
+        vkbase::FrameGraphImageState initialState = {
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0};
+        vkbase::FrameGraphImageState finalState = {
+            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0};
+        if ( m_options.m_headless )
+        {
+            finalState = {
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+        }
+
+        vkbase::FrameGraphImage swapChainImage =
+            m_frameGraph.ImportImage( "swapChain", colorDesc, m_swapChainImageViews, initialState, finalState );
+
+        // The draws are recorded inline, or into secondary command buffers by the job system.
+        m_scenePass = m_frameGraph.AddPass( "scene",
+                                            m_options.m_recordThreads == 0
+                                                ? VK_SUBPASS_CONTENTS_INLINE
+                                                : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS,
+                                            [this]( VkCommandBuffer i_commandBuffer, uint32_t i_imageIndex ) {
+                                                RecordScenePass( i_commandBuffer, i_imageIndex );
+                                            } );
+        // With multisampling, the scene is rendered into a transient multisampled image, resolved into the swap
+        // chain image at the end of the pass.  Like the depth buffer, it never needs to leave tile memory.
+        if ( m_sampleCount == VK_SAMPLE_COUNT_1_BIT )
+        {
+            m_frameGraph.AddColorAttachment(
+                m_scenePass, swapChainImage, VK_ATTACHMENT_LOAD_OP_CLEAR, {0.0f, 0.0f, 0.0f, 1.0f} );
+        }
+        else
+        {
+            vkbase::FrameGraphImageDesc multisampledDesc = colorDesc;
+            multisampledDesc.m_samples                   = m_sampleCount;
+
+            vkbase::FrameGraphImage multisampledImage =
+                m_frameGraph.CreateImage( "multisampledColor", multisampledDesc );
+            m_frameGraph.AddColorAttachment(
+                m_scenePass, multisampledImage, VK_ATTACHMENT_LOAD_OP_CLEAR, {0.0f, 0.0f, 0.0f, 1.0f} );
+            m_frameGraph.AddResolveAttachment( m_scenePass, multisampledImage, swapChainImage );
+        }
+
+        // The depth buffer is transient: it is cleared by the scene pass and not read after, so it is neither
+        // stored nor, where the device supports it, backed by memory.
+        if ( m_depthFormat != VK_FORMAT_UNDEFINED )
+        {
+            vkbase::FrameGraphImageDesc depthDesc;
+            depthDesc.m_format  = m_depthFormat;
+            depthDesc.m_extent  = m_swapChainExtent;
+            depthDesc.m_samples = m_sampleCount;
+
+            vkbase::FrameGraphImage depthImage = m_frameGraph.CreateImage( "depth", depthDesc );
+            m_frameGraph.SetDepthAttachment( m_scenePass, depthImage, VK_ATTACHMENT_LOAD_OP_CLEAR, {1.0f, 0} );
+        }
+
+        m_frameGraph.Compile( m_device, m_allocator );
+
+        VkDeviceSize transientMemorySize = 0;
+        VkDeviceSize unaliasedMemorySize = 0;
+        m_frameGraph.GetTransientMemorySize( transientMemorySize, unaliasedMemorySize );
+        printf( "Compiled frame graph: %u passes, %u dependencies, %.1f MiB of transient images "
+                "(%.1f MiB unaliased, %u lazily allocated).\n",
+                m_frameGraph.GetPassCount(),
+                m_frameGraph.GetDependencyCount(),
+                transientMemorySize / ( 1024.0 * 1024.0 ),
+                unaliasedMemorySize / ( 1024.0 * 1024.0 ),
+                m_frameGraph.GetLazilyAllocatedImageCount() );
+    }
+
+    /// Compile a frame graph of m_frameGraphChainLength post-processing passes, each rendering a transient image
+    /// of the size of the swap chain while sampling the one written by the pass before it, followed by a pass
+    /// writing the swap chain image.  Only two images of the chain are live at once, so the rest alias their
+    /// memory.  Print the transient memory allocated, against the memory needed without aliasing, then destroy the
+    /// graph.  Its passes are never executed.
+    void ReportFrameGraphAliasing()
+    {
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+        vkbase::FrameGraph frameGraph;
+
+        vkbase::FrameGraphImageDesc colorDesc;
+        colorDesc.m_format = m_swapChainImageFormat;
+        colorDesc.m_extent = m_swapChainExtent;
+
+        vkbase::FrameGraphImageState initialState = {
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0};
+        vkbase::FrameGraphImageState finalState = {
+            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0};
+        if ( m_options.m_headless )
+        {
+            finalState = {
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+        }
+
+        vkbase::FrameGraphImage swapChainImage =
+            frameGraph.ImportImage( "swapChain", colorDesc, m_swapChainImageViews, initialState, finalState );
+
+        vkbase::FrameGraphImage previousImage = swapChainImage;
+        for ( uint32_t passIndex = 0; passIndex <= m_options.m_frameGraphChainLength; ++passIndex )
+        {
+            const std::string      name = "chain" + std::to_string( passIndex );
+            vkbase::FrameGraphPass pass =
+                frameGraph.AddPass( name, VK_SUBPASS_CONTENTS_INLINE, []( VkCommandBuffer, uint32_t ) {} );
+            if ( passIndex > 0 )
+            {
+                frameGraph.AddSampledImage( pass, previousImage, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT );
+            }
+
+            // The last pass writes the swap chain image, so that no pass of the chain is culled.
+            vkbase::FrameGraphImage image = passIndex == m_options.m_frameGraphChainLength
+                                                ? swapChainImage
+                                                : frameGraph.CreateImage( name, colorDesc );
+            frameGraph.AddColorAttachment( pass, image, VK_ATTACHMENT_LOAD_OP_CLEAR, {0.0f, 0.0f, 0.0f, 1.0f} );
+            previousImage = image;
+        }
+
+        frameGraph.Compile( m_device, m_allocator );
+
+        VkDeviceSize transientMemorySize = 0;
+        VkDeviceSize unaliasedMemorySize = 0;
+        frameGraph.GetTransientMemorySize( transientMemorySize, unaliasedMemorySize );
+        printf( "Frame graph chain of %u passes: %.1f MiB of transient images aliased, %.1f MiB unaliased "
+                "(%.1f%% saved), compiled in %.3f ms.\n",
+                frameGraph.GetPassCount(),
+                transientMemorySize / ( 1024.0 * 1024.0 ),
+                unaliasedMemorySize / ( 1024.0 * 1024.0 ),
+                unaliasedMemorySize > 0 ? 100.0 * ( unaliasedMemorySize - transientMemorySize ) / unaliasedMemorySize
+                                        : 0.0,
+                GetMillisecondsSince( startTime ) );
+
+        frameGraph.Teardown( m_allocator );
+    }
+
+    void CreateGraphicsPipeline()
     {
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+        // Pipeline layout.
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        VkPushConstantRange pushConstantRange = {};
+        pushConstantRange.stageFlags          = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset              = 0;
+        pushConstantRange.size                = sizeof( DrawParameters );
+
+        pipelineLayoutInfo.setLayoutCount         = 1;
+        pipelineLayoutInfo.pSetLayouts            = &m_descriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
+        if ( vkCreatePipelineLayout( m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "failed to create pipeline layout!" );
+        }
+
+        // Shader modules are owned by the registry, so rebuilding the pipeline does not read the files again.
+        VkShaderModule vertShaderModule = GetShaderModule( GetGraphicsShaderName( 0 ) );
+        VkShaderModule fragShaderModule = GetShaderModule( GetGraphicsShaderName( 1 ) );
+        m_graphicsPipeline = BuildGraphicsPipeline( vertShaderModule, fragShaderModule, GetPipelineVariant() );
+
+        printf( "Created graphics pipeline in %.3f ms.\n", GetMillisecondsSince( startTime ) );
+
+        BuildPipelineVariants( vertShaderModule, fragShaderModule, m_pipelineVariants );
+        if ( m_options.m_drawVariant.has_value() )
+        {
+            m_drawnPipelineVariant = GetPipelineVariants()[ m_options.m_drawVariant.value() ];
+        }
     }
 
-    /// Begin executing the TriangleApplication.
-    void Run()
+    /// File name of the compiled vertex shader of the graphics pipeline if \p i_stageIndex is 0, or of its fragment
+    /// shader if 1.  Bindless descriptors are indexed by shaders of their own.
+    const char* GetGraphicsShaderName( size_t i_stageIndex ) const
     {
-        InitWindow();
-        InitVulkan();
-        MainLoop();
-        Teardown();
+        static const char* const s_shaderNames[ 2 ]         = {"shader.vert.spv", "shader.frag.spv"};
+        static const char* const s_bindlessShaderNames[ 2 ] = {"bindless.vert.spv", "bindless.frag.spv"};
+        return m_options.m_bindless ? s_bindlessShaderNames[ i_stageIndex ] : s_shaderNames[ i_stageIndex ];
     }
 
-private:
-    /// \struct SwapChainSupportDetails
-    ///
-    /// Swap chain details.
-    struct SwapChainSupportDetails
+    /// The variant of the graphics pipeline drawn with: the default state, specialized with the options.
+    vkbase::PipelineVariant GetPipelineVariant() const
     {
-        VkSurfaceCapabilitiesKHR          m_capabilities;
-        std::vector< VkSurfaceFormatKHR > m_formats;
-        std::vector< VkPresentModeKHR >   m_presentModes;
-    };
+        FragmentSpecialization specialization;
+        specialization.Set< FragmentConstant_ShadingIterations >( m_options.m_shadingIterations );
 
-    /// \struct QueueFamilyIndices
-    ///
-    /// Internal structure for encoding queue family support, queried from the physical device.
-    struct QueueFamilyIndices
+        vkbase::PipelineVariant variant;
+        specialization.ApplyTo( variant );
+        return variant;
+    }
+
+    /// The requested number of permutations of the graphics pipeline.  They cycle through the combinations of
+    /// topology, culling and blending, then differ by the number of shading iterations specialized into the
+    /// fragment shader, so each is a distinct pipeline to the driver.
+    std::vector< vkbase::PipelineVariant > GetPipelineVariants() const
     {
-        std::optional< uint32_t > m_graphicsFamily;
-        std::optional< uint32_t > m_presentFamily;
+        std::vector< vkbase::PipelineVariant > variants( m_options.m_pipelineVariantCount );
+        for ( uint32_t variantIndex = 0; variantIndex < m_options.m_pipelineVariantCount; ++variantIndex )
+        {
+            vkbase::PipelineVariant& variant = variants[ variantIndex ];
+            SetPipelineVariantState( variantIndex, variant );
 
-        /// Convenience method for checking if all the queue families that are required for this application
-        /// are found.
-        bool IsComplete()
+            FragmentSpecialization specialization;
+            specialization.Set< FragmentConstant_ShadingIterations >( m_options.m_shadingIterations +
+                                                                      variantIndex / s_pipelineVariantStateCount );
+            specialization.ApplyTo( variant );
+        }
+
+        return variants;
+    }
+
+    /// Build the permutations of the graphics pipeline from \p i_vertShaderModule and \p i_fragShaderModule into
+    /// \p io_variants, in parallel.  Called on the shader watcher thread when shaders are reloaded.
+    void BuildPipelineVariants( VkShaderModule                i_vertShaderModule,
+                                VkShaderModule                i_fragShaderModule,
+                                vkbase::PipelinePermutations& io_variants ) const
+    {
+        if ( m_options.m_pipelineVariantCount == 0 )
         {
-            return m_graphicsFamily.has_value() && m_presentFamily.has_value();
+            return;
         }
-    };
 
-    static void FramebufferResizeCallback( GLFWwindow* i_window, int i_width, int i_height )
+        std::vector< vkbase::PipelineVariant > variants = GetPipelineVariants();
+
+        uint32_t threadCount = m_options.m_pipelineBuildThreads;
+        if ( threadCount == 0 )
+        {
+            threadCount = std::max( std::thread::hardware_concurrency(), 1u );
+        }
+
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+        vkbase::JobSystem                           jobSystem( threadCount );
+        vkbase::PipelinePermutations::BuildFunction buildFunction = [&]( const vkbase::PipelineVariant& i_variant ) {
+            return BuildGraphicsPipeline( i_vertShaderModule, i_fragShaderModule, i_variant );
+        };
+        size_t builtCount = io_variants.Build( m_device, jobSystem, variants, buildFunction );
+
+        const double milliseconds = GetMillisecondsSince( startTime );
+        printf( "Built %zu pipeline variants on %u thread(s) in %.3f ms (%.3f ms per variant).\n",
+                builtCount,
+                threadCount,
+                milliseconds,
+                builtCount > 0 ? milliseconds / builtCount : 0.0 );
+    }
+
+    /// Build a graphics pipeline from \p i_vertShaderModule and \p i_fragShaderModule, with the current pipeline
+    /// layout, compatible with the scene pass of the current frame graph, and the state of \p i_variant.  Called
+    /// on the shader watcher thread when shaders are reloaded, and on several threads at once when building
+    /// variants, so only reads state which is not modified without holding m_shaderReloadMutex.
+    VkPipeline BuildGraphicsPipeline( VkShaderModule                 i_vertShaderModule,
+                                      VkShaderModule                 i_fragShaderModule,
+                                      const vkbase::PipelineVariant& i_variant ) const
     {
-        TriangleApplication* app  = reinterpret_cast< TriangleApplication* >( glfwGetWindowUserPointer( i_window ) );
-        app->m_framebufferResized = true;
+        VkSpecializationInfo        specializationInfo;
+        const VkSpecializationInfo* pSpecializationInfo = i_variant.GetSpecializationInfo( specializationInfo );
+
+        // Create info for vertex shader pipeline stage.
+        VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+        vertShaderStageInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        vertShaderStageInfo.stage                           = VK_SHADER_STAGE_VERTEX_BIT;
+        vertShaderStageInfo.module                          = i_vertShaderModule;
+        vertShaderStageInfo.pName                           = "main";
+        vertShaderStageInfo.pSpecializationInfo             = pSpecializationInfo;
+
+        // Create info for fragment shader pipeline stage.
+        VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
+        fragShaderStageInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        fragShaderStageInfo.stage                           = VK_SHADER_STAGE_FRAGMENT_BIT;
+        fragShaderStageInfo.module                          = i_fragShaderModule;
+        fragShaderStageInfo.pName                           = "main";
+        fragShaderStageInfo.pSpecializationInfo             = pSpecializationInfo;
+
+        // Shader stages.
+        VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+
+        // Vertex input stage.
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+        vertexInputInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        VkVertexInputBindingDescription bindingDescription = Vertex::GetBindingDescription();
+        std::array< VkVertexInputAttributeDescription, 2 > attributeDescriptions = Vertex::GetAttributeDescriptions();
+        vertexInputInfo.vertexBindingDescriptionCount                            = 1;
+        vertexInputInfo.pVertexBindingDescriptions                               = &bindingDescription;
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast< uint32_t >( attributeDescriptions.size() );
+        vertexInputInfo.pVertexAttributeDescriptions    = attributeDescriptions.data();
+
+        // Input assembly, describing what kind of geometry will be drawn.
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+        inputAssembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology               = i_variant.m_topology;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        // Viewport state.  The viewport and scissor themselves are dynamic, and set when recording command
+        // buffers, so the pipeline does not depend on the extent of the swap chain.
+        VkPipelineViewportStateCreateInfo viewportState = {};
+        viewportState.sType                             = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount                     = 1;
+        viewportState.pViewports                        = nullptr;
+        viewportState.scissorCount                      = 1;
+        viewportState.pScissors                         = nullptr;
+
+        // Dynamic state.
+        VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+        VkPipelineDynamicStateCreateInfo dynamicState = {};
+        dynamicState.sType                            = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount                = 2;
+        dynamicState.pDynamicStates                   = dynamicStates;
+
+        // Rasterizer, for converting geometry shapes into fragments for shading.
+        VkPipelineRasterizationStateCreateInfo rasterizer = {};
+        rasterizer.sType                                  = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.depthClampEnable                       = VK_FALSE;
+        rasterizer.rasterizerDiscardEnable                = VK_FALSE;
+        rasterizer.polygonMode                            = VK_POLYGON_MODE_FILL;
+        rasterizer.lineWidth                              = 1.0f;
+        rasterizer.cullMode                               = i_variant.m_cullMode;
+        rasterizer.frontFace                              = VK_FRONT_FACE_CLOCKWISE;
+        rasterizer.depthBiasEnable                        = VK_FALSE;
+        rasterizer.depthBiasConstantFactor                = 0.0f; // Optional
+        rasterizer.depthBiasClamp                         = 0.0f; // Optional
+        rasterizer.depthBiasSlopeFactor                   = 0.0f; // Optional
+
+        // Multi-sampling for reducing edge aliasing.  The fragment shader runs once per pixel, not per sample.
+        VkPipelineMultisampleStateCreateInfo multisampling = {};
+        multisampling.sType                                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.sampleShadingEnable                  = VK_FALSE;
+        multisampling.rasterizationSamples                 = m_sampleCount;
+        multisampling.minSampleShading                     = 1.0f;     // Optional
+        multisampling.pSampleMask                          = nullptr;  // Optional
+        multisampling.alphaToCoverageEnable                = VK_FALSE; // Optional
+        multisampling.alphaToOneEnable                     = VK_FALSE; // Optional
+
+        // Depth testing, with the nearest fragment winning.  The fragment shader does not write depth, so
+        // fragments can be rejected before they are shaded.
+        VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+        depthStencil.sType                                 = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable                       = VK_TRUE;
+        depthStencil.depthWriteEnable                      = VK_TRUE;
+        depthStencil.depthCompareOp                        = VK_COMPARE_OP_LESS;
+        depthStencil.depthBoundsTestEnable                 = VK_FALSE;
+        depthStencil.stencilTestEnable                     = VK_FALSE;
+
+        // Color blending.
+        VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+        colorBlendAttachment.colorWriteMask =
+            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachment.blendEnable         = VK_FALSE;
+        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;  // Optional
+        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
+        colorBlendAttachment.colorBlendOp        = VK_BLEND_OP_ADD;      // Optional
+        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;  // Optional
+        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
+        colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;      // Optional
+        if ( i_variant.m_blendEnable )
+        {
+            // Alpha blending.
+            colorBlendAttachment.blendEnable         = VK_TRUE;
+            colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        }
+
+        // Aggregate of color attachments.
+        VkPipelineColorBlendStateCreateInfo colorBlending = {};
+        colorBlending.sType                               = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.logicOpEnable                       = VK_FALSE;
+        colorBlending.logicOp                             = VK_LOGIC_OP_COPY; // Optional
+        colorBlending.attachmentCount                     = 1;
+        colorBlending.pAttachments                        = &colorBlendAttachment;
+        colorBlending.blendConstants[ 0 ]                 = 0.0f; // Optional
+        colorBlending.blendConstants[ 1 ]                 = 0.0f; // Optional
+        colorBlending.blendConstants[ 2 ]                 = 0.0f; // Optional
+        colorBlending.blendConstants[ 3 ]                 = 0.0f; // Optional
+
+        // Now, create the pipeline!
+        VkGraphicsPipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType                        = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount                   = 2;                // Number of _programmable_ stages.
+        pipelineInfo.pStages                      = shaderStages;     // Array of programmable stages.
+        pipelineInfo.pVertexInputState            = &vertexInputInfo; // Vertex input.
+        pipelineInfo.pInputAssemblyState          = &inputAssembly;   // Input assembly.
+        pipelineInfo.pViewportState               = &viewportState;   // Viewport.
+        pipelineInfo.pRasterizationState          = &rasterizer;      // Rasterization state.
+        pipelineInfo.pMultisampleState            = &multisampling;   // Multi sampling.
+        pipelineInfo.pDepthStencilState           = m_depthFormat != VK_FORMAT_UNDEFINED ? &depthStencil : nullptr;
+        pipelineInfo.pColorBlendState             = &colorBlending;   // Color blending.
+        pipelineInfo.pDynamicState                = &dynamicState;    // Viewport & scissor.
+        pipelineInfo.layout                       = m_pipelineLayout; // Layout.
+        pipelineInfo.renderPass                   = m_frameGraph.GetRenderPass( m_scenePass );
+        pipelineInfo.subpass            = 0; // The index of the subpass, where this graphics pipeline will be used.
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Pipeline to derived from.  None, in this case.
+        pipelineInfo.basePipelineIndex  = -1;             // ???
+
+        VkPipeline pipeline;
+        if ( vkCreateGraphicsPipelines( m_device, m_pipelineCache, 1, &pipelineInfo, nullptr, &pipeline ) !=
+             VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create graphics pipeline." );
+        }
+
+        return pipeline;
     }
 
-    // Initialize a window.
-    void InitWindow()
+    /// Watch the GLSL sources of the graphics pipeline, if requested, recompiling them on a background thread.
+    void StartShaderWatcher()
     {
-        glfwInit();
+        if ( m_options.m_watchShadersDirectory.empty() )
+        {
+            return;
+        }
 
-        glfwWindowHint( GLFW_CLIENT_API, GLFW_NO_API );
+        const char* tempDirectory = getenv( "TMPDIR" );
 
-        m_window = glfwCreateWindow( m_windowWidth, m_windowHeight, m_windowTitle, nullptr, nullptr );
-        glfwSetWindowUserPointer( m_window, this );
-        glfwSetFramebufferSizeCallback( m_window, FramebufferResizeCallback );
+        std::vector< vkbase::WatchedShader > shaders;
+        for ( size_t stageIndex = 0; stageIndex < 2; ++stageIndex )
+        {
+            vkbase::WatchedShader shader;
+            shader.m_name       = GetGraphicsShaderName( stageIndex );
+            shader.m_sourcePath = vkbase::JoinPaths( m_options.m_watchShadersDirectory,
+                                                     shader.m_name.substr( 0, shader.m_name.size() - 4 ) );
+            shaders.push_back( shader );
+        }
+
+        m_shaderWatcher.Start( m_options.m_glslcPath,
+                               tempDirectory != nullptr ? tempDirectory : "/tmp",
+                               shaders,
+                               std::chrono::milliseconds( 250 ),
+                               [this]( const std::vector< vkbase::CompiledShader >& i_shaders ) {
+                                   ReloadShaders( i_shaders );
+                               } );
+        printf( "Watching shaders in %s.\n", m_options.m_watchShadersDirectory.c_str() );
     }
 
-    std::vector< const char* > GetRequiredExtensions() const
+    /// Create shader modules from \p i_shaders, just recompiled, and build a graphics pipeline from them, to be
+    /// swapped in at the start of the next frame.  Runs on the shader watcher thread.  If the pipeline fails to
+    /// build, the shaders are discarded, and the current pipeline kept.
+    void ReloadShaders( const std::vector< vkbase::CompiledShader >& i_shaders )
     {
-        // Enable gflw interface extensions.
-        uint32_t     glfwExtensionCount = 0;
-        const char** glfwExtensions     = glfwGetRequiredInstanceExtensions( &glfwExtensionCount );
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
 
-        std::vector< const char* > extensions( glfwExtensions, glfwExtensions + glfwExtensionCount );
-        if ( m_enableValidationLayers )
+        std::lock_guard< std::mutex >        lock( m_shaderReloadMutex );
+        std::map< std::string, std::string > previousPaths = m_reloadedShaderPaths;
+        try
         {
-            extensions.push_back( VK_EXT_DEBUG_UTILS_EXTENSION_NAME );
+            // Each recompile has a path of its own, so a module is created for each, before its file is removed.
+            for ( const vkbase::CompiledShader& shader : i_shaders )
+            {
+                m_shaderRegistry.GetShaderModule( shader.m_path );
+                m_reloadedShaderPaths[ shader.m_name ] = shader.m_path;
+            }
+
+            VkShaderModule vertShaderModule = GetShaderModule( GetGraphicsShaderName( 0 ) );
+            VkShaderModule fragShaderModule = GetShaderModule( GetGraphicsShaderName( 1 ) );
+            VkPipeline     pipeline =
+                BuildGraphicsPipeline( vertShaderModule, fragShaderModule, GetPipelineVariant() );
+
+            // The permutations are rebuilt from the same shaders, and swapped in along with the pipeline.
+            vkbase::PipelinePermutations variants;
+            try
+            {
+                BuildPipelineVariants( vertShaderModule, fragShaderModule, variants );
+            }
+            catch ( ... )
+            {
+                vkDestroyPipeline( m_device, pipeline, nullptr );
+                throw;
+            }
+
+            // A pipeline built by an earlier reload, but not yet swapped in, was never used.
+            if ( m_reloadedPipeline != VK_NULL_HANDLE )
+            {
+                vkDestroyPipeline( m_device, m_reloadedPipeline, nullptr );
+            }
+
+            m_reloadedPipelineVariants.Teardown( m_device );
+            m_reloadedPipelineVariants = std::move( variants );
+            m_reloadedPipeline         = pipeline;
+            m_reloadedPipelineReady.store( true, std::memory_order_release );
+            printf( "Rebuilt graphics pipeline in %.3f ms.\n", GetMillisecondsSince( startTime ) );
+        }
+        catch ( const std::exception& e )
+        {
+            m_reloadedShaderPaths = previousPaths;
+            printf( "Keeping the current graphics pipeline: %s\n", e.what() );
         }
+    }
 
-        return extensions;
+    /// Swap in the graphics pipeline, and its permutations, rebuilt by the shader watcher, if ready, retiring the
+    /// current ones.
+    /// Called at the start of a frame, before any command buffer binds the pipeline.  Never blocks: if the watcher
+    /// thread is busy, the swap is left to a later frame.
+    void SwapReloadedPipeline()
+    {
+        if ( !m_reloadedPipelineReady.load( std::memory_order_acquire ) )
+        {
+            return;
+        }
+
+        std::unique_lock< std::mutex > lock( m_shaderReloadMutex, std::try_to_lock );
+        if ( !lock.owns_lock() || m_reloadedPipeline == VK_NULL_HANDLE )
+        {
+            return;
+        }
+
+        VkDevice   device           = m_device;
+        VkPipeline graphicsPipeline = m_graphicsPipeline;
+        std::shared_ptr< vkbase::PipelinePermutations > pipelineVariants =
+            std::make_shared< vkbase::PipelinePermutations >( std::move( m_pipelineVariants ) );
+        m_deletionQueue.Push( m_frameNumber, [=]() {
+            pipelineVariants->Teardown( device );
+            vkDestroyPipeline( device, graphicsPipeline, nullptr );
+        } );
+
+        m_graphicsPipeline         = m_reloadedPipeline;
+        m_pipelineVariants         = std::move( m_reloadedPipelineVariants );
+        m_reloadedPipeline         = VK_NULL_HANDLE;
+        m_reloadedPipelineVariants = vkbase::PipelinePermutations();
+        m_reloadedPipelineReady.store( false, std::memory_order_relaxed );
+        m_pipelineSwapCount++;
     }
 
-    // Create the vulkan instance.
-    void CreateVulkanInstance()
+    /// Create the command pool for one-off commands, such as reading back images.
+    void CreateCommandPool()
     {
-        // Information about the application.
-        VkApplicationInfo appInfo  = {};
-        appInfo.sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-        appInfo.pApplicationName   = "Hello Triangle";
-        appInfo.applicationVersion = VK_MAKE_VERSION( 1, 0, 0 );
-        appInfo.pEngineName        = "No Engine";
-        appInfo.engineVersion      = VK_MAKE_VERSION( 1, 0, 0 );
-        appInfo.apiVersion         = VK_API_VERSION_1_0;
+        QueueFamilyIndices queueFamilyIndices = FindQueueFamilies( m_physicalDevice );
 
-        // Instance creation info.
-        VkInstanceCreateInfo createInfo = {};
-        createInfo.sType                = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-        createInfo.pApplicationInfo     = &appInfo;
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex =
+            queueFamilyIndices.m_graphicsFamily.value(); // The queue that the commands will be submitted to.
+        poolInfo.flags = 0;                              // Controls command buffer behavior.
 
-        // Check extensions support.
-        if ( m_enableValidationLayers && !vkbase::CheckVulkanLayersSupport( m_validationLayers ) )
+        if ( vkCreateCommandPool( m_device, &poolInfo, nullptr, &m_commandPool ) != VK_SUCCESS )
         {
-            throw std::runtime_error( "Missing vulkan layers, abort!" );
+            throw std::runtime_error( "Failed to create command pool." );
         }
+    }
 
-        VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo;
-        if ( m_enableValidationLayers )
+    /// Create a command pool, and a command buffer from it, for each frame in flight.  The command buffer is
+    /// re-recorded every frame, so the pools are transient, and reset wholesale once their frame completes.
+    void CreateFrameCommandPools()
+    {
+        QueueFamilyIndices queueFamilyIndices = FindQueueFamilies( m_physicalDevice );
+
+        m_frameCommandPools.resize( m_options.m_framesInFlight );
+        m_frameCommandBuffers.resize( m_options.m_framesInFlight );
+        for ( size_t frameIndex = 0; frameIndex < m_frameCommandPools.size(); ++frameIndex )
         {
-            createInfo.enabledLayerCount   = static_cast< uint32_t >( m_validationLayers.size() );
-            createInfo.ppEnabledLayerNames = m_validationLayers.data();
+            VkCommandPoolCreateInfo poolInfo = {};
+            poolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.queueFamilyIndex        = queueFamilyIndices.m_graphicsFamily.value();
+            poolInfo.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            if ( vkCreateCommandPool( m_device, &poolInfo, nullptr, &m_frameCommandPools[ frameIndex ] ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to create frame command pool." );
+            }
 
-            PopulateDebugMessengerCreateInfo( debugCreateInfo );
-            createInfo.pNext = ( VkDebugUtilsMessengerCreateInfoEXT* ) &debugCreateInfo;
+            VkCommandBufferAllocateInfo allocInfo = {};
+            allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool                 = m_frameCommandPools[ frameIndex ];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; // PRIMARY level can be submitted to a queue for execution.
+            allocInfo.commandBufferCount = 1;
+            if ( vkAllocateCommandBuffers( m_device, &allocInfo, &m_frameCommandBuffers[ frameIndex ] ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to allocate command buffers." );
+            }
         }
-        else
+
+        if ( m_options.m_recordThreads == 0 )
         {
-            createInfo.enabledLayerCount = 0;
-            createInfo.pNext             = nullptr;
+            return;
+        }
+
+        // Each recording thread gets its own command pool per frame in flight, as command pools must not be used
+        // by multiple threads at once.
+        m_jobSystem.reset( new vkbase::JobSystem( m_options.m_recordThreads ) );
+        m_workerCommandPools.resize( m_options.m_framesInFlight );
+        for ( std::vector< WorkerCommandPool >& workerPools : m_workerCommandPools )
+        {
+            workerPools.resize( m_options.m_recordThreads );
+            for ( WorkerCommandPool& workerPool : workerPools )
+            {
+                VkCommandPoolCreateInfo poolInfo = {};
+                poolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+                poolInfo.queueFamilyIndex        = queueFamilyIndices.m_graphicsFamily.value();
+                poolInfo.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+                if ( vkCreateCommandPool( m_device, &poolInfo, nullptr, &workerPool.m_commandPool ) != VK_SUCCESS )
+                {
+                    throw std::runtime_error( "Failed to create worker command pool." );
+                }
+            }
+        }
+    }
+
+    /// Create the staging ring, then the vertex and index buffers, and upload the geometry into them.
+    void CreateGeometryBuffers()
+    {
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+        m_stagingRing.Init( m_device, m_allocator, s_stagingRingCapacity );
+
+        // The copies are recorded for the transfer queue.  If it belongs to another family than the graphics
+        // queue, the graphics queue acquires the uploaded buffers with a command buffer of its own.
+        CreateUploadCommandBuffer( m_transferQueue, m_uploadCommandPool, m_uploadCommandBuffer );
+        if ( m_transferQueue.IsOtherFamily( m_graphicsQueue ) )
+        {
+            CreateUploadCommandBuffer( m_graphicsQueue, m_uploadAcquireCommandPool, m_uploadAcquireCommandBuffer );
+
+            VkSemaphoreCreateInfo semaphoreInfo = {};
+            semaphoreInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            if ( vkCreateSemaphore( m_device, &semaphoreInfo, nullptr, &m_uploadSemaphore ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to create upload semaphore." );
+            }
         }
 
-        // Check extensions support.
-        std::vector< const char* > extensions = GetRequiredExtensions();
-        if ( !vkbase::CheckVulkanExtensionsSupport( extensions ) )
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if ( vkCreateFence( m_device, &fenceInfo, nullptr, &m_uploadFence ) != VK_SUCCESS )
         {
-            throw std::runtime_error( "Missing vulkan extensions, abort!" );
+            throw std::runtime_error( "Failed to create upload fence." );
         }
 
-        createInfo.enabledExtensionCount   = extensions.size();
-        createInfo.ppEnabledExtensionNames = extensions.data();
+        std::vector< Vertex >   vertices;
+        std::vector< uint32_t > indices;
+        GenerateTriangles( m_options.m_triangleCount, vertices, indices );
 
-        // Create the vulkan instance.
-        if ( vkCreateInstance( &createInfo, nullptr, &m_instance ) != VK_SUCCESS )
+        // Bounding circle of the mesh, about its origin, for culling.
+        m_meshRadius = 0.0f;
+        for ( const Vertex& vertex : vertices )
         {
-            throw std::runtime_error( "Failed to create vulkan instance." );
+            m_meshRadius = std::max( m_meshRadius, std::hypot( vertex.m_position[ 0 ], vertex.m_position[ 1 ] ) );
         }
-    }
 
-    /// Utility method for populating the the debug messenger create info.
-    void PopulateDebugMessengerCreateInfo( VkDebugUtilsMessengerCreateInfoEXT& o_createInfo ) const
-    {
-        o_createInfo                 = {};
-        o_createInfo.sType           = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-        o_createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-                                       VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
-                                       VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-        o_createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
-                                   VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
-                                   VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-        o_createInfo.pfnUserCallback = DebugCallback;
+        VkDeviceSize vertexBufferSize = sizeof( Vertex ) * vertices.size();
+        VkDeviceSize indexBufferSize  = sizeof( uint32_t ) * indices.size();
+
+        m_vertexBuffer = vkbase::CreateBuffer( m_device,
+                                               m_allocator,
+                                               vertexBufferSize,
+                                               VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+        m_indexBuffer  = vkbase::CreateBuffer( m_device,
+                                              m_allocator,
+                                              indexBufferSize,
+                                              VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+        m_indexCount   = static_cast< uint32_t >( indices.size() );
+
+        UploadToBuffer( m_vertexBuffer, vertices.data(), vertexBufferSize );
+        UploadToBuffer( m_indexBuffer, indices.data(), indexBufferSize );
+        SubmitUploads();
+
+        printf( "Uploaded %u triangles (%.1f MiB) in %.3f ms, with %llu submissions, into %zu memory blocks.\n",
+                m_options.m_triangleCount,
+                ( vertexBufferSize + indexBufferSize ) / ( 1024.0 * 1024.0 ),
+                GetMillisecondsSince( startTime ),
+                static_cast< unsigned long long >( m_uploadSubmissionNumber ),
+                m_allocator.GetBlockCount() );
     }
 
-    // Setup the debug messenger.
-    void SetupDebugMessenger()
+    /// Create a command pool for \p i_queue's family, and a resettable command buffer from it, for uploads.
+    void
+    CreateUploadCommandBuffer( const vkbase::Queue& i_queue, VkCommandPool& o_pool, VkCommandBuffer& o_commandBuffer )
     {
-        if ( !m_enableValidationLayers )
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex        = i_queue.GetFamilyIndex();
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        if ( vkCreateCommandPool( m_device, &poolInfo, nullptr, &o_pool ) != VK_SUCCESS )
         {
-            return;
+            throw std::runtime_error( "Failed to create upload command pool." );
         }
 
-        VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
-        PopulateDebugMessengerCreateInfo( createInfo );
-        if ( CreateDebugUtilsMessengerEXT( m_instance, &createInfo, nullptr, &m_debugMessenger ) != VK_SUCCESS )
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool                 = o_pool;
+        allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount          = 1;
+        if ( vkAllocateCommandBuffers( m_device, &allocInfo, &o_commandBuffer ) != VK_SUCCESS )
         {
-            throw std::runtime_error( "failed to set up debug messenger!" );
+            throw std::runtime_error( "Failed to allocate upload command buffer." );
         }
     }
 
-    SwapChainSupportDetails QuerySwapChainSupport( VkPhysicalDevice i_device ) const
+    /// Copy \p i_size bytes of \p i_data into the device local buffer \p i_buffer, through the staging ring.
+    /// The copies are recorded into the upload command buffer, which is submitted whenever the ring is full.
+    void UploadToBuffer( const vkbase::Buffer& i_buffer, const void* i_data, VkDeviceSize i_size )
     {
-        SwapChainSupportDetails details;
+        VkDeviceSize uploadedSize = 0;
+        while ( uploadedSize < i_size )
+        {
+            VkDeviceSize stagingOffset = 0;
+            VkDeviceSize size          = m_stagingRing.Reserve( i_size - uploadedSize, 16, stagingOffset );
+            if ( size == 0 )
+            {
+                // Wait for the pending copies to make room in the ring.
+                SubmitUploads();
+                continue;
+            }
 
-        // Query capabilities.
-        vkGetPhysicalDeviceSurfaceCapabilitiesKHR( i_device, m_surface, &details.m_capabilities );
+            memcpy( m_stagingRing.GetMappedData() + stagingOffset,
+                    static_cast< const char* >( i_data ) + uploadedSize,
+                    size );
 
-        // Query available formats
-        uint32_t formatCount;
-        vkGetPhysicalDeviceSurfaceFormatsKHR( i_device, m_surface, &formatCount, nullptr );
-        if ( formatCount != 0 )
-        {
-            details.m_formats.resize( formatCount );
-            vkGetPhysicalDeviceSurfaceFormatsKHR( i_device, m_surface, &formatCount, details.m_formats.data() );
+            if ( !m_uploadRecording )
+            {
+                VkCommandBufferBeginInfo beginInfo = {};
+                beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                if ( vkBeginCommandBuffer( m_uploadCommandBuffer, &beginInfo ) != VK_SUCCESS )
+                {
+                    throw std::runtime_error( "Failed to begin recording upload command buffer." );
+                }
+
+                m_uploadRecording = true;
+            }
+
+            VkBufferCopy copyRegion = {};
+            copyRegion.srcOffset    = stagingOffset;
+            copyRegion.dstOffset    = uploadedSize;
+            copyRegion.size         = size;
+            vkCmdCopyBuffer( m_uploadCommandBuffer, m_stagingRing.GetBuffer(), i_buffer.m_buffer, 1, &copyRegion );
+
+            if ( m_uploadedBuffers.empty() || m_uploadedBuffers.back() != i_buffer.m_buffer )
+            {
+                m_uploadedBuffers.push_back( i_buffer.m_buffer );
+            }
+
+            uploadedSize += size;
         }
+    }
 
-        // Presentation modes.
-        uint32_t presentModeCount;
-        vkGetPhysicalDeviceSurfacePresentModesKHR( i_device, m_surface, &presentModeCount, nullptr );
-        if ( presentModeCount != 0 )
+    /// Submit the recorded uploads, and wait for them to complete, releasing their staging memory.
+    void SubmitUploads()
+    {
+        if ( !m_uploadRecording )
         {
-            details.m_presentModes.resize( presentModeCount );
-            vkGetPhysicalDeviceSurfacePresentModesKHR( i_device,
-                                                       m_surface,
-                                                       &presentModeCount,
-                                                       details.m_presentModes.data() );
+            return;
         }
 
-        return details;
-    }
+        // Make the copies visible to vertex input of all subsequent submissions, transferring ownership of the
+        // uploaded buffers to the graphics queue family if the copies ran on another.
+        std::vector< VkBufferMemoryBarrier > releaseBarriers( m_uploadedBuffers.size() );
+        std::vector< VkBufferMemoryBarrier > acquireBarriers( m_uploadedBuffers.size() );
+        for ( size_t bufferIndex = 0; bufferIndex < m_uploadedBuffers.size(); ++bufferIndex )
+        {
+            vkbase::MakeBufferOwnershipTransfer( m_uploadedBuffers[ bufferIndex ],
+                                                 0,
+                                                 VK_WHOLE_SIZE,
+                                                 m_transferQueue,
+                                                 VK_ACCESS_TRANSFER_WRITE_BIT,
+                                                 m_graphicsQueue,
+                                                 VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+                                                 releaseBarriers[ bufferIndex ],
+                                                 acquireBarriers[ bufferIndex ] );
+        }
 
-    /// Query if the current device supports
-    QueueFamilyIndices FindQueueFamilies( VkPhysicalDevice i_device ) const
-    {
-        QueueFamilyIndices indices;
+        m_uploadedBuffers.clear();
+
+        const bool ownershipTransfer = m_transferQueue.IsOtherFamily( m_graphicsQueue );
+        vkCmdPipelineBarrier( m_uploadCommandBuffer,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              ownershipTransfer ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT
+                                                : VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                              0,
+                              0,
+                              nullptr,
+                              static_cast< uint32_t >( releaseBarriers.size() ),
+                              releaseBarriers.data(),
+                              0,
+                              nullptr );
+
+        if ( vkEndCommandBuffer( m_uploadCommandBuffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to record upload command buffer." );
+        }
 
-        // Get available queue families.
-        uint32_t queueFamilyCount = 0;
-        vkGetPhysicalDeviceQueueFamilyProperties( i_device, &queueFamilyCount, nullptr );
-        std::vector< VkQueueFamilyProperties > queueFamilies( queueFamilyCount );
-        vkGetPhysicalDeviceQueueFamilyProperties( i_device, &queueFamilyCount, queueFamilies.data() );
+        m_uploadRecording = false;
 
-        for ( size_t familyIndex = 0; familyIndex < queueFamilies.size(); ++familyIndex )
+        vkbase::Submission submission;
+        submission.AddCommandBuffer( m_uploadCommandBuffer );
+        if ( !ownershipTransfer )
         {
-            const VkQueueFamilyProperties& queueFamily = queueFamilies[ familyIndex ];
+            if ( m_transferQueue.Submit( submission, m_uploadFence ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to submit upload command buffer." );
+            }
+        }
+        else
+        {
+            // The copies run on the transfer queue, then the graphics queue acquires the buffers once they have
+            // completed.  The fence of the acquiring submission covers both.
+            submission.Signal( m_uploadSemaphore );
+            if ( m_transferQueue.Submit( submission ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to submit upload command buffer." );
+            }
 
-            // Present support.
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR( i_device, familyIndex, m_surface, &presentSupport );
-            if ( presentSupport )
+            VkCommandBufferBeginInfo beginInfo = {};
+            beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            if ( vkBeginCommandBuffer( m_uploadAcquireCommandBuffer, &beginInfo ) != VK_SUCCESS )
             {
-                indices.m_presentFamily = familyIndex;
+                throw std::runtime_error( "Failed to begin recording upload acquire command buffer." );
             }
 
-            // Graphics support.
-            if ( queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT )
+            vkCmdPipelineBarrier( m_uploadAcquireCommandBuffer,
+                                  VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                  VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                  0,
+                                  0,
+                                  nullptr,
+                                  static_cast< uint32_t >( acquireBarriers.size() ),
+                                  acquireBarriers.data(),
+                                  0,
+                                  nullptr );
+
+            if ( vkEndCommandBuffer( m_uploadAcquireCommandBuffer ) != VK_SUCCESS )
             {
-                indices.m_graphicsFamily = familyIndex;
+                throw std::runtime_error( "Failed to record upload acquire command buffer." );
             }
 
-            if ( indices.IsComplete() )
+            vkbase::Submission acquireSubmission;
+            acquireSubmission.AddCommandBuffer( m_uploadAcquireCommandBuffer );
+            acquireSubmission.Wait( m_uploadSemaphore, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT );
+            if ( m_graphicsQueue.Submit( acquireSubmission, m_uploadFence ) != VK_SUCCESS )
             {
-                break;
+                throw std::runtime_error( "Failed to submit upload acquire command buffer." );
             }
         }
 
-        return indices;
+        m_stagingRing.Commit( ++m_uploadSubmissionNumber );
+
+        vkWaitForFences( m_device, 1, &m_uploadFence, VK_TRUE, UINT64_MAX );
+        vkResetFences( m_device, 1, &m_uploadFence );
+        m_stagingRing.Release( m_uploadSubmissionNumber );
     }
 
-    /// Check if the requested extensions are supported, for \p i_device.
-    bool CheckDeviceExtensionSupport( VkPhysicalDevice i_device ) const
+    /// Start the texture streamer, decoding the textures from the PPM images of the texture directory, if given,
+    /// or generating them otherwise.
+    void CreateTextureStreamer()
     {
-        uint32_t extensionCount;
-        vkEnumerateDeviceExtensionProperties( i_device, nullptr, &extensionCount, nullptr );
-
-        std::vector< VkExtensionProperties > availableExtensions( extensionCount );
-        vkEnumerateDeviceExtensionProperties( i_device, nullptr, &extensionCount, availableExtensions.data() );
+        if ( !m_options.m_textureDirectory.empty() )
+        {
+            m_texturePaths = vkbase::ListFiles( m_options.m_textureDirectory, ".ppm" );
+            if ( m_texturePaths.empty() )
+            {
+                throw std::runtime_error( "No PPM images found in " + m_options.m_textureDirectory );
+            }
+        }
 
-        std::set< std::string > requiredExtensions( m_deviceExtensions.begin(), m_deviceExtensions.end() );
-        for ( const VkExtensionProperties& extension : availableExtensions )
+        // The decode function runs on the streamer's threads, so reads only what does not change after this.
+        vkbase::TextureStreamer::DecodeFunction decodeFunction;
+        if ( m_texturePaths.empty() )
         {
-            requiredExtensions.erase( extension.extensionName );
+            const uint32_t textureSize = m_options.m_textureSize;
+            decodeFunction             = [textureSize]( uint32_t i_textureIndex, vkbase::DecodedImage& o_image ) {
+                GenerateTexture( i_textureIndex, textureSize, o_image );
+            };
+        }
+        else
+        {
+            decodeFunction = [this]( uint32_t i_textureIndex, vkbase::DecodedImage& o_image ) {
+                vkbase::DecodePpm( m_texturePaths[ i_textureIndex % m_texturePaths.size() ], o_image );
+            };
         }
 
-        return requiredExtensions.empty();
+        const size_t decodeThreadCount = std::max( std::thread::hardware_concurrency() / 2, 1u );
+        m_textureStreamer.Init( m_instance,
+                                m_physicalDevice,
+                                m_device,
+                                m_allocator,
+                                m_transferQueue,
+                                m_graphicsQueue,
+                                m_options.m_textureCount,
+                                decodeThreadCount,
+                                s_textureStagingRingCapacity,
+                                VkDeviceSize( m_options.m_textureBudget ) * 1024 * 1024,
+                                m_memoryBudgetEnabled,
+                                std::move( decodeFunction ) );
+
+        printf( "Streaming %u textures on %zu threads, within %u MiB%s.\n",
+                m_options.m_textureCount,
+                decodeThreadCount,
+                m_options.m_textureBudget,
+                m_memoryBudgetEnabled ? ", or the memory budget of the device" : "" );
+        printf( "Texture memory budget from %s.\n",
+                m_memoryBudgetEnabled ? "VK_EXT_memory_budget and --texture-budget" : "--texture-budget only" );
     }
 
-    /// Check if the the input device \pr i_device is suitable for the current application.
-    bool IsDeviceSuitable( VkPhysicalDevice i_device ) const
+    /// Request the textures of frame \p i_frameNumber, a window of one per instance sliding across all textures
+    /// over time, then advance streaming without blocking.
+    ///
+    /// With bindless descriptors, each texture has the slot of its index, and each instance of the window samples
+    /// its texture if resident.
+    void StreamTextures( uint64_t i_frameNumber )
     {
-        QueueFamilyIndices indices             = FindQueueFamilies( i_device );
-        bool               extensionsSupported = CheckDeviceExtensionSupport( i_device );
-
-        bool swapChainAdequate = false;
-        if ( extensionsSupported )
+        const uint32_t textureCount = m_options.m_textureCount;
+        const uint32_t windowSize   = std::min( m_options.m_instanceCount, textureCount );
+        const uint64_t firstTexture = i_frameNumber / s_textureScrollFrames;
+        for ( uint32_t windowIndex = 0; windowIndex < windowSize; ++windowIndex )
         {
-            SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport( i_device );
-            swapChainAdequate = !swapChainSupport.m_formats.empty() && !swapChainSupport.m_presentModes.empty();
+            m_textureStreamer.Request( static_cast< uint32_t >( ( firstTexture + windowIndex ) % textureCount ),
+                                       i_frameNumber );
         }
 
-        return indices.IsComplete() && extensionsSupported && swapChainAdequate;
-    }
-
-    void SelectPhysicalDevice()
-    {
-        uint32_t deviceCount = 0;
-        vkEnumeratePhysicalDevices( m_instance, &deviceCount, nullptr );
-        if ( deviceCount == 0 )
+        m_textureStreamer.Update( i_frameNumber, m_completedFrameNumber );
+        if ( !m_options.m_bindless )
         {
-            throw std::runtime_error( "Failed to find graphics device with Vulkan support." );
+            return;
         }
 
-        std::vector< VkPhysicalDevice > devices( deviceCount, VK_NULL_HANDLE );
-        vkEnumeratePhysicalDevices( m_instance, &deviceCount, devices.data() );
-        for ( VkPhysicalDevice device : devices )
+        // Only the slots whose image view changed are written to the descriptor sets.
+        for ( uint32_t textureIndex = 0; textureIndex < textureCount; ++textureIndex )
         {
-            if ( IsDeviceSuitable( device ) )
-            {
-                m_physicalDevice = device;
-                break;
-            }
+            m_bindlessDescriptors.SetTexture( textureIndex,
+                                              m_textureStreamer.GetImageView( textureIndex ),
+                                              m_textureSampler );
         }
 
-        if ( m_physicalDevice == VK_NULL_HANDLE )
+        uint32_t* textureSlots = static_cast< uint32_t* >( m_textureSlotBuffer.m_allocation.m_mappedData ) +
+                                 m_currentFrame * m_options.m_instanceCount;
+        for ( uint32_t windowIndex = 0; windowIndex < windowSize; ++windowIndex )
         {
-            throw std::runtime_error( "Failed to find suitable graphics device." );
+            uint32_t textureIndex       = static_cast< uint32_t >( ( firstTexture + windowIndex ) % textureCount );
+            textureSlots[ windowIndex ] = m_textureStreamer.GetImageView( textureIndex ) != VK_NULL_HANDLE
+                                              ? textureIndex
+                                              : s_noTextureSlot;
         }
     }
 
-    void CreateLogicalDevice()
+    /// Create the layout of the descriptor set of the graphics pipeline, and the pools of each frame in flight
+    /// that the descriptor sets written every frame are allocated from.
+    ///
+    /// By default, the graphics pipeline reads the instance buffer through a set allocated every frame.  With
+    /// bindless descriptors, it instead indexes arrays of buffers and textures, in a set per frame in flight which
+    /// is only written where its resources changed.
+    void CreateDescriptors()
     {
-        QueueFamilyIndices indices = FindQueueFamilies( m_physicalDevice );
+        // Sets of the culling shader hold three storage buffers, and those of the graphics pipeline one.
+        m_frameDescriptors.Init( m_device,
+                                 m_options.m_framesInFlight,
+                                 s_descriptorSetsPerPool,
+                                 {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * s_descriptorSetsPerPool}} );
 
-        std::vector< VkDeviceQueueCreateInfo > queueCreateInfos;
-        std::set< uint32_t > uniqueQueueFamilies = {indices.m_graphicsFamily.value(), indices.m_presentFamily.value()};
-        float                queuePriority       = 1.0f;
-        for ( uint32_t queueFamily : uniqueQueueFamilies )
+        if ( !m_options.m_bindless )
         {
-            VkDeviceQueueCreateInfo queueCreateInfo = {};
-            queueCreateInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            queueCreateInfo.queueFamilyIndex        = queueFamily;
-            queueCreateInfo.queueCount              = 1;
-            queueCreateInfo.pQueuePriorities        = &queuePriority;
-            queueCreateInfos.push_back( queueCreateInfo );
+            VkDescriptorSetLayoutBinding instanceBinding = {};
+            instanceBinding.binding                      = 0;
+            instanceBinding.descriptorType               = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            instanceBinding.descriptorCount              = 1;
+            instanceBinding.stageFlags                   = VK_SHADER_STAGE_VERTEX_BIT;
+            m_descriptorSetLayout                        = m_descriptorLayoutCache.GetLayout( {instanceBinding} );
+            return;
         }
 
-        // No request for any specific features for this application.
-        VkPhysicalDeviceFeatures deviceFeatures = {};
-
-        /// Create logical device.
-        VkDeviceCreateInfo createInfo   = {};
-        createInfo.sType                = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        createInfo.pQueueCreateInfos    = queueCreateInfos.data();
-        createInfo.queueCreateInfoCount = static_cast< uint32_t >( queueCreateInfos.size() );
-        createInfo.pEnabledFeatures     = &deviceFeatures;
-
-        createInfo.enabledExtensionCount   = static_cast< uint32_t >( m_deviceExtensions.size() );
-        createInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
-
-        if ( m_enableValidationLayers )
-        {
-            createInfo.enabledLayerCount   = static_cast< uint32_t >( m_validationLayers.size() );
-            createInfo.ppEnabledLayerNames = m_validationLayers.data();
-        }
-        else
+        // Update-after-bind arrays are bounded by limits of their own, much larger than those of other bindings.
+        // Textures are combined image samplers, so count as both sampled images and samplers.  Both arrays are
+        // visible to the vertex and fragment stages, so each stage counts them together against its resource limit;
+        // the buffers, which are few, get at most half of it.
+        VkPhysicalDeviceDescriptorIndexingPropertiesEXT limits =
+            vkbase::GetDescriptorIndexingProperties( m_instance, m_physicalDevice );
+        const uint32_t bufferCapacity  = std::min( {s_bindlessBufferCapacity,
+                                                   limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                                                   limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                                                   limits.maxPerStageUpdateAfterBindResources / 2} );
+        const uint32_t textureCapacity = std::min( {s_bindlessTextureCapacity,
+                                                    limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                                    limits.maxDescriptorSetUpdateAfterBindSampledImages,
+                                                    limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                                    limits.maxDescriptorSetUpdateAfterBindSamplers,
+                                                    limits.maxPerStageUpdateAfterBindResources - bufferCapacity} );
+        if ( m_options.m_textureCount > textureCapacity )
         {
-            createInfo.enabledLayerCount = 0;
+            throw std::runtime_error( "At most " + std::to_string( textureCapacity ) +
+                                      " textures can be bound by the device" );
         }
 
-        if ( vkCreateDevice( m_physicalDevice, &createInfo, nullptr, &m_device ) != VK_SUCCESS )
+        m_bindlessDescriptors.Init( m_device,
+                                    m_descriptorLayoutCache,
+                                    m_options.m_framesInFlight,
+                                    bufferCapacity,
+                                    textureCapacity,
+                                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT );
+        m_descriptorSetLayout = m_bindlessDescriptors.GetLayout();
+
+        // Streamed textures are filtered across all of their mips, however many are resident.
+        VkSamplerCreateInfo samplerInfo = {};
+        samplerInfo.sType               = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter           = VK_FILTER_LINEAR;
+        samplerInfo.minFilter           = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode          = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU        = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeV        = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeW        = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.maxLod              = VK_LOD_CLAMP_NONE;
+        if ( vkCreateSampler( m_device, &samplerInfo, nullptr, &m_textureSampler ) != VK_SUCCESS )
         {
-            throw std::runtime_error( "Failed to create logical device." );
+            throw std::runtime_error( "Failed to create texture sampler." );
         }
 
-        // Get a handle to the graphics command queue.
-        vkGetDeviceQueue( m_device, indices.m_graphicsFamily.value(), 0, &m_graphicsQueue );
-        vkGetDeviceQueue( m_device, indices.m_presentFamily.value(), 0, &m_presentQueue );
+        printf( "Bindless descriptors: %u buffer and %u texture slots.\n", bufferCapacity, textureCapacity );
     }
 
-    /// Debug callback handling.
-    static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback( VkDebugUtilsMessageSeverityFlagBitsEXT      i_messageSeverity,
-                                                         VkDebugUtilsMessageTypeFlagsEXT             i_messageType,
-                                                         const VkDebugUtilsMessengerCallbackDataEXT* i_pCallbackData,
-                                                         void*                                       i_pUserData )
+    /// Start the descriptor sets of the current frame, whose previous frame in flight has completed: return the
+    /// sets of that frame to the pools, then allocate and write the sets bound by this one.  With bindless
+    /// descriptors, the set of the frame in flight is brought up to date instead.
+    void UpdateFrameDescriptors()
     {
-        std::cerr << "validation layer: " << i_pCallbackData->pMessage << std::endl;
-
-        // Should the vulkan call, which triggered this debug callback, be aborted?
-        return VK_FALSE;
-    }
+        m_frameDescriptors.BeginFrame( m_currentFrame );
 
-    /// Retrieve the create debug messenger function.  It is an extension, so we must fetch the function
-    /// pointer with vkGetInstanceProcAddr.
-    VkResult CreateDebugUtilsMessengerEXT( VkInstance                                i_instance,
-                                           const VkDebugUtilsMessengerCreateInfoEXT* i_pCreateInfo,
-                                           const VkAllocationCallbacks*              i_pAllocator,
-                                           VkDebugUtilsMessengerEXT*                 o_pDebugMessenger )
-    {
-        PFN_vkCreateDebugUtilsMessengerEXT func =
-            ( PFN_vkCreateDebugUtilsMessengerEXT ) vkGetInstanceProcAddr( i_instance,
-                                                                          "vkCreateDebugUtilsMessengerEXT" );
-        if ( func != nullptr )
+        // Whole buffers are bound; each frame selects its region with the offsets in its push constants.
+        if ( m_options.m_bindless )
         {
-            return func( i_instance, i_pCreateInfo, i_pAllocator, o_pDebugMessenger );
+            m_bindlessDescriptors.Update( m_currentFrame );
+            m_frameDescriptorSet = m_bindlessDescriptors.GetSet( m_currentFrame );
         }
         else
         {
-            return VK_ERROR_EXTENSION_NOT_PRESENT;
+            m_frameDescriptorSet = m_frameDescriptors.Allocate( m_descriptorSetLayout );
+
+            VkDescriptorBufferInfo bufferInfo = {};
+            bufferInfo.buffer                 = m_instanceBuffer.m_buffer;
+            bufferInfo.offset                 = 0;
+            bufferInfo.range                  = VK_WHOLE_SIZE;
+
+            VkWriteDescriptorSet descriptorWrite = {};
+            descriptorWrite.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet               = m_frameDescriptorSet;
+            descriptorWrite.dstBinding           = 0;
+            descriptorWrite.dstArrayElement      = 0;
+            descriptorWrite.descriptorType       = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrite.descriptorCount      = 1;
+            descriptorWrite.pBufferInfo          = &bufferInfo;
+            vkUpdateDescriptorSets( m_device, 1, &descriptorWrite, 0, nullptr );
         }
-    }
 
-    void DestroyDebugUtilsMessengerEXT( VkInstance                   i_instance,
-                                        VkDebugUtilsMessengerEXT     o_debugMessenger,
-                                        const VkAllocationCallbacks* i_pAllocator )
-    {
-        PFN_vkDestroyDebugUtilsMessengerEXT func =
-            ( PFN_vkDestroyDebugUtilsMessengerEXT ) vkGetInstanceProcAddr( i_instance,
-                                                                           "vkDestroyDebugUtilsMessengerEXT" );
-        if ( func != nullptr )
+        if ( !m_options.m_gpuCulling )
         {
-            func( i_instance, o_debugMessenger, i_pAllocator );
+            return;
         }
-    }
 
-    /// Choose a preferred surface format.
-    VkSurfaceFormatKHR SelectSwapSurfaceFormat( const std::vector< VkSurfaceFormatKHR >& i_availableFormats ) const
-    {
-        for ( const VkSurfaceFormatKHR& availableFormat : i_availableFormats )
-        {
-            if ( availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB &&
-                 availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR )
-            {
-                return availableFormat;
-            }
-        }
+        // The culling shader reads the instances, and writes the draw commands and counts.
+        m_cullDescriptorSet = m_frameDescriptors.Allocate( m_cullDescriptorSetLayout );
 
-        return i_availableFormats[ 0 ];
-    }
+        std::array< VkDescriptorBufferInfo, 3 > bufferInfos = {};
+        bufferInfos[ 0 ].buffer                             = m_instanceBuffer.m_buffer;
+        bufferInfos[ 1 ].buffer                             = m_drawCommandBuffer.m_buffer;
+        bufferInfos[ 2 ].buffer                             = m_drawCountBuffer.m_buffer;
 
-    VkPresentModeKHR SelectSwapPresentMode( const std::vector< VkPresentModeKHR >& i_availablePresentModes ) const
-    {
-        for ( const VkPresentModeKHR& availablePresentMode : i_availablePresentModes )
+        std::array< VkWriteDescriptorSet, 3 > descriptorWrites = {};
+        for ( uint32_t bindingIndex = 0; bindingIndex < descriptorWrites.size(); ++bindingIndex )
         {
-            if ( availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR )
-            {
-                return availablePresentMode;
-            }
+            bufferInfos[ bindingIndex ].offset = 0;
+            bufferInfos[ bindingIndex ].range  = VK_WHOLE_SIZE;
+
+            descriptorWrites[ bindingIndex ].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[ bindingIndex ].dstSet          = m_cullDescriptorSet;
+            descriptorWrites[ bindingIndex ].dstBinding      = bindingIndex;
+            descriptorWrites[ bindingIndex ].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[ bindingIndex ].descriptorCount = 1;
+            descriptorWrites[ bindingIndex ].pBufferInfo     = &bufferInfos[ bindingIndex ];
         }
 
-        return VK_PRESENT_MODE_FIFO_KHR;
+        vkUpdateDescriptorSets( m_device,
+                                static_cast< uint32_t >( descriptorWrites.size() ),
+                                descriptorWrites.data(),
+                                0,
+                                nullptr );
     }
 
-    VkExtent2D SelectSwapExtent( const VkSurfaceCapabilitiesKHR& i_capabilities )
+    /// Create the instance buffer, and with bindless descriptors, the buffer of the texture slot of each instance.
+    ///
+    /// The instance buffer is persistently mapped, and holds a region of instance data per frame in flight, used
+    /// as a ring: each frame writes its own region, once the previous frame using it has completed.
+    void CreateInstanceBuffer()
     {
-        if ( i_capabilities.currentExtent.width != UINT32_MAX )
+        VkDeviceSize regionSize = sizeof( InstanceData ) * m_options.m_instanceCount;
+
+        // The whole ring is bound as a single storage buffer, so it must fit in the device's storage buffer range.
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties( m_physicalDevice, &properties );
+        const VkDeviceSize maxRange = properties.limits.maxStorageBufferRange;
+        if ( regionSize * m_options.m_framesInFlight > maxRange )
         {
-            return i_capabilities.currentExtent;
+            char message[ 256 ];
+            snprintf( message,
+                      sizeof( message ),
+                      "%u instances over %u frames in flight exceed the storage buffer range of the device (%llu "
+                      "bytes); at most %llu instances are supported.",
+                      m_options.m_instanceCount,
+                      m_options.m_framesInFlight,
+                      static_cast< unsigned long long >( maxRange ),
+                      static_cast< unsigned long long >( maxRange / ( sizeof( InstanceData ) *
+                                                                      m_options.m_framesInFlight ) ) );
+            throw std::runtime_error( message );
         }
-        else
+
+        // Read by the vertex shader, and by the culling shader if it runs on the compute queue.
+        std::vector< uint32_t > queueFamilies;
+        if ( IsAsyncCulling() )
         {
-            int width, height;
-            glfwGetFramebufferSize( m_window, &width, &height );
-            VkExtent2D actualExtent = {( uint32_t ) width, ( uint32_t ) height};
+            queueFamilies = {m_graphicsQueue.GetFamilyIndex(), m_computeQueue.GetFamilyIndex()};
+        }
 
-            actualExtent.width  = std::max( i_capabilities.minImageExtent.width,
-                                           std::min( i_capabilities.maxImageExtent.width, actualExtent.width ) );
-            actualExtent.height = std::max( i_capabilities.minImageExtent.height,
-                                            std::min( i_capabilities.maxImageExtent.height, actualExtent.height ) );
+        m_instanceBuffer = vkbase::CreateBuffer( m_device,
+                                                 m_allocator,
+                                                 regionSize * m_options.m_framesInFlight,
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                 queueFamilies );
+
+        // Instances index the bindless textures through a slot each, laid out like the instance data.  Every
+        // instance starts without a texture.
+        if ( m_options.m_bindless )
+        {
+            m_textureSlotBuffer = vkbase::CreateBuffer( m_device,
+                                                        m_allocator,
+                                                        sizeof( uint32_t ) * m_options.m_instanceCount *
+                                                            m_options.m_framesInFlight,
+                                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+            uint32_t*    textureSlots = static_cast< uint32_t* >( m_textureSlotBuffer.m_allocation.m_mappedData );
+            const size_t slotCount    = size_t( m_options.m_instanceCount ) * m_options.m_framesInFlight;
+            std::fill( textureSlots, textureSlots + slotCount, s_noTextureSlot );
+
+            m_bindlessDescriptors.SetBuffer( s_instanceBufferSlot, m_instanceBuffer.m_buffer, 0, VK_WHOLE_SIZE );
+            m_bindlessDescriptors.SetBuffer( s_textureSlotBufferSlot, m_textureSlotBuffer.m_buffer, 0, VK_WHOLE_SIZE );
+        }
 
-            return actualExtent;
+        // The depth of each instance is constant, so they are sorted once.  Within an instanced draw, instances
+        // are rasterized in order.
+        m_instanceDrawOrder.resize( m_options.m_instanceCount );
+        std::iota( m_instanceDrawOrder.begin(), m_instanceDrawOrder.end(), 0 );
+        if ( m_options.m_drawOrder != DrawOrder_None )
+        {
+            const bool frontToBack = m_options.m_drawOrder == DrawOrder_FrontToBack;
+            std::sort( m_instanceDrawOrder.begin(),
+                       m_instanceDrawOrder.end(),
+                       [frontToBack]( uint32_t i_lhs, uint32_t i_rhs ) {
+                           return frontToBack ? GetInstanceDepth( i_lhs ) < GetInstanceDepth( i_rhs )
+                                              : GetInstanceDepth( i_lhs ) > GetInstanceDepth( i_rhs );
+                       } );
         }
     }
 
-    void CreateSwapChain()
+    /// Write the instance data of frame \p i_frameNumber into the region of the current frame in flight.
+    /// Multiple instances are laid out in a grid, and spin over time.  They are written in draw order.
+    void UpdateInstances( uint64_t i_frameNumber )
     {
-        SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport( m_physicalDevice );
-        VkSurfaceFormatKHR      surfaceFormat    = SelectSwapSurfaceFormat( swapChainSupport.m_formats );
-        VkPresentModeKHR        presentMode      = SelectSwapPresentMode( swapChainSupport.m_presentModes );
-        VkExtent2D              extent           = SelectSwapExtent( swapChainSupport.m_capabilities );
-
-        uint32_t imageCount = swapChainSupport.m_capabilities.minImageCount + 1;
-        if ( swapChainSupport.m_capabilities.maxImageCount > 0 &&
-             imageCount > swapChainSupport.m_capabilities.maxImageCount )
+        const uint32_t instanceCount = m_options.m_instanceCount;
+        const uint32_t columns =
+            static_cast< uint32_t >( std::ceil( std::sqrt( static_cast< double >( instanceCount ) ) ) );
+        const uint32_t rows       = ( instanceCount + columns - 1 ) / columns;
+        const float    sceneScale = m_options.m_sceneScale;
+        const float    cellSize   = 2.0f * sceneScale / columns;
+        const float    rowSize    = 2.0f * sceneScale / rows;
+
+        InstanceData* instances = static_cast< InstanceData* >( m_instanceBuffer.m_allocation.m_mappedData ) +
+                                  m_currentFrame * instanceCount;
+        for ( uint32_t drawIndex = 0; drawIndex < instanceCount; ++drawIndex )
         {
-            imageCount = swapChainSupport.m_capabilities.maxImageCount;
-        }
-
-        // Create the swap chain.
-        VkSwapchainCreateInfoKHR createInfo = {};
-        createInfo.sType                    = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-        createInfo.surface                  = m_surface;
-        createInfo.minImageCount            = imageCount;
-        createInfo.imageFormat              = surfaceFormat.format;
-        createInfo.imageColorSpace          = surfaceFormat.colorSpace;
-        createInfo.imageExtent              = extent;
-        createInfo.imageArrayLayers         = 1;
-        createInfo.imageUsage               = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+            InstanceData& instance = instances[ drawIndex ];
+            if ( instanceCount == 1 )
+            {
+                instance = {{0.0f, 0.0f}, m_options.m_instanceScale, 0.0f, {1.0f, 1.0f, 1.0f}, 0.5f};
+                continue;
+            }
 
-        // Specify how the images in the swap chain will be used across multiple queue families.
-        QueueFamilyIndices indices              = FindQueueFamilies( m_physicalDevice );
-        uint32_t           queueFamilyIndices[] = {indices.m_graphicsFamily.value(), indices.m_presentFamily.value()};
-        if ( indices.m_graphicsFamily != indices.m_presentFamily )
+            uint32_t instanceIndex = m_instanceDrawOrder[ drawIndex ];
+            uint32_t column        = instanceIndex % columns;
+            uint32_t row           = instanceIndex / columns;
+            instance.m_offset[ 0 ] = -sceneScale + ( column + 0.5f ) * cellSize;
+            instance.m_offset[ 1 ] = -sceneScale + ( row + 0.5f ) * rowSize;
+            instance.m_scale       = std::min( cellSize, rowSize ) * 0.5f * m_options.m_instanceScale;
+            instance.m_rotation    = 0.01f * static_cast< float >( i_frameNumber ) + 0.1f * instanceIndex;
+            instance.m_color[ 0 ]  = 0.5f + 0.5f * column / columns;
+            instance.m_color[ 1 ]  = 0.5f + 0.5f * row / rows;
+            instance.m_color[ 2 ]  = 1.0f;
+            instance.m_depth       = GetInstanceDepth( instanceIndex );
+        }
+    }
+
+    /// Create the compute pipeline culling the instances, the buffers it writes draw commands and counts into,
+    /// and the layout of its descriptor set, which is allocated every frame.  The buffers hold a region per frame
+    /// in flight.
+    void CreateCullingResources()
+    {
+        const uint32_t objectCount = m_options.m_instanceCount;
+        const uint32_t frameCount  = m_options.m_framesInFlight;
+
+        // Every object has a draw command, and all of them are drawn with a single indirect draw.
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties( m_physicalDevice, &properties );
+        if ( objectCount > properties.limits.maxDrawIndirectCount )
         {
-            createInfo.imageSharingMode      = VK_SHARING_MODE_CONCURRENT;
-            createInfo.queueFamilyIndexCount = 2;
-            createInfo.pQueueFamilyIndices   = queueFamilyIndices;
+            throw std::runtime_error( "GPU culling of " + std::to_string( objectCount ) +
+                                      " instances exceeds the maximum indirect draw count of the device (" +
+                                      std::to_string( properties.limits.maxDrawIndirectCount ) + ")." );
         }
-        else
+
+        m_drawCommandBuffer = vkbase::CreateBuffer( m_device,
+                                                    m_allocator,
+                                                    sizeof( VkDrawIndexedIndirectCommand ) * objectCount * frameCount,
+                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+
+        // The draw counts are host visible, so the number of visible objects can be reported.
+        m_drawCountBuffer = vkbase::CreateBuffer( m_device,
+                                                  m_allocator,
+                                                  sizeof( uint32_t ) * frameCount,
+                                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+
+        // Descriptor set layout: the instances, the draw commands, and the draw counts.
+        std::vector< VkDescriptorSetLayoutBinding > bindings( 3 );
+        for ( uint32_t bindingIndex = 0; bindingIndex < bindings.size(); ++bindingIndex )
         {
-            createInfo.imageSharingMode      = VK_SHARING_MODE_EXCLUSIVE;
-            createInfo.queueFamilyIndexCount = 0;       // Optional
-            createInfo.pQueueFamilyIndices   = nullptr; // Optional
+            bindings[ bindingIndex ].binding         = bindingIndex;
+            bindings[ bindingIndex ].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[ bindingIndex ].descriptorCount = 1;
+            bindings[ bindingIndex ].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
         }
 
-        // No transformation.
-        createInfo.preTransform = swapChainSupport.m_capabilities.currentTransform;
+        m_cullDescriptorSetLayout = m_descriptorLayoutCache.GetLayout( bindings );
 
-        // Don't alpha-blend with other windows.
-        createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        // Compute pipeline.
+        VkPushConstantRange pushConstantRange = {};
+        pushConstantRange.stageFlags          = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset              = 0;
+        pushConstantRange.size                = sizeof( CullParameters );
 
-        // Present mode.
-        createInfo.presentMode = presentMode;
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount             = 1;
+        pipelineLayoutInfo.pSetLayouts                = &m_cullDescriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount     = 1;
+        pipelineLayoutInfo.pPushConstantRanges        = &pushConstantRange;
+        if ( vkCreatePipelineLayout( m_device, &pipelineLayoutInfo, nullptr, &m_cullPipelineLayout ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create culling pipeline layout." );
+        }
 
-        // Do we care about the color of pixels obscured by a window in the front?
-        createInfo.clipped = VK_TRUE;
+        VkShaderModule compShaderModule = GetShaderModule( "cull.comp.spv" );
+
+        // The workgroup size, and whether to compact the commands, are specialized into the shader, so the
+        // compiler sees a fixed workgroup and folds the branches of the other mode away.
+        m_cullWorkgroupSize = std::max( std::min( { m_options.m_cullWorkgroupSize,
+                                                    properties.limits.maxComputeWorkGroupSize[ 0 ],
+                                                    properties.limits.maxComputeWorkGroupInvocations } ),
+                                        1u );
+        if ( m_cullWorkgroupSize != m_options.m_cullWorkgroupSize )
+        {
+            printf( "Culling workgroup size %u is not supported, using %u.\n",
+                    m_options.m_cullWorkgroupSize,
+                    m_cullWorkgroupSize );
+        }
 
-        // For later, when we want to create a new optimal swap chain to replace an older one.
-        createInfo.oldSwapchain = VK_NULL_HANDLE;
+        CullSpecialization specialization;
+        specialization.Set< CullConstant_WorkgroupSize >( m_cullWorkgroupSize );
+        specialization.Set< CullConstant_Compact >( m_drawIndirectCountSupported ? VK_TRUE : VK_FALSE );
+        VkSpecializationInfo specializationInfo = specialization.GetInfo();
+
+        VkComputePipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType                       = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType                 = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage                 = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module                = compShaderModule;
+        pipelineInfo.stage.pName                 = "main";
+        pipelineInfo.stage.pSpecializationInfo   = &specializationInfo;
+        pipelineInfo.layout                      = m_cullPipelineLayout;
+        if ( vkCreateComputePipelines( m_device, m_pipelineCache, 1, &pipelineInfo, nullptr, &m_cullPipeline ) !=
+             VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create culling pipeline." );
+        }
 
-        if ( vkCreateSwapchainKHR( m_device, &createInfo, nullptr, &m_swapChain ) != VK_SUCCESS )
+        // Culling on the compute queue is recorded into command buffers of its own, and signals the graphics
+        // queue when the draw commands are written: by setting a timeline semaphore to the frame number, or with a
+        // binary semaphore per frame in flight.
+        if ( IsAsyncCulling() )
         {
-            throw std::runtime_error( "failed to create swap chain!" );
+            if ( m_useTimelineSemaphores )
+            {
+                m_cullTimeline.Init( m_device );
+            }
+
+            m_cullCommandPools.resize( frameCount );
+            m_cullCommandBuffers.resize( frameCount );
+            m_cullFinishedSemaphores.resize( frameCount, VK_NULL_HANDLE );
+            for ( uint32_t frameIndex = 0; frameIndex < frameCount; ++frameIndex )
+            {
+                VkCommandPoolCreateInfo commandPoolInfo = {};
+                commandPoolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+                commandPoolInfo.queueFamilyIndex        = m_computeQueue.GetFamilyIndex();
+                commandPoolInfo.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+                if ( vkCreateCommandPool( m_device, &commandPoolInfo, nullptr, &m_cullCommandPools[ frameIndex ] ) !=
+                     VK_SUCCESS )
+                {
+                    throw std::runtime_error( "Failed to create culling command pool." );
+                }
+
+                VkCommandBufferAllocateInfo commandBufferInfo = {};
+                commandBufferInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                commandBufferInfo.commandPool                 = m_cullCommandPools[ frameIndex ];
+                commandBufferInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+                commandBufferInfo.commandBufferCount          = 1;
+                if ( vkAllocateCommandBuffers( m_device, &commandBufferInfo, &m_cullCommandBuffers[ frameIndex ] ) !=
+                     VK_SUCCESS )
+                {
+                    throw std::runtime_error( "Failed to allocate culling command buffer." );
+                }
+
+                if ( m_cullTimeline.IsValid() )
+                {
+                    continue;
+                }
+
+                VkSemaphoreCreateInfo semaphoreInfo = {};
+                semaphoreInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+                if ( vkCreateSemaphore( m_device, &semaphoreInfo, nullptr, &m_cullFinishedSemaphores[ frameIndex ] ) !=
+                     VK_SUCCESS )
+                {
+                    throw std::runtime_error( "Failed to create culling semaphore." );
+                }
+            }
         }
 
-        // Get handles to swap chain images, which we will render into.
-        vkGetSwapchainImagesKHR( m_device, m_swapChain, &imageCount, nullptr );
-        m_swapChainImages.resize( imageCount );
-        vkGetSwapchainImagesKHR( m_device, m_swapChain, &imageCount, m_swapChainImages.data() );
+        printf( "GPU culling enabled, %s, on the %s queue.\n",
+                m_drawIndirectCountSupported ? "with indirect draw counts" : "without indirect draw counts",
+                IsAsyncCulling() ? "compute" : "graphics" );
+    }
 
-        // Cache image format & extent.
-        m_swapChainImageFormat = surfaceFormat.format;
-        m_swapChainExtent      = extent;
+    /// Is culling submitted to a compute queue of another family than the graphics queue, so it overlaps the
+    /// rendering of previous frames?
+    bool IsAsyncCulling() const
+    {
+        return m_options.m_gpuCulling && m_computeQueue.IsOtherFamily( m_graphicsQueue );
     }
 
-    void TeardownSwapChain()
+    /// Make the barriers handing the current frame's draw commands, and draw count, from the culling shader over
+    /// to the indirect draw.  If culling runs on the compute queue, they transfer ownership to the graphics queue.
+    void MakeCullingBarriers( std::array< VkBufferMemoryBarrier, 2 >& o_releaseBarriers,
+                              std::array< VkBufferMemoryBarrier, 2 >& o_acquireBarriers ) const
+    {
+        const VkDeviceSize commandRegionSize = sizeof( VkDrawIndexedIndirectCommand ) * m_options.m_instanceCount;
+        vkbase::MakeBufferOwnershipTransfer( m_drawCommandBuffer.m_buffer,
+                                             commandRegionSize * m_currentFrame,
+                                             commandRegionSize,
+                                             m_computeQueue,
+                                             VK_ACCESS_SHADER_WRITE_BIT,
+                                             m_graphicsQueue,
+                                             VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+                                             o_releaseBarriers[ 0 ],
+                                             o_acquireBarriers[ 0 ] );
+        vkbase::MakeBufferOwnershipTransfer( m_drawCountBuffer.m_buffer,
+                                             sizeof( uint32_t ) * m_currentFrame,
+                                             sizeof( uint32_t ),
+                                             m_computeQueue,
+                                             VK_ACCESS_SHADER_WRITE_BIT,
+                                             m_graphicsQueue,
+                                             VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+                                             o_releaseBarriers[ 1 ],
+                                             o_acquireBarriers[ 1 ] );
+    }
+
+    /// Record a barrier making the current frame's draw count, written by the culling shader, visible to the host
+    /// once the frame completes.  \p i_srcStage is the stage the count was last made visible to on this queue.
+    void RecordDrawCountHostBarrier( VkCommandBuffer i_commandBuffer, VkPipelineStageFlags i_srcStage ) const
+    {
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType                 = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask         = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask         = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer                = m_drawCountBuffer.m_buffer;
+        barrier.offset                = sizeof( uint32_t ) * m_currentFrame;
+        barrier.size                  = sizeof( uint32_t );
+        vkCmdPipelineBarrier(
+            i_commandBuffer, i_srcStage, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr );
+    }
+
+    /// Record the culling of frame \p i_frameNumber into its own command buffer, and submit it to the compute
+    /// queue.
+    void SubmitCulling( uint64_t i_frameNumber )
     {
-        for ( VkFramebuffer framebuffer : m_swapChainFramebuffers )
+        VkCommandBuffer commandBuffer = m_cullCommandBuffers[ m_currentFrame ];
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if ( vkBeginCommandBuffer( commandBuffer, &beginInfo ) != VK_SUCCESS )
         {
-            vkDestroyFramebuffer( m_device, framebuffer, nullptr );
+            throw std::runtime_error( "Failed to begin recording culling command buffer." );
         }
 
-        vkFreeCommandBuffers( m_device,
-                              m_commandPool,
-                              static_cast< uint32_t >( m_commandBuffers.size() ),
-                              m_commandBuffers.data() );
+        RecordCulling( commandBuffer );
 
-        vkDestroyPipeline( m_device, m_graphicsPipeline, nullptr );
-        vkDestroyPipelineLayout( m_device, m_pipelineLayout, nullptr );
-        vkDestroyRenderPass( m_device, m_renderPass, nullptr );
+        if ( vkEndCommandBuffer( commandBuffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to record culling command buffer." );
+        }
 
-        for ( VkImageView imageView : m_swapChainImageViews )
+        vkbase::Submission submission;
+        submission.AddCommandBuffer( commandBuffer );
+        if ( m_cullTimeline.IsValid() )
         {
-            vkDestroyImageView( m_device, imageView, nullptr );
+            submission.Signal( m_cullTimeline.Get(), i_frameNumber );
+        }
+        else
+        {
+            submission.Signal( m_cullFinishedSemaphores[ m_currentFrame ] );
         }
 
-        vkDestroySwapchainKHR( m_device, m_swapChain, nullptr );
+        if ( m_computeQueue.Submit( submission ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to submit culling command buffer." );
+        }
     }
 
-    void RecreateSwapChain()
+    /// Record the culling of the current frame's instances, writing its draw commands.  Recorded outside of the
+    /// render pass, which then consumes the commands.
+    void RecordCulling( VkCommandBuffer i_commandBuffer )
     {
-        // Pause application on minimization.
-        int width = 0, height = 0;
-        do
+        const uint32_t objectCount = m_options.m_instanceCount;
+
+        // Reset the frame's draw count.
+        vkCmdFillBuffer(
+            i_commandBuffer, m_drawCountBuffer.m_buffer, sizeof( uint32_t ) * m_currentFrame, sizeof( uint32_t ), 0 );
+
+        VkMemoryBarrier fillBarrier = {};
+        fillBarrier.sType           = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        fillBarrier.srcAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT;
+        fillBarrier.dstAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier( i_commandBuffer,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                              0,
+                              1,
+                              &fillBarrier,
+                              0,
+                              nullptr,
+                              0,
+                              nullptr );
+
+        // The view is the [-1, 1] square of normalized device coordinates.
+        CullParameters cullParameters = {{{1.0f, 0.0f, 0.0f, 1.0f},
+                                          {-1.0f, 0.0f, 0.0f, 1.0f},
+                                          {0.0f, 1.0f, 0.0f, 1.0f},
+                                          {0.0f, -1.0f, 0.0f, 1.0f}}};
+        cullParameters.m_meshRadius     = m_meshRadius;
+        cullParameters.m_objectCount    = objectCount;
+        cullParameters.m_instanceOffset = static_cast< uint32_t >( m_currentFrame * objectCount );
+        cullParameters.m_commandOffset  = static_cast< uint32_t >( m_currentFrame * objectCount );
+        cullParameters.m_countIndex     = static_cast< uint32_t >( m_currentFrame );
+        cullParameters.m_indexCount     = m_indexCount;
+
+        vkCmdBindPipeline( i_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline );
+        vkCmdBindDescriptorSets( i_commandBuffer,
+                                 VK_PIPELINE_BIND_POINT_COMPUTE,
+                                 m_cullPipelineLayout,
+                                 0,
+                                 1,
+                                 &m_cullDescriptorSet,
+                                 0,
+                                 nullptr );
+        vkCmdPushConstants( i_commandBuffer,
+                            m_cullPipelineLayout,
+                            VK_SHADER_STAGE_COMPUTE_BIT,
+                            0,
+                            sizeof( CullParameters ),
+                            &cullParameters );
+        vkCmdDispatch( i_commandBuffer, ( objectCount + m_cullWorkgroupSize - 1 ) / m_cullWorkgroupSize, 1, 1 );
+
+        // Make the draw commands and count visible to the indirect draw, or release them to the graphics queue.
+        std::array< VkBufferMemoryBarrier, 2 > releaseBarriers;
+        std::array< VkBufferMemoryBarrier, 2 > acquireBarriers;
+        MakeCullingBarriers( releaseBarriers, acquireBarriers );
+        vkCmdPipelineBarrier( i_commandBuffer,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                              IsAsyncCulling() ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT
+                                               : VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                              0,
+                              0,
+                              nullptr,
+                              static_cast< uint32_t >( releaseBarriers.size() ),
+                              releaseBarriers.data(),
+                              0,
+                              nullptr );
+
+        // The draw count is read back on the host.  If it is released to the graphics queue, the barrier is
+        // recorded there, after the acquire.
+        if ( m_drawIndirectCountSupported && !IsAsyncCulling() )
         {
-            glfwGetFramebufferSize( m_window, &width, &height );
-            glfwWaitEvents();
-        } while ( width == 0 || height == 0 );
+            RecordDrawCountHostBarrier( i_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT );
+        }
+    }
 
-        // Wait for graphics operations to complete.
-        vkDeviceWaitIdle( m_device );
+    /// Destroy the culling pipeline, and its buffers.
+    void TeardownCullingResources()
+    {
+        for ( size_t frameIndex = 0; frameIndex < m_cullCommandPools.size(); ++frameIndex )
+        {
+            vkDestroySemaphore( m_device, m_cullFinishedSemaphores[ frameIndex ], nullptr );
+            vkDestroyCommandPool( m_device, m_cullCommandPools[ frameIndex ], nullptr );
+        }
 
-        m_framebufferResized = false;
+        m_cullCommandPools.clear();
+        m_cullCommandBuffers.clear();
+        m_cullFinishedSemaphores.clear();
+        if ( m_cullTimeline.IsValid() )
+        {
+            m_cullTimeline.Teardown();
+        }
 
-        TeardownSwapChain();
+        vkDestroyPipeline( m_device, m_cullPipeline, nullptr );
+        vkDestroyPipelineLayout( m_device, m_cullPipelineLayout, nullptr );
+        vkbase::DestroyBuffer( m_device, m_allocator, m_drawCountBuffer );
+        vkbase::DestroyBuffer( m_device, m_allocator, m_drawCommandBuffer );
+    }
 
-        CreateSwapChain();
-        CreateImageViews();
-        CreateRenderPass();
-        CreateGraphicsPipeline();
-        CreateFramebuffers();
-        CreateCommandBuffers();
+    /// Destroy the instance buffer, and the texture slot buffer.
+    void TeardownInstanceBuffer()
+    {
+        if ( m_options.m_bindless )
+        {
+            vkbase::DestroyBuffer( m_device, m_allocator, m_textureSlotBuffer );
+        }
+
+        vkbase::DestroyBuffer( m_device, m_allocator, m_instanceBuffer );
     }
 
-    void CreateSurface()
+    /// Destroy the descriptor pools, the bindless descriptors, and the cached descriptor set layouts.
+    void TeardownDescriptors()
     {
-        if ( glfwCreateWindowSurface( m_instance, m_window, nullptr, &m_surface ) != VK_SUCCESS )
+        printf( "Descriptors: %zu set layouts (%zu cache hits), %llu sets allocated from %zu pools",
+                m_descriptorLayoutCache.GetLayoutCount(),
+                m_descriptorLayoutCache.GetCacheHitCount(),
+                static_cast< unsigned long long >( m_frameDescriptors.GetAllocationCount() ),
+                m_frameDescriptors.GetPoolCount() );
+        if ( m_options.m_bindless )
         {
-            throw std::runtime_error( "Failed to create window surface." );
+            printf( ", %llu bindless descriptors written",
+                    static_cast< unsigned long long >( m_bindlessDescriptors.GetWriteCount() ) );
+            m_bindlessDescriptors.Teardown();
+            vkDestroySampler( m_device, m_textureSampler, nullptr );
         }
+
+        printf( ".\n" );
+        m_frameDescriptors.Teardown();
+        m_descriptorLayoutCache.Teardown();
     }
 
-    void CreateImageViews()
+    /// Destroy the geometry buffers, and the staging ring.
+    void TeardownGeometryBuffers()
     {
-        m_swapChainImageViews.resize( m_swapChainImages.size() );
-        for ( size_t imageIndex = 0; imageIndex < m_swapChainImages.size(); imageIndex++ )
+        vkbase::DestroyBuffer( m_device, m_allocator, m_indexBuffer );
+        vkbase::DestroyBuffer( m_device, m_allocator, m_vertexBuffer );
+        m_stagingRing.Teardown( m_device, m_allocator );
+
+        vkDestroyFence( m_device, m_uploadFence, nullptr );
+        vkDestroySemaphore( m_device, m_uploadSemaphore, nullptr );
+        vkDestroyCommandPool( m_device, m_uploadAcquireCommandPool, nullptr );
+        vkDestroyCommandPool( m_device, m_uploadCommandPool, nullptr );
+    }
+
+    /// Create the query pool for GPU timestamps, with a begin and end query for each swap chain image's command
+    /// buffer.  No pool is created if the graphics queue does not support timestamps.
+    void CreateTimestampQueryPool()
+    {
+        m_timestampQueryPool = VK_NULL_HANDLE;
+        m_imageFrameNumbers.assign( m_swapChainImages.size(), 0 );
+        m_imageSubmitTimes.assign( m_swapChainImages.size(), 0 );
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties( m_physicalDevice, &queueFamilyCount, nullptr );
+        std::vector< VkQueueFamilyProperties > queueFamilies( queueFamilyCount );
+        vkGetPhysicalDeviceQueueFamilyProperties( m_physicalDevice, &queueFamilyCount, queueFamilies.data() );
+
+        QueueFamilyIndices indices = FindQueueFamilies( m_physicalDevice );
+        m_timestampValidBits       = queueFamilies[ indices.m_graphicsFamily.value() ].timestampValidBits;
+        if ( m_timestampValidBits == 0 )
         {
-            VkImageViewCreateInfo createInfo = {};
-            createInfo.sType                 = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            createInfo.image                 = m_swapChainImages[ imageIndex ];
-            createInfo.viewType              = VK_IMAGE_VIEW_TYPE_2D;
-            createInfo.format                = m_swapChainImageFormat;
+            return;
+        }
 
-            // Do not remap components.
-            createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties( m_physicalDevice, &properties );
+        m_timestampPeriod = properties.limits.timestampPeriod;
 
-            // For displaying color.
-            createInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-            createInfo.subresourceRange.baseMipLevel   = 0;
-            createInfo.subresourceRange.levelCount     = 1;
-            createInfo.subresourceRange.baseArrayLayer = 0;
-            createInfo.subresourceRange.layerCount     = 1;
+        VkQueryPoolCreateInfo createInfo = {};
+        createInfo.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        createInfo.queryType             = VK_QUERY_TYPE_TIMESTAMP;
+        createInfo.queryCount            = static_cast< uint32_t >( 2 * m_swapChainImages.size() );
 
-            if ( vkCreateImageView( m_device, &createInfo, nullptr, &m_swapChainImageViews[ imageIndex ] ) !=
-                 VK_SUCCESS )
-            {
-                throw std::runtime_error( "Failed to create image views." );
-            }
+        if ( vkCreateQueryPool( m_device, &createInfo, nullptr, &m_timestampQueryPool ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create timestamp query pool." );
         }
     }
 
-    VkShaderModule CreateShaderModule( const std::vector< char >& i_code )
+    /// Read back the GPU timestamps of the frame last drawn into the image at \p i_imageIndex, and record
+    /// them with the profiler.  That frame must have completed execution.
+    void ResolveTimestamps( uint32_t i_imageIndex )
     {
-        VkShaderModuleCreateInfo createInfo = {};
-        createInfo.sType                    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize                 = i_code.size(); // Num bytes.
-        createInfo.pCode                    = reinterpret_cast< const uint32_t* >( i_code.data() );
+        if ( m_timestampQueryPool == VK_NULL_HANDLE || m_imageFrameNumbers[ i_imageIndex ] == 0 )
+        {
+            return;
+        }
 
-        VkShaderModule shaderModule;
-        if ( vkCreateShaderModule( m_device, &createInfo, nullptr, &shaderModule ) != VK_SUCCESS )
+        uint64_t timestamps[ 2 ];
+        if ( vkGetQueryPoolResults( m_device,
+                                    m_timestampQueryPool,
+                                    2 * i_imageIndex,
+                                    2,
+                                    sizeof( timestamps ),
+                                    timestamps,
+                                    sizeof( uint64_t ),
+                                    VK_QUERY_RESULT_64_BIT ) != VK_SUCCESS )
         {
-            throw std::runtime_error( "Failed to create shader module." );
+            return;
         }
 
-        return shaderModule;
+        // Only the valid bits of the timestamps are meaningful, which may wrap around.
+        uint64_t validMask = m_timestampValidBits >= 64 ? UINT64_MAX : ( ( uint64_t( 1 ) << m_timestampValidBits ) - 1 );
+        uint64_t ticks     = ( timestamps[ 1 ] - timestamps[ 0 ] ) & validMask;
+
+        // The GPU clock is not calibrated against the CPU clock, so the sample is placed at the submission time.
+        m_profiler.Record( ProfilePhase_GpuRenderPass,
+                           m_imageFrameNumbers[ i_imageIndex ],
+                           m_imageSubmitTimes[ i_imageIndex ],
+                           static_cast< uint64_t >( ticks * m_timestampPeriod ) );
+        m_imageFrameNumbers[ i_imageIndex ] = 0;
     }
 
-    void CreateRenderPass()
+    /// Record the commands drawing a frame into the swap chain image at \p i_imageIndex.
+    void RecordCommandBuffer( VkCommandBuffer i_commandBuffer, uint32_t i_imageIndex )
     {
-        // Color buffer attachment.
-        VkAttachmentDescription colorAttachment = {};
-        colorAttachment.format =
-            m_swapChainImageFormat; // The color buffer should have the same format as our swapchain images.
-        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;        // Only one sample.
-        colorAttachment.loadOp  = VK_ATTACHMENT_LOAD_OP_CLEAR;  // Clear the buffer to constant value, before write.
-        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // Keep the written colors around after.
-        colorAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo         = nullptr; // Optional
 
-        // Reference to the color buffer attachment.
-        VkAttachmentReference colorAttachmentRef = {};
-        colorAttachmentRef.attachment            = 0;
-        colorAttachmentRef.layout                = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        if ( vkBeginCommandBuffer( i_commandBuffer, &beginInfo ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to begin recording command buffer." );
+        }
 
-        // Create the subpass.  In this example, there will only be a single sub-pass.
-        VkSubpassDescription subpass = {};
-        subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS; // This is a graphics subpass (and not compute).
-        subpass.colorAttachmentCount = 1;                   // Only a single color attachment for this subpass.
-        subpass.pColorAttachments    = &colorAttachmentRef; // Reference to the color attachment.
+        // Decide what to draw on the GPU.  Culling on the compute queue has already been submitted, so only the
+        // draw commands it wrote need to be acquired.
+        if ( IsAsyncCulling() )
+        {
+            std::array< VkBufferMemoryBarrier, 2 > releaseBarriers;
+            std::array< VkBufferMemoryBarrier, 2 > acquireBarriers;
+            MakeCullingBarriers( releaseBarriers, acquireBarriers );
+            vkCmdPipelineBarrier( i_commandBuffer,
+                                  VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                                  VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                                  0,
+                                  0,
+                                  nullptr,
+                                  static_cast< uint32_t >( acquireBarriers.size() ),
+                                  acquireBarriers.data(),
+                                  0,
+                                  nullptr );
+
+            // The acquired draw count is read back on the host.
+            if ( m_drawIndirectCountSupported )
+            {
+                RecordDrawCountHostBarrier( i_commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT );
+            }
+        }
+        else if ( m_options.m_gpuCulling )
+        {
+            RecordCulling( i_commandBuffer );
+        }
 
-        // Create the render pass.
-        VkRenderPassCreateInfo renderPassInfo = {};
-        renderPassInfo.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassInfo.attachmentCount        = 1;                // Only a single attachment (the color buffer).
-        renderPassInfo.pAttachments           = &colorAttachment; // The array of attachments.
-        renderPassInfo.subpassCount           = 1;                // Only a single subpass.
-        renderPassInfo.pSubpasses             = &subpass;         // The array of subpasses.
+        // Time the render pass on the GPU.
+        if ( m_timestampQueryPool != VK_NULL_HANDLE )
+        {
+            vkCmdResetQueryPool( i_commandBuffer, m_timestampQueryPool, 2 * i_imageIndex, 2 );
+            vkCmdWriteTimestamp( i_commandBuffer,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                 m_timestampQueryPool,
+                                 2 * i_imageIndex );
+        }
 
-        // Have the implicit subpass to wait until we are ready to write to the color buffer.
-        VkSubpassDependency dependency = {};
-        dependency.srcSubpass          = VK_SUBPASS_EXTERNAL; // Refers to the implicit subpass before the render pass.
-        dependency.dstSubpass          = 0; // This is the implicit subpass after the render pass.  Do nothing.
-        dependency.srcStageMask =
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT; // Wait until we are ready to write color.
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        // Record the passes of the frame graph, each in its own render pass.
+        m_frameGraph.Execute( i_commandBuffer, i_imageIndex );
 
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies   = &dependency;
+        if ( m_timestampQueryPool != VK_NULL_HANDLE )
+        {
+            vkCmdWriteTimestamp( i_commandBuffer,
+                                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                 m_timestampQueryPool,
+                                 2 * i_imageIndex + 1 );
+        }
 
-        if ( vkCreateRenderPass( m_device, &renderPassInfo, nullptr, &m_renderPass ) != VK_SUCCESS )
+        // End recording.
+        if ( vkEndCommandBuffer( i_commandBuffer ) != VK_SUCCESS )
         {
-            throw std::runtime_error( "Failed to create render pass." );
+            throw std::runtime_error( "Failed to record command buffer." );
         }
     }
 
-    void CreateGraphicsPipeline()
+    /// Record the state, and the draw calls numbered from \p i_firstDraw up to \p i_endDraw, of the render pass.
+    void RecordDraws( VkCommandBuffer i_commandBuffer, uint32_t i_firstDraw, uint32_t i_endDraw )
     {
-        std::string         executableDir   = vkbase::GetParentPath( m_executablePath );
-        std::string         shaderDirectory = vkbase::JoinPaths( executableDir, "../shaders/" );
-        std::vector< char > vertShaderCode =
-            vkbase::ReadFile( vkbase::JoinPaths( shaderDirectory, "shader.vert.spv" ) );
-        std::vector< char > fragShaderCode =
-            vkbase::ReadFile( vkbase::JoinPaths( shaderDirectory, "shader.frag.spv" ) );
-
-        // Create shader modules from code.
-        VkShaderModule vertShaderModule = CreateShaderModule( vertShaderCode );
-        VkShaderModule fragShaderModule = CreateShaderModule( fragShaderCode );
-
-        // Create info for vertex shader pipeline stage.
-        VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-        vertShaderStageInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertShaderStageInfo.stage                           = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module                          = vertShaderModule;
-        vertShaderStageInfo.pName                           = "main";
-
-        // Create info for fragment shader pipeline stage.
-        VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-        fragShaderStageInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragShaderStageInfo.stage                           = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module                          = fragShaderModule;
-        fragShaderStageInfo.pName                           = "main";
-
-        // Shader stages.
-        VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-
-        // Vertex input stage.
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-        vertexInputInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount   = 0;
-        vertexInputInfo.pVertexBindingDescriptions      = nullptr; // Optional
-        vertexInputInfo.vertexAttributeDescriptionCount = 0;
-        vertexInputInfo.pVertexAttributeDescriptions    = nullptr; // Optional
+        // Bind the graphics pipeline, or the permutation requested with --draw-variant.
+        VkPipeline pipeline = m_graphicsPipeline;
+        if ( m_options.m_drawVariant.has_value() )
+        {
+            pipeline = m_pipelineVariants.Find( m_drawnPipelineVariant );
+        }
 
-        // Input assembly, describing what kind of geometry will be drawn.
-        VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-        inputAssembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        inputAssembly.primitiveRestartEnable = VK_FALSE;
+        vkCmdBindPipeline( i_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
 
         // Create the viewport.  This is the region in the framebuffer that the pixels will be rendered into.
         VkViewport viewport = {};
@@ -736,229 +4247,176 @@ private:
         viewport.height     = ( float ) m_swapChainExtent.height;
         viewport.minDepth   = 0.0f;
         viewport.maxDepth   = 1.0f;
+        vkCmdSetViewport( i_commandBuffer, 0, 1, &viewport );
 
         // Draw into the entire frame buffer.
         VkRect2D scissor = {};
         scissor.offset   = {0, 0};
         scissor.extent   = m_swapChainExtent;
-
-        // Viewport state.
-        VkPipelineViewportStateCreateInfo viewportState = {};
-        viewportState.sType                             = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportState.viewportCount                     = 1;
-        viewportState.pViewports                        = &viewport;
-        viewportState.scissorCount                      = 1;
-        viewportState.pScissors                         = &scissor;
-
-        // Rasterizer, for converting geometry shapes into fragments for shading.
-        VkPipelineRasterizationStateCreateInfo rasterizer = {};
-        rasterizer.sType                                  = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizer.depthClampEnable                       = VK_FALSE;
-        rasterizer.rasterizerDiscardEnable                = VK_FALSE;
-        rasterizer.polygonMode                            = VK_POLYGON_MODE_FILL;
-        rasterizer.lineWidth                              = 1.0f;
-        rasterizer.cullMode                               = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace                              = VK_FRONT_FACE_CLOCKWISE;
-        rasterizer.depthBiasEnable                        = VK_FALSE;
-        rasterizer.depthBiasConstantFactor                = 0.0f; // Optional
-        rasterizer.depthBiasClamp                         = 0.0f; // Optional
-        rasterizer.depthBiasSlopeFactor                   = 0.0f; // Optional
-
-        // Multi-sampling for reducing edge aliasing (disabled for now.)
-        VkPipelineMultisampleStateCreateInfo multisampling = {};
-        multisampling.sType                                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable                  = VK_FALSE;
-        multisampling.rasterizationSamples                 = VK_SAMPLE_COUNT_1_BIT;
-        multisampling.minSampleShading                     = 1.0f;     // Optional
-        multisampling.pSampleMask                          = nullptr;  // Optional
-        multisampling.alphaToCoverageEnable                = VK_FALSE; // Optional
-        multisampling.alphaToOneEnable                     = VK_FALSE; // Optional
-
-        // Color blending.
-        VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-        colorBlendAttachment.colorWriteMask =
-            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable         = VK_FALSE;
-        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;  // Optional
-        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-        colorBlendAttachment.colorBlendOp        = VK_BLEND_OP_ADD;      // Optional
-        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;  // Optional
-        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-        colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;      // Optional
-
-        // Aggregate of color attachments.
-        VkPipelineColorBlendStateCreateInfo colorBlending = {};
-        colorBlending.sType                               = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        colorBlending.logicOpEnable                       = VK_FALSE;
-        colorBlending.logicOp                             = VK_LOGIC_OP_COPY; // Optional
-        colorBlending.attachmentCount                     = 1;
-        colorBlending.pAttachments                        = &colorBlendAttachment;
-        colorBlending.blendConstants[ 0 ]                 = 0.0f; // Optional
-        colorBlending.blendConstants[ 1 ]                 = 0.0f; // Optional
-        colorBlending.blendConstants[ 2 ]                 = 0.0f; // Optional
-        colorBlending.blendConstants[ 3 ]                 = 0.0f; // Optional
-
-        // Pipeline layout.
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-        pipelineLayoutInfo.sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount             = 0;       // Optional
-        pipelineLayoutInfo.pSetLayouts                = nullptr; // Optional
-        pipelineLayoutInfo.pushConstantRangeCount     = 0;       // Optional
-        pipelineLayoutInfo.pPushConstantRanges        = nullptr; // Optional
-        if ( vkCreatePipelineLayout( m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout ) != VK_SUCCESS )
+        vkCmdSetScissor( i_commandBuffer, 0, 1, &scissor );
+
+        // Bind the frame's descriptor set, once for all the draws of the command buffer, and select the region of
+        // the current frame in flight.
+        vkCmdBindDescriptorSets( i_commandBuffer,
+                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                 m_pipelineLayout,
+                                 0,
+                                 1,
+                                 &m_frameDescriptorSet,
+                                 0,
+                                 nullptr );
+
+        DrawParameters drawParameters   = {};
+        drawParameters.m_meshScale      = 1.0f;
+        drawParameters.m_instanceOffset = static_cast< uint32_t >( m_currentFrame * m_options.m_instanceCount );
+        vkCmdPushConstants( i_commandBuffer,
+                            m_pipelineLayout,
+                            VK_SHADER_STAGE_VERTEX_BIT,
+                            0,
+                            sizeof( DrawParameters ),
+                            &drawParameters );
+
+        // Bind the geometry.
+        VkBuffer     vertexBuffers[] = {m_vertexBuffer.m_buffer};
+        VkDeviceSize offsets[]       = {0};
+        vkCmdBindVertexBuffers( i_commandBuffer, 0, 1, vertexBuffers, offsets );
+        vkCmdBindIndexBuffer( i_commandBuffer, m_indexBuffer.m_buffer, 0, VK_INDEX_TYPE_UINT32 );
+
+        // Draw the commands written by the culling shader.
+        if ( m_options.m_gpuCulling )
         {
-            throw std::runtime_error( "failed to create pipeline layout!" );
-        }
+            const uint32_t     objectCount   = m_options.m_instanceCount;
+            const VkDeviceSize commandOffset = sizeof( VkDrawIndexedIndirectCommand ) * m_currentFrame * objectCount;
+            if ( m_drawIndirectCountSupported )
+            {
+                m_cmdDrawIndexedIndirectCount( i_commandBuffer,
+                                               m_drawCommandBuffer.m_buffer,
+                                               commandOffset,
+                                               m_drawCountBuffer.m_buffer,
+                                               sizeof( uint32_t ) * m_currentFrame,
+                                               objectCount,
+                                               sizeof( VkDrawIndexedIndirectCommand ) );
+            }
+            else
+            {
+                vkCmdDrawIndexedIndirect( i_commandBuffer,
+                                          m_drawCommandBuffer.m_buffer,
+                                          commandOffset,
+                                          objectCount,
+                                          sizeof( VkDrawIndexedIndirectCommand ) );
+            }
 
-        // Now, create the pipeline!
-        VkGraphicsPipelineCreateInfo pipelineInfo = {};
-        pipelineInfo.sType                        = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount                   = 2;                // Number of _programmable_ stages.
-        pipelineInfo.pStages                      = shaderStages;     // Array of programmable stages.
-        pipelineInfo.pVertexInputState            = &vertexInputInfo; // Vertex input.
-        pipelineInfo.pInputAssemblyState          = &inputAssembly;   // Input assembly.
-        pipelineInfo.pViewportState               = &viewportState;   // Viewport.
-        pipelineInfo.pRasterizationState          = &rasterizer;      // Rasterization state.
-        pipelineInfo.pMultisampleState            = &multisampling;   // Multi sampling.
-        pipelineInfo.pDepthStencilState           = nullptr;          // No depth / stenciling.
-        pipelineInfo.pColorBlendState             = &colorBlending;   // Color blending.
-        pipelineInfo.pDynamicState                = nullptr;          // Optional
-        pipelineInfo.layout                       = m_pipelineLayout; // Layout.
-        pipelineInfo.renderPass                   = m_renderPass; // The render pass, with the color buffer attachment.
-        pipelineInfo.subpass            = 0; // The index of the subpass, where this graphics pipeline will be used.
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Pipeline to derived from.  None, in this case.
-        pipelineInfo.basePipelineIndex  = -1;             // ???
-        if ( vkCreateGraphicsPipelines( m_device,
-                                        /* pipelineCache */ VK_NULL_HANDLE,
-                                        1,
-                                        &pipelineInfo,
-                                        nullptr,
-                                        &m_graphicsPipeline ) != VK_SUCCESS )
-        {
-            throw std::runtime_error( "Failed to create graphics pipeline." );
+            return;
         }
 
-        vkDestroyShaderModule( m_device, fragShaderModule, nullptr );
-        vkDestroyShaderModule( m_device, vertShaderModule, nullptr );
-    }
-
-    void CreateFramebuffers()
-    {
-        m_swapChainFramebuffers.resize( m_swapChainImageViews.size() );
-        for ( size_t imageIndex = 0; imageIndex < m_swapChainImageViews.size(); imageIndex++ )
+        // Draw commands, each covering an equal share of the triangles.
+        const uint32_t triangleCount = m_indexCount / 3;
+        for ( uint32_t drawIndex = i_firstDraw; drawIndex < i_endDraw; ++drawIndex )
         {
-            VkImageView attachments[] = {m_swapChainImageViews[ imageIndex ]};
-
-            VkFramebufferCreateInfo framebufferInfo = {};
-            framebufferInfo.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebufferInfo.renderPass      = m_renderPass; // The render pass that this framebuffer is compatible with.
-            framebufferInfo.attachmentCount = 1;            // Same number of attachments as the render pass.
-            framebufferInfo.pAttachments    = attachments;  // attached image view.
-            framebufferInfo.width           = m_swapChainExtent.width; // Extent.
-            framebufferInfo.height          = m_swapChainExtent.height;
-            framebufferInfo.layers          = 1; // The entries in the swap chain are single images.
-
-            if ( vkCreateFramebuffer( m_device, &framebufferInfo, nullptr, &m_swapChainFramebuffers[ imageIndex ] ) !=
-                 VK_SUCCESS )
-            {
-                throw std::runtime_error( "Failed to create framebuffer." );
-            }
+            uint32_t firstTriangle = static_cast< uint32_t >( uint64_t( triangleCount ) * drawIndex /
+                                                              m_options.m_drawsPerFrame );
+            uint32_t endTriangle   = static_cast< uint32_t >( uint64_t( triangleCount ) * ( drawIndex + 1 ) /
+                                                            m_options.m_drawsPerFrame );
+            vkCmdDrawIndexed( i_commandBuffer,
+                              /*numIndices*/ 3 * ( endTriangle - firstTriangle ),
+                              /*numInstances*/ m_options.m_instanceCount,
+                              /*firstIndex*/ 3 * firstTriangle,
+                              /*vertexOffset*/ 0,
+                              /*instanceOffset*/ 0 );
         }
     }
 
-    void CreateCommandPool()
+    /// Record the draws of the scene pass of the frame graph.
+    ///
+    /// With VK_SUBPASS_CONTENTS_INLINE the render pass commands are embedded in the command buffer itself,
+    /// whereas with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS they are executed from secondary command
+    /// buffers.
+    void RecordScenePass( VkCommandBuffer i_commandBuffer, uint32_t i_imageIndex )
     {
-        QueueFamilyIndices queueFamilyIndices = FindQueueFamilies( m_physicalDevice );
-
-        VkCommandPoolCreateInfo poolInfo = {};
-        poolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        poolInfo.queueFamilyIndex =
-            queueFamilyIndices.m_graphicsFamily.value(); // The queue that the commands will be submitted to.
-        poolInfo.flags = 0;                              // Controls command buffer behavior.
-
-        if ( vkCreateCommandPool( m_device, &poolInfo, nullptr, &m_commandPool ) != VK_SUCCESS )
+        if ( m_jobSystem == nullptr )
         {
-            throw std::runtime_error( "Failed to create command pool." );
+            RecordDraws( i_commandBuffer, 0, m_options.m_drawsPerFrame );
+        }
+        else
+        {
+            RecordSecondaryCommandBuffers( i_imageIndex );
+            vkCmdExecuteCommands( i_commandBuffer,
+                                  static_cast< uint32_t >( m_secondaryCommandBuffers.size() ),
+                                  m_secondaryCommandBuffers.data() );
         }
     }
 
-    void CreateCommandBuffers()
+    /// Record the draw calls of the frame into secondary command buffers, in parallel on the job system.  Each
+    /// job records a contiguous range of draws, with a command buffer from its thread's command pool.
+    void RecordSecondaryCommandBuffers( uint32_t i_imageIndex )
     {
-        // There will be a buffer for each frame buffer in the swap chain.
-        m_commandBuffers.resize( m_swapChainFramebuffers.size() );
-
-        VkCommandBufferAllocateInfo allocInfo = {};
-        allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool                 = m_commandPool; // The parent command pool, managing the buffer memory.
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; // PRIMARY level can be submitted to a queue for execution.
-        allocInfo.commandBufferCount = ( uint32_t ) m_commandBuffers.size();
+        VkCommandBufferInheritanceInfo inheritanceInfo = {};
+        inheritanceInfo.sType                          = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass                     = m_frameGraph.GetRenderPass( m_scenePass );
+        inheritanceInfo.subpass                        = 0;
+        inheritanceInfo.framebuffer                    = m_frameGraph.GetFramebuffer( m_scenePass, i_imageIndex );
+
+        const uint32_t jobCount = std::min( m_options.m_drawsPerFrame,
+                                            static_cast< uint32_t >( m_jobSystem->GetThreadCount() ) *
+                                                s_recordJobsPerThread );
+        m_secondaryCommandBuffers.resize( jobCount );
+
+        std::vector< WorkerCommandPool >& workerPools = m_workerCommandPools[ m_currentFrame ];
+        m_jobSystem->ParallelFor( jobCount, [&]( size_t i_jobIndex, size_t i_threadIndex ) {
+            // Command buffers are kept allocated across resets of the pool, and reused.
+            WorkerCommandPool& workerPool = workerPools[ i_threadIndex ];
+            if ( workerPool.m_usedCount == workerPool.m_commandBuffers.size() )
+            {
+                VkCommandBufferAllocateInfo allocInfo = {};
+                allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                allocInfo.commandPool                 = workerPool.m_commandPool;
+                allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+                allocInfo.commandBufferCount          = 1;
+
+                VkCommandBuffer commandBuffer;
+                if ( vkAllocateCommandBuffers( m_device, &allocInfo, &commandBuffer ) != VK_SUCCESS )
+                {
+                    throw std::runtime_error( "Failed to allocate secondary command buffer." );
+                }
+
+                workerPool.m_commandBuffers.push_back( commandBuffer );
+            }
 
-        if ( vkAllocateCommandBuffers( m_device, &allocInfo, m_commandBuffers.data() ) != VK_SUCCESS )
-        {
-            throw std::runtime_error( "Failed to allocate command buffers." );
-        }
+            VkCommandBuffer commandBuffer = workerPool.m_commandBuffers[ workerPool.m_usedCount++ ];
 
-        // Begin recording into the command buffer(s).
-        for ( size_t bufferIndex = 0; bufferIndex < m_commandBuffers.size(); bufferIndex++ )
-        {
             VkCommandBufferBeginInfo beginInfo = {};
             beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            beginInfo.flags                    = 0;       // Optional
-            beginInfo.pInheritanceInfo         = nullptr; // Optional
-
-            if ( vkBeginCommandBuffer( m_commandBuffers[ bufferIndex ], &beginInfo ) != VK_SUCCESS )
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            beginInfo.pInheritanceInfo = &inheritanceInfo;
+            if ( vkBeginCommandBuffer( commandBuffer, &beginInfo ) != VK_SUCCESS )
             {
-                throw std::runtime_error( "Failed to begin recording command buffer." );
+                throw std::runtime_error( "Failed to begin recording secondary command buffer." );
             }
 
-            // Begin recording the render pass command.
-            VkRenderPassBeginInfo renderPassInfo = {};
-            renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass            = m_renderPass;
-            renderPassInfo.framebuffer = m_swapChainFramebuffers[ bufferIndex ]; // The associated frame buffer.
+            uint32_t firstDraw = static_cast< uint32_t >( uint64_t( m_options.m_drawsPerFrame ) * i_jobIndex / jobCount );
+            uint32_t endDraw =
+                static_cast< uint32_t >( uint64_t( m_options.m_drawsPerFrame ) * ( i_jobIndex + 1 ) / jobCount );
+            RecordDraws( commandBuffer, firstDraw, endDraw );
 
-            // Describes where the shader loads and stores will take place.
-            renderPassInfo.renderArea.offset = {0, 0};
-            renderPassInfo.renderArea.extent = m_swapChainExtent;
-
-            // The color value used to reset the attachment to before writing.
-            VkClearValue clearColor        = {0.0f, 0.0f, 0.0f, 1.0f};
-            renderPassInfo.clearValueCount = 1;
-            renderPassInfo.pClearValues    = &clearColor;
-
-            // Begin render pass.
-            //
-            // VK_SUBPASS_CONTENTS_INLINE means that the render pass commands are embedded in the command buffer
-            // itself.  No secondary command buffers are executed.
-            vkCmdBeginRenderPass( m_commandBuffers[ bufferIndex ], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
-
-            // Bind the graphics pipeline.
-            vkCmdBindPipeline( m_commandBuffers[ bufferIndex ], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline );
-
-            // Draw command.
-            vkCmdDraw( m_commandBuffers[ bufferIndex ],
-                       /*numVerts*/ 3,
-                       /*numInstances*/ 1,
-                       /*vertOffset*/ 0,
-                       /*instanceOffset*/ 0 );
-
-            // End render pass.
-            vkCmdEndRenderPass( m_commandBuffers[ bufferIndex ] );
-
-            // End recording.
-            if ( vkEndCommandBuffer( m_commandBuffers[ bufferIndex ] ) != VK_SUCCESS )
+            if ( vkEndCommandBuffer( commandBuffer ) != VK_SUCCESS )
             {
-                throw std::runtime_error( "Failed to record command buffer." );
+                throw std::runtime_error( "Failed to record secondary command buffer." );
             }
-        }
+
+            m_secondaryCommandBuffers[ i_jobIndex ] = commandBuffer;
+        } );
     }
 
+    /// Create the semaphores for acquiring and presenting images, and the timeline semaphore or fences tracking
+    /// frame completion.
     void CreateSyncObjects()
     {
-        m_imageAvailableSemaphores.resize( s_maxFramesInFlight );
-        m_renderFinishedSemaphores.resize( s_maxFramesInFlight );
-        m_inFlightFences.resize( s_maxFramesInFlight );
-        m_imagesInFlight.resize( m_swapChainImages.size(), VK_NULL_HANDLE );
+        m_imageAvailableSemaphores.resize( m_options.m_framesInFlight );
+        m_renderFinishedSemaphores.resize( m_options.m_framesInFlight );
+        m_inFlightFences.resize( m_options.m_framesInFlight, VK_NULL_HANDLE );
+        m_imageFrameNumbersInFlight.resize( m_swapChainImages.size(), 0 );
+        m_inFlightFrameNumbers.resize( m_options.m_framesInFlight, 0 );
+        m_inFlightInputTimes.resize( m_options.m_framesInFlight, 0 );
 
         VkSemaphoreCreateInfo semaphoreInfo = {};
         semaphoreInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -968,105 +4426,352 @@ private:
         // Create in a signaled state, as if we had rendered an initial frame that finished.
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        for ( size_t frameIndex = 0; frameIndex < s_maxFramesInFlight; ++frameIndex )
+        for ( size_t frameIndex = 0; frameIndex < m_inFlightFences.size(); ++frameIndex )
         {
             if ( vkCreateSemaphore( m_device, &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[ frameIndex ] ) !=
                      VK_SUCCESS ||
                  vkCreateSemaphore( m_device, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[ frameIndex ] ) !=
                      VK_SUCCESS ||
-                 vkCreateFence( m_device, &fenceInfo, nullptr, &m_inFlightFences[ frameIndex ] ) != VK_SUCCESS )
+                 ( !m_useTimelineSemaphores &&
+                   vkCreateFence( m_device, &fenceInfo, nullptr, &m_inFlightFences[ frameIndex ] ) != VK_SUCCESS ) )
             {
                 throw std::runtime_error( "Failed to create synchronization objects." );
             }
         }
+
+        // Binary semaphores remain for acquisition and presentation, which do not support timeline semaphores.
+        if ( m_useTimelineSemaphores )
+        {
+            m_frameTimeline.Init( m_device );
+        }
+
+        printf( "Tracking frame completion with %s.\n", m_useTimelineSemaphores ? "a timeline semaphore" : "fences" );
+    }
+
+    /// Has frame \p i_frameNumber completed execution on the device?  Does not block.
+    bool IsFrameComplete( uint64_t i_frameNumber )
+    {
+        if ( i_frameNumber <= m_completedFrameNumber )
+        {
+            return true;
+        }
+
+        if ( m_useTimelineSemaphores )
+        {
+            // The value of the timeline is the number of the latest completed frame.
+            m_completedFrameNumber = std::max( m_completedFrameNumber, m_frameTimeline.GetCompletedValue() );
+        }
+        else
+        {
+            // A signaled fence means the frame last submitted with it, and every frame before it, has completed.
+            for ( size_t frameIndex = 0; frameIndex < m_inFlightFences.size(); ++frameIndex )
+            {
+                if ( m_inFlightFrameNumbers[ frameIndex ] > m_completedFrameNumber &&
+                     vkGetFenceStatus( m_device, m_inFlightFences[ frameIndex ] ) == VK_SUCCESS )
+                {
+                    m_completedFrameNumber = m_inFlightFrameNumbers[ frameIndex ];
+                }
+            }
+        }
+
+        return i_frameNumber <= m_completedFrameNumber;
+    }
+
+    /// Record the input latency of each frame in flight observed to have completed, by polling the timeline
+    /// semaphore or fences.  Completion is polled once or twice per frame, so each sample is an upper bound of
+    /// the latency, by at most the CPU time of a frame.
+    void RecordInputLatencies()
+    {
+        for ( size_t frameIndex = 0; frameIndex < m_inFlightInputTimes.size(); ++frameIndex )
+        {
+            if ( m_inFlightInputTimes[ frameIndex ] == 0 || !IsFrameComplete( m_inFlightFrameNumbers[ frameIndex ] ) )
+            {
+                continue;
+            }
+
+            m_profiler.Record( ProfilePhase_InputLatency,
+                               m_inFlightFrameNumbers[ frameIndex ],
+                               m_inFlightInputTimes[ frameIndex ],
+                               vkbase::GetTimeNanoseconds() - m_inFlightInputTimes[ frameIndex ] );
+            m_inFlightInputTimes[ frameIndex ] = 0;
+        }
+    }
+
+    /// Block until frame \p i_frameNumber has completed execution on the device.
+    void WaitForFrame( uint64_t i_frameNumber )
+    {
+        if ( IsFrameComplete( i_frameNumber ) )
+        {
+            return;
+        }
+
+        m_frameWaitCount++;
+        if ( m_useTimelineSemaphores )
+        {
+            m_frameTimeline.Wait( i_frameNumber );
+            m_completedFrameNumber = i_frameNumber;
+        }
+        else
+        {
+            // Frames are submitted with each frame in flight's fence in turn.  The fence may have been submitted
+            // again since, by a later frame, which is then waited on instead.
+            size_t frameIndex = static_cast< size_t >( ( i_frameNumber - 1 ) % m_inFlightFences.size() );
+            vkWaitForFences( m_device, 1, &m_inFlightFences[ frameIndex ], VK_TRUE, UINT64_MAX );
+            m_completedFrameNumber = m_inFlightFrameNumbers[ frameIndex ];
+        }
     }
 
     // Initialize the Vulkan instance.
     void InitVulkan()
     {
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
         CreateVulkanInstance();
         SetupDebugMessenger();
-        CreateSurface();
+        if ( !m_options.m_headless )
+        {
+            CreateSurface();
+        }
+
         SelectPhysicalDevice();
         CreateLogicalDevice();
-        CreateSwapChain();
+        ChooseDepthFormat();
+        ChooseSampleCount();
+        CreatePipelineCache();
+        if ( m_options.m_headless )
+        {
+            CreateOffscreenImages();
+        }
+        else
+        {
+            CreateSwapChain();
+        }
+
         CreateImageViews();
-        CreateRenderPass();
+        CreateFrameGraph();
+        if ( m_options.m_frameGraphChainLength > 0 )
+        {
+            ReportFrameGraphAliasing();
+        }
+
+        CreateDescriptors();
         CreateGraphicsPipeline();
-        CreateFramebuffers();
         CreateCommandPool();
-        CreateCommandBuffers();
+        CreateGeometryBuffers();
+        if ( m_options.m_textureCount > 0 )
+        {
+            CreateTextureStreamer();
+        }
+
+        CreateInstanceBuffer();
+        if ( m_options.m_gpuCulling )
+        {
+            CreateCullingResources();
+        }
+
+        CreateTimestampQueryPool();
+        CreateFrameCommandPools();
         CreateSyncObjects();
+        StartShaderWatcher();
+
+        printf( "Initialized Vulkan in %.3f ms.\n", GetMillisecondsSince( startTime ) );
     }
 
     /// Draw a single frame, by submitting the command buffer.
     void DrawFrame()
     {
+        const uint64_t      frameNumber = m_frameNumber + 1;
+        vkbase::ScopedTimer frameTimer( m_profiler, ProfilePhase_Frame, frameNumber );
+
+        SwapReloadedPipeline();
+
+        // Poll for frames which completed since the previous frame, before blocking on any of them.
+        RecordInputLatencies();
+
         // CPU - GPU Synchronization.
-        vkWaitForFences( m_device, 1, &m_inFlightFences[ m_currentFrame ], VK_TRUE, UINT64_MAX );
+        {
+            vkbase::ScopedTimer timer( m_profiler, ProfilePhase_FenceWait, frameNumber );
+            WaitForFrame( m_inFlightFrameNumbers[ m_currentFrame ] );
+        }
 
-        // Acquire an image from the swap chain.
-        uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR( m_device,
-                                                 m_swapChain,
-                                                 /*timeOut*/ UINT64_MAX,
-                                                 m_imageAvailableSemaphores[ m_currentFrame ],
-                                                 VK_NULL_HANDLE,
-                                                 &imageIndex );
+        RecordInputLatencies();
 
-        // Is the swap-chain sub-optimal?
-        if ( result == VK_ERROR_OUT_OF_DATE_KHR )
+        // Count the objects which survived culling in the frame last drawn with this frame in flight.
+        if ( m_options.m_gpuCulling && m_drawIndirectCountSupported && m_inFlightFrameNumbers[ m_currentFrame ] != 0 )
         {
-            RecreateSwapChain();
-            return;
+            m_visibleObjectCount +=
+                static_cast< const uint32_t* >( m_drawCountBuffer.m_allocation.m_mappedData )[ m_currentFrame ];
+            m_culledFrameCount++;
+        }
+
+        // The command buffer of this frame in flight is no longer executing, so its pool can be reset wholesale.
+        vkResetCommandPool( m_device, m_frameCommandPools[ m_currentFrame ], 0 );
+        if ( IsAsyncCulling() )
+        {
+            // The frame's graphics work waited on its culling, so that has completed too.
+            vkResetCommandPool( m_device, m_cullCommandPools[ m_currentFrame ], 0 );
         }
-        else if ( result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR )
+
+        if ( m_jobSystem != nullptr )
         {
-            throw std::runtime_error( "Failed to acquire swap chain image." );
+            for ( WorkerCommandPool& workerPool : m_workerCommandPools[ m_currentFrame ] )
+            {
+                vkResetCommandPool( m_device, workerPool.m_commandPool, 0 );
+                workerPool.m_usedCount = 0;
+            }
         }
 
-        // Check if a previous frame is using this image (i.e. there is its fence to wait on)
-        if ( m_imagesInFlight[ imageIndex ] != VK_NULL_HANDLE )
+        // Refresh the latest completed frame, without blocking, then destroy the objects retired before it.
+        IsFrameComplete( m_frameNumber );
+        m_deletionQueue.Flush( m_completedFrameNumber );
+
+        uint32_t imageIndex;
+        VkResult result = VK_SUCCESS;
+
+        // An image acquired from a sub-optimal swap chain can still be drawn and presented, after which the swap
+        // chain is recreated.
+        bool swapChainSuboptimal = false;
+        if ( m_options.m_headless )
+        {
+            // Cycle through the offscreen images.
+            imageIndex = static_cast< uint32_t >( m_frameNumber % m_swapChainImages.size() );
+        }
+        else
         {
-            vkWaitForFences( m_device, 1, &m_imagesInFlight[ imageIndex ], VK_TRUE, UINT64_MAX );
+            // Acquire an image from the swap chain.
+            {
+                vkbase::ScopedTimer timer( m_profiler, ProfilePhase_Acquire, frameNumber );
+                result = vkAcquireNextImageKHR( m_device,
+                                                m_swapChain,
+                                                /*timeOut*/ UINT64_MAX,
+                                                m_imageAvailableSemaphores[ m_currentFrame ],
+                                                VK_NULL_HANDLE,
+                                                &imageIndex );
+            }
+
+            // Is the swap-chain out of date?  No image was acquired, so there is nothing to draw into.
+            if ( result == VK_ERROR_OUT_OF_DATE_KHR )
+            {
+                RecreateSwapChain();
+                return;
+            }
+            else if ( result == VK_SUBOPTIMAL_KHR )
+            {
+                swapChainSuboptimal = true;
+            }
+            else if ( result != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to acquire swap chain image." );
+            }
         }
 
+        // Wait for the previous frame drawn into this image, if any, to complete.
+        WaitForFrame( m_imageFrameNumbersInFlight[ imageIndex ] );
+
+        // The previous frame drawn into this image has completed, so its timestamps are available.
+        ResolveTimestamps( imageIndex );
+
         // Mark the image as now being in use by this frame
-        m_imagesInFlight[ imageIndex ] = m_inFlightFences[ m_currentFrame ];
+        m_imageFrameNumbersInFlight[ imageIndex ] = frameNumber;
+
+        // Stream in this frame's textures, then write its instance data and descriptors, then record its commands.
+        if ( m_options.m_textureCount > 0 )
+        {
+            vkbase::ScopedTimer timer( m_profiler, ProfilePhase_StreamTextures, frameNumber );
+            StreamTextures( frameNumber );
+        }
+
+        {
+            vkbase::ScopedTimer timer( m_profiler, ProfilePhase_UpdateInstances, frameNumber );
+            UpdateInstances( frameNumber );
+        }
+
+        {
+            vkbase::ScopedTimer timer( m_profiler, ProfilePhase_UpdateDescriptors, frameNumber );
+            UpdateFrameDescriptors();
+        }
+
+        {
+            vkbase::ScopedTimer timer( m_profiler, ProfilePhase_Record, frameNumber );
+            uint64_t            recordStartTime = vkbase::GetTimeNanoseconds();
 
-        // Submit a command buffer.
-        VkSubmitInfo submitInfo      = {};
-        submitInfo.sType             = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        VkSemaphore waitSemaphores[] = {m_imageAvailableSemaphores[ m_currentFrame ]}; // Wait until image is acquired.
+            // Submitted ahead of the graphics work, which waits on it only before its indirect draws.
+            if ( IsAsyncCulling() )
+            {
+                SubmitCulling( frameNumber );
+            }
+
+            RecordCommandBuffer( m_frameCommandBuffers[ m_currentFrame ], imageIndex );
+            m_recordTime += vkbase::GetTimeNanoseconds() - recordStartTime;
+        }
 
-        // The graphics pipeline will execute up until the the color output stage, to wait on the semaphore.
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+        // Submit the command buffer recorded for this frame.
+        VkSemaphore        renderFinishedSemaphore = m_renderFinishedSemaphores[ m_currentFrame ];
+        vkbase::Submission submission;
+        submission.AddCommandBuffer( m_frameCommandBuffers[ m_currentFrame ] );
 
-        submitInfo.waitSemaphoreCount = 1; // Number of semaphores to wait on.
-        submitInfo.pWaitSemaphores    = waitSemaphores;
-        submitInfo.pWaitDstStageMask  = waitStages; // Each entry in waitStages correspond to the semaphore it waits on.
+        // Offscreen images are not acquired, nor presented.
+        if ( !m_options.m_headless )
+        {
+            // The graphics pipeline will execute up until the the color output stage, to wait until the image is
+            // acquired.  Then signal that rendering has finished, for presentation.
+            submission.Wait( m_imageAvailableSemaphores[ m_currentFrame ],
+                             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+            submission.Signal( renderFinishedSemaphore );
+        }
 
-        // Bind the command buffer respective to the swap chain image.
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers    = &m_commandBuffers[ imageIndex ];
+        // Culling on the compute queue writes the draw commands of this frame.
+        if ( m_cullTimeline.IsValid() )
+        {
+            submission.Wait( m_cullTimeline.Get(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, frameNumber );
+        }
+        else if ( IsAsyncCulling() )
+        {
+            submission.Wait( m_cullFinishedSemaphores[ m_currentFrame ], VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT );
+        }
 
-        // The semphore to signal once command buffers have finished execution.
-        VkSemaphore signalSemaphores[]  = {m_renderFinishedSemaphores[ m_currentFrame ]};
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores    = signalSemaphores;
+        // Mark the frame's completion, by setting the timeline to its number, or signaling its fence.
+        if ( m_useTimelineSemaphores )
+        {
+            submission.Signal( m_frameTimeline.Get(), frameNumber );
+        }
 
         // Submit to the graphics queue.
-        vkResetFences( m_device, 1, &m_inFlightFences[ m_currentFrame ] );
-        if ( vkQueueSubmit( m_graphicsQueue, 1, &submitInfo, m_inFlightFences[ m_currentFrame ] ) != VK_SUCCESS )
         {
-            throw std::runtime_error( "failed to submit draw command buffer!" );
+            vkbase::ScopedTimer timer( m_profiler, ProfilePhase_Submit, frameNumber );
+            if ( !m_useTimelineSemaphores )
+            {
+                vkResetFences( m_device, 1, &m_inFlightFences[ m_currentFrame ] );
+            }
+
+            if ( m_graphicsQueue.Submit( submission, m_inFlightFences[ m_currentFrame ] ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "failed to submit draw command buffer!" );
+            }
+        }
+
+        m_imageFrameNumbers[ imageIndex ] = frameNumber;
+        m_imageSubmitTimes[ imageIndex ]  = vkbase::GetTimeNanoseconds();
+
+        m_lastImageIndex = imageIndex;
+        m_frameNumber++;
+        m_inFlightFrameNumbers[ m_currentFrame ] = m_frameNumber;
+        m_inFlightInputTimes[ m_currentFrame ]   = m_inputTime;
+
+        // Increment frame.  The frame has been submitted, so its semaphores and fence are in use regardless of
+        // the outcome of presentation.
+        m_currentFrame = ( m_currentFrame + 1 ) % m_options.m_framesInFlight;
+
+        if ( m_options.m_headless )
+        {
+            return;
         }
 
         // Presentation.
         VkPresentInfoKHR presentInfo   = {};
         presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores    = signalSemaphores; // Presentation shuold wait on m_renderFinishedSemaphore.
+        presentInfo.pWaitSemaphores    = &renderFinishedSemaphore; // Presentation waits for rendering to finish.
 
         VkSwapchainKHR swapChains[] = {m_swapChain};
         presentInfo.swapchainCount  = 1;
@@ -1076,48 +4781,221 @@ private:
         presentInfo.pResults = nullptr; // Optional
 
         // Present!
-        result = vkQueuePresentKHR( m_presentQueue, &presentInfo );
-        if ( result == VK_ERROR_OUT_OF_DATE_KHR || result != VK_SUBOPTIMAL_KHR || m_framebufferResized )
+        {
+            vkbase::ScopedTimer timer( m_profiler, ProfilePhase_Present, frameNumber );
+            result = vkQueuePresentKHR( m_presentQueue, &presentInfo );
+        }
+        if ( result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || swapChainSuboptimal ||
+             m_framebufferResized )
         {
             RecreateSwapChain();
-            return;
         }
         else if ( result != VK_SUCCESS )
         {
-            throw std::runtime_error( "Failed to acquire swap chain image." );
+            throw std::runtime_error( "Failed to present swap chain image." );
         }
-
-        // Increment frame.
-        m_currentFrame = ( m_currentFrame + 1 ) % s_maxFramesInFlight;
     }
 
     // The main event loop.
     void MainLoop()
     {
-        while ( !glfwWindowShouldClose( m_window ) )
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+        if ( m_options.m_headless )
+        {
+            while ( m_frameNumber < m_options.m_frameCount )
+            {
+                m_inputTime = vkbase::GetTimeNanoseconds();
+                DrawFrame();
+                UpdateProfiler();
+            }
+        }
+        else
         {
-            glfwPollEvents();
-            DrawFrame();
+            while ( !glfwWindowShouldClose( m_window ) &&
+                    ( m_options.m_frameCount == 0 || m_frameNumber < m_options.m_frameCount ) )
+            {
+                m_inputTime = vkbase::GetTimeNanoseconds();
+                glfwPollEvents();
+                DrawFrame();
+                UpdateProfiler();
+            }
         }
 
         // Functions submitted in DrawFrame are asynchronous, so operations may still be in flight.
         // We would like to wait until our device has finished execution.
         vkDeviceWaitIdle( m_device );
+
+        double elapsedSeconds =
+            std::chrono::duration< double >( std::chrono::steady_clock::now() - startTime ).count();
+        printf( "Drew %llu frames in %.3f seconds (%.1f frames per second).\n",
+                static_cast< unsigned long long >( m_frameNumber ),
+                elapsedSeconds,
+                elapsedSeconds > 0.0 ? m_frameNumber / elapsedSeconds : 0.0 );
+        printf( "Swap chain recreations: %llu, resize events: %llu, in %llu batches.\n",
+                static_cast< unsigned long long >( m_swapChainRecreationCount ),
+                static_cast< unsigned long long >( m_resizeEventCount ),
+                static_cast< unsigned long long >( m_resizeRequestCount ) );
+        printf( "Blocked on frame completion %llu times, with %s.\n",
+                static_cast< unsigned long long >( m_frameWaitCount ),
+                m_useTimelineSemaphores ? "a timeline semaphore" : "fences" );
+
+        printf( "Drew %u instances per frame (%.0f instances per second).\n",
+                m_options.m_instanceCount,
+                elapsedSeconds > 0.0 ? m_frameNumber * static_cast< double >( m_options.m_instanceCount ) / elapsedSeconds
+                                     : 0.0 );
+
+        if ( m_culledFrameCount > 0 )
+        {
+            printf( "GPU culling drew %.1f of %u instances per frame, on average.\n",
+                    static_cast< double >( m_visibleObjectCount ) / m_culledFrameCount,
+                    m_options.m_instanceCount );
+        }
+
+        uint64_t drawCount = m_frameNumber * m_options.m_drawsPerFrame;
+        printf( "Recorded %u draws per frame on %u thread(s), in %.3f us per frame (%.1f ns per draw).\n",
+                m_options.m_drawsPerFrame,
+                std::max( m_options.m_recordThreads, 1u ),
+                m_frameNumber > 0 ? m_recordTime * 1e-3 / m_frameNumber : 0.0,
+                drawCount > 0 ? static_cast< double >( m_recordTime ) / drawCount : 0.0 );
+
+        m_profiler.PrintSummary();
+        if ( !m_options.m_tracePath.empty() )
+        {
+            if ( m_profiler.WriteChromeTrace( m_options.m_tracePath ) )
+            {
+                printf( "Wrote trace to %s.\n", m_options.m_tracePath.c_str() );
+            }
+            else
+            {
+                printf( "Failed to write trace to %s.\n", m_options.m_tracePath.c_str() );
+            }
+        }
+    }
+
+    /// Drain the profiler samples of the latest frame, and print the periodic summary when due.
+    void UpdateProfiler()
+    {
+        m_profiler.Drain();
+
+        if ( m_options.m_profileInterval > 0 && m_frameNumber >= m_lastProfileSummaryFrame + m_options.m_profileInterval )
+        {
+            printf( "Frame timings, frames %llu to %llu:\n",
+                    static_cast< unsigned long long >( m_lastProfileSummaryFrame + 1 ),
+                    static_cast< unsigned long long >( m_frameNumber ) );
+            m_profiler.PrintSummary();
+            m_lastProfileSummaryFrame = m_frameNumber;
+        }
+    }
+
+    /// Check the counters of the frame loop benchmark: the swap chain should be recreated exactly once per batch
+    /// of resize events, those received between two recreations.  A batch still pending when the loop exited is
+    /// not expected to have been handled.
+    void CheckFrameLoopBenchmark() const
+    {
+        const uint64_t expectedCount = m_resizeRequestCount - ( m_framebufferResized ? 1 : 0 );
+        if ( m_swapChainRecreationCount != expectedCount )
+        {
+            throw std::runtime_error( "Swap chain was recreated " + std::to_string( m_swapChainRecreationCount ) +
+                                      " times in " + std::to_string( m_frameNumber ) + " frames, for " +
+                                      std::to_string( expectedCount ) + " batches of resize events (" +
+                                      std::to_string( m_resizeEventCount ) + " events)" );
+        }
+
+        printf( "Frame loop benchmark passed.\n" );
     }
 
     // Teardown internal state, in reverse order of initialization.
     void Teardown()
     {
+        // Stop recompiling shaders before anything they are built against is destroyed.
+        m_shaderWatcher.Stop();
+        if ( m_reloadedPipeline != VK_NULL_HANDLE )
+        {
+            vkDestroyPipeline( m_device, m_reloadedPipeline, nullptr );
+        }
+
+        m_reloadedPipelineVariants.Teardown( m_device );
+
+        if ( !m_options.m_watchShadersDirectory.empty() )
+        {
+            uint64_t succeededCount = 0;
+            uint64_t failedCount    = 0;
+            m_shaderWatcher.GetCompileCounts( succeededCount, failedCount );
+            printf( "Shader reloads: %llu compiled, %llu failed, %llu pipelines swapped in.\n",
+                    static_cast< unsigned long long >( succeededCount ),
+                    static_cast< unsigned long long >( failedCount ),
+                    static_cast< unsigned long long >( m_pipelineSwapCount ) );
+        }
+
+        // The device is idle, so everything retired can be destroyed.
+        m_deletionQueue.FlushAll();
+
         TeardownSwapChain();
+        TeardownPipeline();
+
+        if ( m_frameTimeline.IsValid() )
+        {
+            m_frameTimeline.Teardown();
+        }
 
-        for ( size_t frameIndex = 0; frameIndex < s_maxFramesInFlight; ++frameIndex )
+        for ( size_t frameIndex = 0; frameIndex < m_inFlightFences.size(); ++frameIndex )
         {
             vkDestroySemaphore( m_device, m_renderFinishedSemaphores[ frameIndex ], nullptr );
             vkDestroySemaphore( m_device, m_imageAvailableSemaphores[ frameIndex ], nullptr );
             vkDestroyFence( m_device, m_inFlightFences[ frameIndex ], nullptr );
+            vkDestroyCommandPool( m_device, m_frameCommandPools[ frameIndex ], nullptr );
+        }
+
+        for ( std::vector< WorkerCommandPool >& workerPools : m_workerCommandPools )
+        {
+            for ( WorkerCommandPool& workerPool : workerPools )
+            {
+                vkDestroyCommandPool( m_device, workerPool.m_commandPool, nullptr );
+            }
         }
 
+        m_jobSystem.reset();
+
         vkDestroyCommandPool( m_device, m_commandPool, nullptr );
+
+        if ( m_options.m_gpuCulling )
+        {
+            TeardownCullingResources();
+        }
+
+        TeardownInstanceBuffer();
+        TeardownDescriptors();
+        TeardownGeometryBuffers();
+        if ( m_options.m_textureCount > 0 )
+        {
+            uint64_t evictedMipCount     = 0;
+            uint64_t evictedTextureCount = 0;
+            m_textureStreamer.GetEvictionCounts( evictedMipCount, evictedTextureCount );
+            printf( "Textures: %llu uploads (%.1f MiB), %llu mips and %llu textures evicted, %zu of %zu resident in "
+                    "%.1f of %.1f MiB.\n",
+                    static_cast< unsigned long long >( m_textureStreamer.GetUploadCount() ),
+                    m_textureStreamer.GetUploadedSize() / ( 1024.0 * 1024.0 ),
+                    static_cast< unsigned long long >( evictedMipCount ),
+                    static_cast< unsigned long long >( evictedTextureCount ),
+                    m_textureStreamer.GetResidentCount(),
+                    m_textureStreamer.GetTextureCount(),
+                    m_textureStreamer.GetResidentSize() / ( 1024.0 * 1024.0 ),
+                    m_textureStreamer.GetBudget() / ( 1024.0 * 1024.0 ) );
+            m_textureStreamer.Teardown();
+        }
+
+        m_allocator.Teardown();
+
+        printf( "Shader registry: %zu modules, %zu files loaded, %zu cache hits.\n",
+                m_shaderRegistry.GetModuleCount(),
+                m_shaderRegistry.GetFileLoadCount(),
+                m_shaderRegistry.GetCacheHitCount() );
+        m_shaderRegistry.Teardown();
+
+        SavePipelineCache();
+        vkDestroyPipelineCache( m_device, m_pipelineCache, nullptr );
+
         vkDestroyDevice( m_device, nullptr );
 
         if ( m_enableValidationLayers )
@@ -1125,15 +5003,29 @@ private:
             DestroyDebugUtilsMessengerEXT( m_instance, m_debugMessenger, nullptr );
         }
 
-        vkDestroySurfaceKHR( m_instance, m_surface, nullptr );
+        if ( !m_options.m_headless )
+        {
+            vkDestroySurfaceKHR( m_instance, m_surface, nullptr );
+        }
+
         vkDestroyInstance( m_instance, nullptr );
-        glfwDestroyWindow( m_window );
-        glfwTerminate();
+
+        if ( !m_options.m_headless )
+        {
+            glfwDestroyWindow( m_window );
+            glfwTerminate();
+        }
     }
 
+    // Format of the offscreen images, in headless mode.
+    static constexpr VkFormat s_offscreenImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+
     // Path of the executable.
     std::string m_executablePath;
 
+    // Runtime options.
+    ApplicationOptions m_options;
+
     // Window instance.
     GLFWwindow* m_window = nullptr;
 
@@ -1150,15 +5042,14 @@ private:
     // Available validation layers.
     const std::vector< const char* > m_validationLayers = {"VK_LAYER_KHRONOS_validation"};
 
-    // Device extensions.
-    const std::vector< const char* > m_deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-
     VkInstance               m_instance;                        // Vulkan instance.
     VkDebugUtilsMessengerEXT m_debugMessenger;                  // Debug messenger.
     VkPhysicalDevice         m_physicalDevice = VK_NULL_HANDLE; // The physical device.
     VkDevice                 m_device;                          // The logical device.
-    VkQueue                  m_graphicsQueue;                   // The graphics queue.
-    VkQueue                  m_presentQueue;                    // Presentation queue.
+    vkbase::Queue            m_graphicsQueue;                   // The graphics queue.
+    vkbase::Queue            m_computeQueue;                    // Compute queue, or the graphics queue.
+    vkbase::Queue            m_transferQueue;                   // Transfer queue, or the graphics queue.
+    VkQueue                  m_presentQueue   = VK_NULL_HANDLE; // Presentation queue.
     VkSurfaceKHR             m_surface;                         // Surface to render on.
 
     // The swap chain, representing the queue of images to be presented to the screen.
@@ -1170,35 +5061,209 @@ private:
     VkFormat                   m_swapChainImageFormat;
     VkExtent2D                 m_swapChainExtent;
 
-    VkRenderPass     m_renderPass;       // Render pass.
+    // Format of the depth buffer, or VK_FORMAT_UNDEFINED without depth testing.
+    VkFormat m_depthFormat = VK_FORMAT_UNDEFINED;
+
+    // Number of samples per pixel of the color and depth attachments of the scene pass.
+    VkSampleCountFlagBits m_sampleCount = VK_SAMPLE_COUNT_1_BIT;
+
+    // Memory backing the offscreen images, in headless mode.
+    std::vector< VkDeviceMemory > m_offscreenImageMemory;
+
+    // Shader modules, created once per SPIR-V file for the lifetime of the device.
+    vkbase::ShaderRegistry m_shaderRegistry;
+
+    // Recompiles the shaders of the graphics pipeline when their sources change, with --watch-shaders.  The
+    // pipeline and permutations it rebuilds wait in m_reloadedPipeline and m_reloadedPipelineVariants until swapped
+    // in at the start of a frame.  m_shaderReloadMutex guards the registry, the reloaded shader paths, the reloaded
+    // pipelines, and the frame graph and pipeline layout which pipelines are built against.
+    vkbase::ShaderWatcher                m_shaderWatcher;
+    std::mutex                           m_shaderReloadMutex;
+    std::map< std::string, std::string > m_reloadedShaderPaths; // Latest recompile of each shader, by name.
+    VkPipeline                           m_reloadedPipeline = VK_NULL_HANDLE;
+    vkbase::PipelinePermutations         m_reloadedPipelineVariants;
+    std::atomic< bool >                  m_reloadedPipelineReady{false};
+    uint64_t                             m_pipelineSwapCount = 0;
+
+    // Pipeline cache, persisted across runs.
+    VkPipelineCache m_pipelineCache       = VK_NULL_HANDLE;
+    std::string     m_pipelineCachePath;           // Where the cache is loaded from and saved to, if anywhere.
+    bool            m_pipelineCacheLoaded = false; // Was the cache seeded with data from a previous run?
+
     VkPipelineLayout m_pipelineLayout;   // Pipeline layout
     VkPipeline       m_graphicsPipeline; // The handle to the graphics pipeline.
 
-    // Frame buffers representing each VkImageView.
-    std::vector< VkFramebuffer > m_swapChainFramebuffers;
+    // Permutations of the graphics pipeline, built with --pipeline-variants, and the one drawn with --draw-variant.
+    vkbase::PipelinePermutations m_pipelineVariants;
+    vkbase::PipelineVariant      m_drawnPipelineVariant;
+
+    // Passes of the frame, rendering into the swap chain images.
+    vkbase::FrameGraph     m_frameGraph;
+    vkbase::FrameGraphPass m_scenePass = 0;
+
+    // Command pool for one-off commands.
+    VkCommandPool m_commandPool; // Offers creation of CommandBuffers and manages their memory.
+
+    // Transient command pool, and the command buffer re-recorded every frame, of each frame in flight.
+    std::vector< VkCommandPool >   m_frameCommandPools;
+    std::vector< VkCommandBuffer > m_frameCommandBuffers;
+    uint64_t                       m_recordTime = 0; // Total time spent recording command buffers, in nanoseconds.
 
-    // Command buffer.
-    VkCommandPool                  m_commandPool; // Offers creation of CommandBuffers and manages their memory.
-    std::vector< VkCommandBuffer > m_commandBuffers;
+    // A command pool of a recording thread, and the secondary command buffers allocated from it.
+    struct WorkerCommandPool
+    {
+        VkCommandPool                  m_commandPool = VK_NULL_HANDLE;
+        std::vector< VkCommandBuffer > m_commandBuffers;
+        size_t                         m_usedCount = 0; // Number of command buffers recorded since the last reset.
+    };
+
+    // Threads recording secondary command buffers, their command pools per frame in flight, and the secondary
+    // command buffers of the frame being recorded, in the order they are executed.
+    std::unique_ptr< vkbase::JobSystem >            m_jobSystem;
+    std::vector< std::vector< WorkerCommandPool > > m_workerCommandPools;
+    std::vector< VkCommandBuffer >                  m_secondaryCommandBuffers;
+
+    // Device memory, sub-allocated for buffers.
+    vkbase::MemoryAllocator m_allocator;
+
+    // Geometry to draw.
+    vkbase::Buffer m_vertexBuffer;
+    vkbase::Buffer m_indexBuffer;
+    uint32_t       m_indexCount = 0;
+
+    // Per-instance data, in a persistently mapped ring of a region per frame in flight, and with bindless
+    // descriptors, the texture slot of each instance, in a ring of its own.
+    vkbase::Buffer m_instanceBuffer;
+    vkbase::Buffer m_textureSlotBuffer;
+
+    // Descriptor set layouts, the descriptor pools of each frame in flight, and the bindless descriptor sets.
+    vkbase::DescriptorLayoutCache    m_descriptorLayoutCache;
+    vkbase::FrameDescriptorAllocator m_frameDescriptors;
+    vkbase::BindlessDescriptors      m_bindlessDescriptors;
+    VkSampler                        m_textureSampler      = VK_NULL_HANDLE;
+    VkDescriptorSetLayout            m_descriptorSetLayout = VK_NULL_HANDLE; // Of the graphics pipeline.
+    VkDescriptorSet                  m_frameDescriptorSet  = VK_NULL_HANDLE; // Bound by the current frame's draws.
+
+    // Indices of the instances, in the order they are drawn.
+    std::vector< uint32_t > m_instanceDrawOrder;
+
+    // Radius of the bounding circle of the mesh.
+    float m_meshRadius = 0.0f;
+
+    // GPU culling: the compute pipeline, and the draw commands and counts it writes, per frame in flight.
+    VkPipeline                           m_cullPipeline                = VK_NULL_HANDLE;
+    VkPipelineLayout                     m_cullPipelineLayout          = VK_NULL_HANDLE;
+    VkDescriptorSetLayout                m_cullDescriptorSetLayout     = VK_NULL_HANDLE;
+    VkDescriptorSet                      m_cullDescriptorSet           = VK_NULL_HANDLE; // Of the current frame.
+    vkbase::Buffer                       m_drawCommandBuffer;
+    vkbase::Buffer                       m_drawCountBuffer;
+    bool                                 m_drawIndirectCountSupported  = false;
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_cmdDrawIndexedIndirectCount = nullptr;
+    uint64_t                             m_visibleObjectCount          = 0; // Sum of the draw counts read back.
+    uint64_t                             m_culledFrameCount            = 0; // Number of draw counts read back.
+    uint32_t                             m_cullWorkgroupSize           = s_defaultCullWorkgroupSize; // As specialized.
+
+    // Culling on the compute queue, per frame in flight, if it belongs to another family than the graphics queue.
+    std::vector< VkCommandPool >   m_cullCommandPools;
+    std::vector< VkCommandBuffer > m_cullCommandBuffers;
+    std::vector< VkSemaphore >     m_cullFinishedSemaphores; // Signaled once the frame's draw commands are written.
+    vkbase::TimelineSemaphore      m_cullTimeline;           // Set to the number of each frame once culled.
+
+    // Staging memory, and the command buffer which copies out of it on the transfer queue.
+    vkbase::StagingRing     m_stagingRing;
+    VkCommandPool           m_uploadCommandPool      = VK_NULL_HANDLE;
+    VkCommandBuffer         m_uploadCommandBuffer    = VK_NULL_HANDLE;
+    VkFence                 m_uploadFence            = VK_NULL_HANDLE;
+    bool                    m_uploadRecording        = false; // Is the upload command buffer being recorded?
+    uint64_t                m_uploadSubmissionNumber = 0;     // Number of upload submissions made.
+    std::vector< VkBuffer > m_uploadedBuffers;                // Buffers copied into since the last submission.
+
+    // Acquisition of the uploaded buffers by the graphics queue, if the transfer queue is of another family.
+    VkCommandPool   m_uploadAcquireCommandPool   = VK_NULL_HANDLE;
+    VkCommandBuffer m_uploadAcquireCommandBuffer = VK_NULL_HANDLE;
+    VkSemaphore     m_uploadSemaphore            = VK_NULL_HANDLE; // Signaled by the copies, waited on by acquisition.
+
+    // Textures streamed in on demand, and the PPM images they are decoded from, if any.
+    vkbase::TextureStreamer    m_textureStreamer;
+    std::vector< std::string > m_texturePaths;
+    bool                       m_memoryBudgetEnabled = false; // Is VK_EXT_memory_budget enabled?
 
     // Semaphores for synchronizing frame drawing.
     std::vector< VkSemaphore > m_imageAvailableSemaphores;
     std::vector< VkSemaphore > m_renderFinishedSemaphores;
-    std::vector< VkFence >     m_inFlightFences;
-    std::vector< VkFence >     m_imagesInFlight;
     size_t                     m_currentFrame = 0;
 
+    // Frame completion is tracked by a timeline semaphore, set to the number of each frame as it completes, or by
+    // a fence per frame in flight.
+    bool                      m_useTimelineSemaphores            = false;
+    bool                      m_physicalDeviceProperties2Enabled = false;
+    vkbase::TimelineSemaphore m_frameTimeline;
+    std::vector< VkFence >    m_inFlightFences;
+    uint64_t                  m_frameWaitCount = 0; // Number of times the CPU blocked on frame completion.
+
+    // The number of the frame last drawn into each image, which must complete before the image is drawn again.
+    std::vector< uint64_t > m_imageFrameNumbersInFlight;
+
+    uint64_t m_frameNumber    = 0; // Total number of frames submitted, i.e. the number of the latest frame.
+    uint32_t m_lastImageIndex = 0; // Index of the image drawn by the most recently submitted frame.
+
+    // The number of the frame last submitted with each frame in flight, and the latest frame known to have
+    // completed execution.
+    std::vector< uint64_t > m_inFlightFrameNumbers;
+    uint64_t                m_completedFrameNumber = 0;
+
+    // Objects waiting on frames in flight before they can be destroyed.
+    vkbase::DeletionQueue m_deletionQueue;
+
     // Check if frame buffer requires a resize.
     bool m_framebufferResized = false;
+
+    // Frame timing instrumentation.
+    vkbase::Profiler m_profiler{
+        {"Frame",
+         "Fence wait",
+         "Acquire",
+         "Record",
+         "Update instances",
+         "Stream textures",
+         "Update descriptors",
+         "Submit",
+         "Present",
+         "GPU render pass",
+         "Input latency"}};
+    uint64_t m_lastProfileSummaryFrame = 0;
+
+    // Time at which input was last polled, and at which the input of the frame last submitted with each frame in
+    // flight was polled.
+    uint64_t                m_inputTime = 0;
+    std::vector< uint64_t > m_inFlightInputTimes;
+
+    // GPU timestamp queries, and the frame number and submission time of the frame last drawn into each image.
+    VkQueryPool             m_timestampQueryPool = VK_NULL_HANDLE;
+    uint32_t                m_timestampValidBits = 0;
+    float                   m_timestampPeriod    = 1.0f; // Nanoseconds per timestamp tick.
+    std::vector< uint64_t > m_imageFrameNumbers;
+    std::vector< uint64_t > m_imageSubmitTimes;
+
+    // Frame loop counters.
+    uint64_t m_swapChainRecreationCount = 0; // Number of times the swap chain was recreated.
+    uint64_t m_resizeEventCount         = 0; // Number of framebuffer resize events received from the window.
+    uint64_t m_resizeRequestCount       = 0; // Number of batches of resize events, each needing a recreation.
 };
 
 int main( int i_argc, char** i_argv )
 {
-    std::string         executablePath( i_argv[ 0 ] );
-    TriangleApplication app( executablePath );
+    std::string executablePath( i_argv[ 0 ] );
 
     try
     {
+        ApplicationOptions options;
+        if ( !ParseCommandLine( i_argc, i_argv, options ) )
+        {
+            return EXIT_SUCCESS;
+        }
+
+        TriangleApplication app( executablePath, options );
         app.Run();
     }
     catch ( const std::exception& e )
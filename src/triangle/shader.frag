@@ -5,6 +5,15 @@ layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
+// Iterations of artificial work per fragment, for making shading expensive.  Specialized at pipeline creation, so
+// the loop is unrolled, or removed entirely, by the driver's compiler.
+layout(constant_id = 0) const uint c_shadingIterations = 0;
+
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    vec3 color = fragColor;
+    for (uint iteration = 0; iteration < c_shadingIterations; ++iteration) {
+        color = clamp(color + 1e-7 * sin(gl_FragCoord.xyx * float(iteration + 1)), 0.0, 1.0);
+    }
+
+    outColor = vec4(color, 1.0);
 }
@@ -1,21 +1,37 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
 layout(location = 0) out vec3 fragColor;
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+// Per-draw parameters.
+layout(push_constant) uniform DrawParameters {
+    float meshScale;
+    uint instanceOffset;
+} drawParameters;
+
+struct Instance {
+    vec2 offset;
+    float scale;
+    float rotation;
+    vec3 color;
+    float depth;
+};
 
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+    Instance instances[];
+};
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    Instance instance = instances[drawParameters.instanceOffset + gl_InstanceIndex];
+
+    vec2 position = inPosition * drawParameters.meshScale * instance.scale;
+    float c = cos(instance.rotation);
+    float s = sin(instance.rotation);
+    position = vec2(c * position.x - s * position.y, s * position.x + c * position.y);
+
+    gl_Position = vec4(position + instance.offset, instance.depth, 1.0);
+    fragColor = inColor * instance.color;
 }
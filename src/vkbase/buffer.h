@@ -0,0 +1,207 @@
+#pragma once
+
+/// \file vkbase/buffer.h
+///
+/// Buffers backed by the MemoryAllocator, and a staging ring for uploading data into device local buffers.
+
+namespace vkbase
+{
+/// \struct Buffer
+///
+/// A VkBuffer, and the memory range bound to it.
+struct Buffer
+{
+    VkBuffer         m_buffer = VK_NULL_HANDLE;
+    MemoryAllocation m_allocation;
+    VkDeviceSize     m_size = 0; // Requested size of the buffer.
+};
+
+/// Create a buffer of \p i_size bytes, with memory sub-allocated from \p io_allocator.
+///
+/// \param i_usage usage of the buffer.
+/// \param i_properties required properties of its memory.
+/// \param i_queueFamilies queue families accessing the buffer concurrently, without ownership transfers.  The
+/// buffer is exclusive to one queue family at a time if fewer than two distinct families are given.
+inline Buffer CreateBuffer( VkDevice                       i_device,
+                            MemoryAllocator&               io_allocator,
+                            VkDeviceSize                   i_size,
+                            VkBufferUsageFlags             i_usage,
+                            VkMemoryPropertyFlags          i_properties,
+                            const std::vector< uint32_t >& i_queueFamilies = {} )
+{
+    Buffer buffer;
+    buffer.m_size = i_size;
+
+    std::vector< uint32_t > queueFamilies = i_queueFamilies;
+    std::sort( queueFamilies.begin(), queueFamilies.end() );
+    queueFamilies.erase( std::unique( queueFamilies.begin(), queueFamilies.end() ), queueFamilies.end() );
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size               = i_size;
+    bufferInfo.usage              = i_usage;
+    bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+    if ( queueFamilies.size() > 1 )
+    {
+        bufferInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast< uint32_t >( queueFamilies.size() );
+        bufferInfo.pQueueFamilyIndices   = queueFamilies.data();
+    }
+    if ( vkCreateBuffer( i_device, &bufferInfo, nullptr, &buffer.m_buffer ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create buffer." );
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements( i_device, buffer.m_buffer, &memoryRequirements );
+    buffer.m_allocation = io_allocator.Allocate( memoryRequirements, i_properties );
+    if ( vkBindBufferMemory( i_device, buffer.m_buffer, buffer.m_allocation.m_memory, buffer.m_allocation.m_offset ) !=
+         VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to bind buffer memory." );
+    }
+
+    return buffer;
+}
+
+/// Destroy \p io_buffer, and return its memory to \p io_allocator.
+inline void DestroyBuffer( VkDevice i_device, MemoryAllocator& io_allocator, Buffer& io_buffer )
+{
+    vkDestroyBuffer( i_device, io_buffer.m_buffer, nullptr );
+    io_allocator.Free( io_buffer.m_allocation );
+    io_buffer = Buffer();
+}
+
+/// \class StagingRing
+///
+/// A persistently mapped, host visible buffer used as a ring of staging memory.
+///
+/// Ranges are reserved at the head of the ring and written by the CPU, then committed along with the number of
+/// the GPU submission which copies out of them.  Once that submission is known to have completed, its ranges
+/// are released from the tail of the ring.
+class StagingRing
+{
+public:
+    /// Create the ring buffer, of \p i_capacity bytes.
+    void Init( VkDevice i_device, MemoryAllocator& io_allocator, VkDeviceSize i_capacity )
+    {
+        m_buffer = CreateBuffer( i_device,
+                                 io_allocator,
+                                 i_capacity,
+                                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+        m_head = m_tail = m_usedSize = m_uncommittedSize = 0;
+        m_committedRanges.clear();
+    }
+
+    /// Destroy the ring buffer.  No submission may be using it.
+    void Teardown( VkDevice i_device, MemoryAllocator& io_allocator )
+    {
+        DestroyBuffer( i_device, io_allocator, m_buffer );
+    }
+
+    /// Reserve a contiguous range of up to \p i_size bytes, starting at a multiple of \p i_alignment.  Less than
+    /// \p i_size bytes may be reserved, if the free space before the end of the ring, or before the oldest range
+    /// still in use, is smaller.
+    ///
+    /// \param o_offset offset of the range into GetBuffer().
+    ///
+    /// \return the size of the reserved range, or 0 if the ring is full.
+    VkDeviceSize Reserve( VkDeviceSize i_size, VkDeviceSize i_alignment, VkDeviceSize& o_offset )
+    {
+        const VkDeviceSize capacity = m_buffer.m_size;
+        if ( m_usedSize == capacity )
+        {
+            return 0;
+        }
+
+        VkDeviceSize offset = ( m_head + i_alignment - 1 ) / i_alignment * i_alignment;
+        VkDeviceSize end    = 0;
+        if ( m_head < m_tail )
+        {
+            // The free space lies between the head and the tail.
+            end = m_tail;
+        }
+        else if ( offset < capacity )
+        {
+            // The free space lies between the head and the end of the ring, then the start and the tail.
+            end = capacity;
+        }
+        else
+        {
+            // Wrap around to the start of the ring.
+            offset = 0;
+            end    = m_tail;
+        }
+
+        if ( offset >= end )
+        {
+            return 0;
+        }
+
+        VkDeviceSize size    = std::min( i_size, end - offset );
+        VkDeviceSize padding = offset >= m_head ? offset - m_head : capacity - m_head;
+        m_head               = ( offset + size ) % capacity;
+        m_usedSize += padding + size;
+        m_uncommittedSize += padding + size;
+        o_offset = offset;
+        return size;
+    }
+
+    /// Size of the ring buffer, in bytes.
+    VkDeviceSize GetCapacity() const
+    {
+        return m_buffer.m_size;
+    }
+
+    /// Host pointer to the start of the ring buffer.
+    char* GetMappedData() const
+    {
+        return static_cast< char* >( m_buffer.m_allocation.m_mappedData );
+    }
+
+    /// The ring buffer.
+    VkBuffer GetBuffer() const
+    {
+        return m_buffer.m_buffer;
+    }
+
+    /// Mark all ranges reserved since the previous commit as in use by submission \p i_submissionNumber.
+    void Commit( uint64_t i_submissionNumber )
+    {
+        if ( m_uncommittedSize > 0 )
+        {
+            m_committedRanges.emplace_back( i_submissionNumber, m_uncommittedSize );
+            m_uncommittedSize = 0;
+        }
+    }
+
+    /// Release the ranges committed by submissions numbered up to \p i_completedSubmissionNumber.
+    void Release( uint64_t i_completedSubmissionNumber )
+    {
+        while ( !m_committedRanges.empty() && m_committedRanges.front().first <= i_completedSubmissionNumber )
+        {
+            m_tail = ( m_tail + m_committedRanges.front().second ) % m_buffer.m_size;
+            m_usedSize -= m_committedRanges.front().second;
+            m_committedRanges.pop_front();
+        }
+
+        // Restart from the beginning of an empty ring, so the next reservation is not split by the end.
+        if ( m_usedSize == 0 )
+        {
+            m_head = m_tail = 0;
+        }
+    }
+
+private:
+    Buffer       m_buffer;
+    VkDeviceSize m_head            = 0; // Offset of the next reservation.
+    VkDeviceSize m_tail            = 0; // Offset of the oldest range in use.
+    VkDeviceSize m_usedSize        = 0; // Bytes from the tail to the head, including alignment padding.
+    VkDeviceSize m_uncommittedSize = 0; // Bytes reserved since the previous commit.
+
+    // Submission number, and size, of each committed span of the ring.
+    std::deque< std::pair< uint64_t, VkDeviceSize > > m_committedRanges;
+};
+
+} // namespace vkbase
@@ -0,0 +1,52 @@
+#pragma once
+
+/// \file vkbase/deletionQueue.h
+///
+/// Deferred destruction of Vulkan objects which may still be referenced by frames in flight.
+
+namespace vkbase
+{
+/// \class DeletionQueue
+///
+/// Queue of deleters, each tagged with the number of the last frame which may reference the objects it
+/// destroys.  Frame numbers are 1-based and increase monotonically, and the queue is flushed with the number of
+/// the latest frame known to have completed execution on the device.
+class DeletionQueue
+{
+public:
+    /// Queue \p i_deleter to be called once frame \p i_frameNumber, and all frames before it, have completed
+    /// execution.
+    void Push( uint64_t i_frameNumber, std::function< void() > i_deleter )
+    {
+        m_entries.emplace_back( i_frameNumber, std::move( i_deleter ) );
+    }
+
+    /// Call, and remove, the deleters of all entries tagged with a frame number up to and including
+    /// \p i_completedFrameNumber.
+    void Flush( uint64_t i_completedFrameNumber )
+    {
+        // Entries are pushed in non-decreasing frame order, so the ready entries are at the front.
+        while ( !m_entries.empty() && m_entries.front().first <= i_completedFrameNumber )
+        {
+            m_entries.front().second();
+            m_entries.pop_front();
+        }
+    }
+
+    /// Call, and remove, all deleters.  The device must be idle.
+    void FlushAll()
+    {
+        Flush( UINT64_MAX );
+    }
+
+    /// Check if there are no pending deleters.
+    bool IsEmpty() const
+    {
+        return m_entries.empty();
+    }
+
+private:
+    std::deque< std::pair< uint64_t, std::function< void() > > > m_entries;
+};
+
+} // namespace vkbase
@@ -0,0 +1,642 @@
+#pragma once
+
+/// \file vkbase/descriptors.h
+///
+/// Descriptor set layouts cached by their bindings, descriptor sets allocated from pools of a frame in flight, and
+/// bindless descriptor sets, through VK_EXT_descriptor_indexing.
+
+namespace vkbase
+{
+/// The features of VK_EXT_descriptor_indexing required by BindlessDescriptors.
+inline VkPhysicalDeviceDescriptorIndexingFeaturesEXT GetBindlessFeatures()
+{
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    features.shaderSampledImageArrayNonUniformIndexing     = VK_TRUE;
+    features.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+    features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingPartiallyBound               = VK_TRUE;
+    features.runtimeDescriptorArray                        = VK_TRUE;
+    return features;
+}
+
+/// Check if \p i_physicalDevice supports the features of VK_EXT_descriptor_indexing required by
+/// BindlessDescriptors.  Requires the VK_KHR_get_physical_device_properties2 instance extension to have been enabled
+/// on \p i_instance.
+inline bool IsBindlessSupported( VkInstance i_instance, VkPhysicalDevice i_physicalDevice )
+{
+    PFN_vkGetPhysicalDeviceFeatures2KHR getPhysicalDeviceFeatures2 =
+        reinterpret_cast< PFN_vkGetPhysicalDeviceFeatures2KHR >(
+            vkGetInstanceProcAddr( i_instance, "vkGetPhysicalDeviceFeatures2KHR" ) );
+    if ( getPhysicalDeviceFeatures2 == nullptr )
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+    VkPhysicalDeviceFeatures2KHR features = {};
+    features.sType                        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features.pNext                        = &indexingFeatures;
+    getPhysicalDeviceFeatures2( i_physicalDevice, &features );
+
+    return indexingFeatures.shaderSampledImageArrayNonUniformIndexing == VK_TRUE &&
+           indexingFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+           indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE &&
+           indexingFeatures.descriptorBindingPartiallyBound == VK_TRUE &&
+           indexingFeatures.runtimeDescriptorArray == VK_TRUE;
+}
+
+/// Query the limits of \p i_physicalDevice on descriptors of update-after-bind bindings.  Requires the
+/// VK_KHR_get_physical_device_properties2 instance extension to have been enabled on \p i_instance.
+inline VkPhysicalDeviceDescriptorIndexingPropertiesEXT
+GetDescriptorIndexingProperties( VkInstance i_instance, VkPhysicalDevice i_physicalDevice )
+{
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+    PFN_vkGetPhysicalDeviceProperties2KHR getPhysicalDeviceProperties2 =
+        reinterpret_cast< PFN_vkGetPhysicalDeviceProperties2KHR >(
+            vkGetInstanceProcAddr( i_instance, "vkGetPhysicalDeviceProperties2KHR" ) );
+    if ( getPhysicalDeviceProperties2 == nullptr )
+    {
+        throw std::runtime_error( "Failed to get vkGetPhysicalDeviceProperties2KHR." );
+    }
+
+    VkPhysicalDeviceProperties2KHR properties = {};
+    properties.sType                          = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+    properties.pNext                          = &indexingProperties;
+    getPhysicalDeviceProperties2( i_physicalDevice, &properties );
+
+    return indexingProperties;
+}
+
+/// \class DescriptorLayoutCache
+///
+/// Descriptor set layouts created once for the lifetime of the device, and looked up by the hash of their
+/// bindings.  Requesting the layout of bindings identical to an earlier request returns the same layout, so
+/// pipelines and descriptor sets built from equal descriptions are compatible with one another.
+///
+/// Bindings are compared regardless of the order they are listed in.  Immutable samplers are not supported.
+class DescriptorLayoutCache
+{
+public:
+    /// Prepare to create descriptor set layouts on \p i_device.
+    void Init( VkDevice i_device )
+    {
+        m_device = i_device;
+    }
+
+    /// Destroy all layouts.  Descriptor sets and pipeline layouts created with them must no longer be in use.
+    void Teardown()
+    {
+        for ( const std::pair< const LayoutKey, VkDescriptorSetLayout >& entry : m_layouts )
+        {
+            vkDestroyDescriptorSetLayout( m_device, entry.second, nullptr );
+        }
+
+        m_layouts.clear();
+    }
+
+    /// Get the layout of \p i_bindings, creating it on first request.  The layout is owned by the cache, and must
+    /// not be destroyed by the caller.
+    ///
+    /// \param i_bindings the bindings of the layout.
+    /// \param i_bindingFlags flags of the binding of the same index in \p i_bindings, or empty for none.  Require
+    /// VK_EXT_descriptor_indexing.
+    /// \param i_flags flags of the layout.
+    VkDescriptorSetLayout GetLayout( const std::vector< VkDescriptorSetLayoutBinding >& i_bindings,
+                                     const std::vector< VkDescriptorBindingFlagsEXT >&  i_bindingFlags = {},
+                                     VkDescriptorSetLayoutCreateFlags                   i_flags        = 0 )
+    {
+        if ( !i_bindingFlags.empty() && i_bindingFlags.size() != i_bindings.size() )
+        {
+            throw std::runtime_error( "Expected binding flags for every descriptor set layout binding." );
+        }
+
+        LayoutKey key;
+        key.m_flags = i_flags;
+        for ( size_t bindingIndex = 0; bindingIndex < i_bindings.size(); ++bindingIndex )
+        {
+            const VkDescriptorSetLayoutBinding& binding = i_bindings[ bindingIndex ];
+            if ( binding.pImmutableSamplers != nullptr )
+            {
+                throw std::runtime_error( "Immutable samplers are not supported by the descriptor layout cache." );
+            }
+
+            key.m_bindings.push_back( {binding.binding,
+                                       static_cast< uint32_t >( binding.descriptorType ),
+                                       binding.descriptorCount,
+                                       binding.stageFlags,
+                                       i_bindingFlags.empty() ? 0 : i_bindingFlags[ bindingIndex ]} );
+        }
+
+        std::sort( key.m_bindings.begin(), key.m_bindings.end(), []( const Binding& i_lhs, const Binding& i_rhs ) {
+            return i_lhs.m_binding < i_rhs.m_binding;
+        } );
+
+        std::unordered_map< LayoutKey, VkDescriptorSetLayout, LayoutKeyHash >::const_iterator layoutIt =
+            m_layouts.find( key );
+        if ( layoutIt != m_layouts.end() )
+        {
+            ++m_cacheHitCount;
+            return layoutIt->second;
+        }
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+        bindingFlagsInfo.bindingCount  = static_cast< uint32_t >( i_bindingFlags.size() );
+        bindingFlagsInfo.pBindingFlags = i_bindingFlags.data();
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType                           = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext                           = i_bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+        layoutInfo.flags                           = i_flags;
+        layoutInfo.bindingCount                    = static_cast< uint32_t >( i_bindings.size() );
+        layoutInfo.pBindings                       = i_bindings.data();
+
+        VkDescriptorSetLayout layout;
+        if ( vkCreateDescriptorSetLayout( m_device, &layoutInfo, nullptr, &layout ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create descriptor set layout." );
+        }
+
+        m_layouts.emplace( std::move( key ), layout );
+        return layout;
+    }
+
+    /// Number of distinct layouts created.
+    size_t GetLayoutCount() const
+    {
+        return m_layouts.size();
+    }
+
+    /// Number of requests served from the cache.
+    size_t GetCacheHitCount() const
+    {
+        return m_cacheHitCount;
+    }
+
+private:
+    // The fields of a binding which identify it, and its binding flags.
+    struct Binding
+    {
+        uint32_t m_binding;
+        uint32_t m_descriptorType;
+        uint32_t m_descriptorCount;
+        uint32_t m_stageFlags;
+        uint32_t m_bindingFlags;
+
+        bool operator==( const Binding& i_other ) const
+        {
+            return m_binding == i_other.m_binding && m_descriptorType == i_other.m_descriptorType &&
+                   m_descriptorCount == i_other.m_descriptorCount && m_stageFlags == i_other.m_stageFlags &&
+                   m_bindingFlags == i_other.m_bindingFlags;
+        }
+    };
+
+    // The bindings of a layout, sorted by binding number, and its flags.
+    struct LayoutKey
+    {
+        std::vector< Binding > m_bindings;
+        uint32_t               m_flags = 0;
+
+        bool operator==( const LayoutKey& i_other ) const
+        {
+            return m_flags == i_other.m_flags && m_bindings == i_other.m_bindings;
+        }
+    };
+
+    struct LayoutKeyHash
+    {
+        size_t operator()( const LayoutKey& i_key ) const
+        {
+            // Binding is five 32-bit fields, so has no padding to hash.
+            uint64_t hash = HashBytes( &i_key.m_flags, sizeof( i_key.m_flags ) );
+            hash          = HashBytes( i_key.m_bindings.data(), sizeof( Binding ) * i_key.m_bindings.size(), hash );
+            return static_cast< size_t >( hash );
+        }
+    };
+
+    VkDevice                                                              m_device = VK_NULL_HANDLE;
+    std::unordered_map< LayoutKey, VkDescriptorSetLayout, LayoutKeyHash > m_layouts;
+    size_t                                                                m_cacheHitCount = 0;
+};
+
+/// \class FrameDescriptorAllocator
+///
+/// Descriptor sets written afresh every frame, allocated from descriptor pools owned by a frame in flight.
+///
+/// Sets are never freed individually.  Instead, once the previous frame drawn with a frame in flight has
+/// completed, BeginFrame resets its pools wholesale with vkResetDescriptorPool, which returns every set allocated
+/// from them at once, without the fragmentation, nor the bookkeeping, of pools created with
+/// VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT.  A frame which runs out of room in its pools is given another
+/// pool, which it keeps for later frames.
+class FrameDescriptorAllocator
+{
+public:
+    /// Create the first pool of each of \p i_frameCount frames in flight on \p i_device.
+    ///
+    /// \param i_setsPerPool number of sets allocated from each pool.
+    /// \param i_poolSizes number of descriptors of each type allocated from each pool.
+    void Init( VkDevice                                   i_device,
+               size_t                                     i_frameCount,
+               uint32_t                                   i_setsPerPool,
+               const std::vector< VkDescriptorPoolSize >& i_poolSizes )
+    {
+        m_device      = i_device;
+        m_setsPerPool = i_setsPerPool;
+        m_poolSizes   = i_poolSizes;
+        m_frames.resize( i_frameCount );
+        for ( FramePools& frame : m_frames )
+        {
+            frame.m_pools.push_back( CreatePool() );
+        }
+    }
+
+    /// Destroy all pools, and so the sets allocated from them.  No command buffer in flight may be using them.
+    void Teardown()
+    {
+        for ( FramePools& frame : m_frames )
+        {
+            for ( VkDescriptorPool pool : frame.m_pools )
+            {
+                vkDestroyDescriptorPool( m_device, pool, nullptr );
+            }
+        }
+
+        m_frames.clear();
+    }
+
+    /// Start allocating the sets of frame in flight \p i_frameIndex, returning the sets allocated by its
+    /// previous frame to its pools.  The previous frame must have completed.
+    void BeginFrame( size_t i_frameIndex )
+    {
+        FramePools& frame = m_frames[ i_frameIndex ];
+        for ( size_t poolIndex = 0; poolIndex <= frame.m_currentPool; ++poolIndex )
+        {
+            vkResetDescriptorPool( m_device, frame.m_pools[ poolIndex ], 0 );
+        }
+
+        frame.m_currentPool = 0;
+        m_frameIndex        = i_frameIndex;
+    }
+
+    /// Allocate a set of \p i_layout for the current frame.  It is valid until the frame in flight begins again.
+    VkDescriptorSet Allocate( VkDescriptorSetLayout i_layout )
+    {
+        FramePools& frame = m_frames[ m_frameIndex ];
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool              = frame.m_pools[ frame.m_currentPool ];
+        allocInfo.descriptorSetCount          = 1;
+        allocInfo.pSetLayouts                 = &i_layout;
+
+        VkDescriptorSet set;
+        VkResult        result = vkAllocateDescriptorSets( m_device, &allocInfo, &set );
+        if ( result == VK_ERROR_OUT_OF_POOL_MEMORY_KHR || result == VK_ERROR_FRAGMENTED_POOL )
+        {
+            // Move on to the frame's next pool, creating it if this is the furthest the frame has got.
+            if ( ++frame.m_currentPool == frame.m_pools.size() )
+            {
+                frame.m_pools.push_back( CreatePool() );
+            }
+
+            allocInfo.descriptorPool = frame.m_pools[ frame.m_currentPool ];
+            result                   = vkAllocateDescriptorSets( m_device, &allocInfo, &set );
+        }
+
+        if ( result != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to allocate descriptor set." );
+        }
+
+        ++m_allocationCount;
+        return set;
+    }
+
+    /// Number of pools, across all frames in flight.
+    size_t GetPoolCount() const
+    {
+        size_t poolCount = 0;
+        for ( const FramePools& frame : m_frames )
+        {
+            poolCount += frame.m_pools.size();
+        }
+
+        return poolCount;
+    }
+
+    /// Number of sets allocated, across all frames.
+    uint64_t GetAllocationCount() const
+    {
+        return m_allocationCount;
+    }
+
+private:
+    // The pools of a frame in flight, and the one sets are currently allocated from.
+    struct FramePools
+    {
+        std::vector< VkDescriptorPool > m_pools;
+        size_t                          m_currentPool = 0;
+    };
+
+    VkDescriptorPool CreatePool() const
+    {
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets                    = m_setsPerPool;
+        poolInfo.poolSizeCount              = static_cast< uint32_t >( m_poolSizes.size() );
+        poolInfo.pPoolSizes                 = m_poolSizes.data();
+
+        VkDescriptorPool pool;
+        if ( vkCreateDescriptorPool( m_device, &poolInfo, nullptr, &pool ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create descriptor pool." );
+        }
+
+        return pool;
+    }
+
+    VkDevice                            m_device      = VK_NULL_HANDLE;
+    uint32_t                            m_setsPerPool = 0;
+    std::vector< VkDescriptorPoolSize > m_poolSizes;
+    std::vector< FramePools >           m_frames;
+    size_t                              m_frameIndex      = 0;
+    uint64_t                            m_allocationCount = 0;
+};
+
+/// \class BindlessDescriptors
+///
+/// Large arrays of storage buffers and of combined image samplers, which shaders index into by slot, so a single
+/// descriptor set bound once per frame gives every draw access to every resource.  Requires the features returned
+/// by GetBindlessFeatures to be enabled on the device.
+///
+/// Both arrays are update-after-bind bindings, allocated from a pool created with
+/// VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT: such bindings are subject to the much larger limits of
+/// VkPhysicalDeviceDescriptorIndexingPropertiesEXT, rather than the per-stage limits of ordinary bindings, which
+/// can be as low as 16 sampled images.  They are also partially bound, so slots which were never set, or whose
+/// resource was destroyed, are valid as long as shaders do not read them.
+///
+/// Each frame in flight has its own set, which is only updated once the previous frame drawn with it has completed,
+/// so descriptors are never written while a command buffer reading them executes.  Setting a slot marks it for
+/// every set, and Update writes only the slots changed since that set was last updated.
+class BindlessDescriptors
+{
+public:
+    /// Binding of the array of storage buffers.
+    static constexpr uint32_t s_bufferBinding = 0;
+
+    /// Binding of the array of combined image samplers.
+    static constexpr uint32_t s_textureBinding = 1;
+
+    /// Create the layout, with \p io_layoutCache, and a set for each of \p i_frameCount frames in flight on
+    /// \p i_device.
+    ///
+    /// \param i_bufferCapacity number of storage buffer slots.
+    /// \param i_textureCapacity number of texture slots.
+    /// \param i_stageFlags shader stages accessing the arrays.
+    void Init( VkDevice               i_device,
+               DescriptorLayoutCache& io_layoutCache,
+               size_t                 i_frameCount,
+               uint32_t               i_bufferCapacity,
+               uint32_t               i_textureCapacity,
+               VkShaderStageFlags     i_stageFlags )
+    {
+        if ( i_frameCount > sizeof( uint32_t ) * 8 )
+        {
+            throw std::runtime_error( "Bindless descriptors support at most 32 frames in flight." );
+        }
+
+        m_device = i_device;
+        m_buffers.assign( i_bufferCapacity, BufferSlot() );
+        m_textures.assign( i_textureCapacity, TextureSlot() );
+        m_allFramesMask = static_cast< uint32_t >( ( uint64_t( 1 ) << i_frameCount ) - 1 );
+
+        std::vector< VkDescriptorSetLayoutBinding > bindings( 2 );
+        bindings[ 0 ].binding         = s_bufferBinding;
+        bindings[ 0 ].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[ 0 ].descriptorCount = i_bufferCapacity;
+        bindings[ 0 ].stageFlags      = i_stageFlags;
+        bindings[ 1 ].binding         = s_textureBinding;
+        bindings[ 1 ].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[ 1 ].descriptorCount = i_textureCapacity;
+        bindings[ 1 ].stageFlags      = i_stageFlags;
+
+        const VkDescriptorBindingFlagsEXT bindingFlags =
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT;
+        m_layout = io_layoutCache.GetLayout( bindings,
+                                             {bindingFlags, bindingFlags},
+                                             VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT );
+
+        std::array< VkDescriptorPoolSize, 2 > poolSizes = {};
+        poolSizes[ 0 ].type                              = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSizes[ 0 ].descriptorCount = static_cast< uint32_t >( i_bufferCapacity * i_frameCount );
+        poolSizes[ 1 ].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSizes[ 1 ].descriptorCount = static_cast< uint32_t >( i_textureCapacity * i_frameCount );
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.flags                      = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+        poolInfo.maxSets                    = static_cast< uint32_t >( i_frameCount );
+        poolInfo.poolSizeCount              = static_cast< uint32_t >( poolSizes.size() );
+        poolInfo.pPoolSizes                 = poolSizes.data();
+        if ( vkCreateDescriptorPool( m_device, &poolInfo, nullptr, &m_pool ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create bindless descriptor pool." );
+        }
+
+        std::vector< VkDescriptorSetLayout > layouts( i_frameCount, m_layout );
+        m_sets.resize( i_frameCount );
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool              = m_pool;
+        allocInfo.descriptorSetCount          = static_cast< uint32_t >( layouts.size() );
+        allocInfo.pSetLayouts                 = layouts.data();
+        if ( vkAllocateDescriptorSets( m_device, &allocInfo, m_sets.data() ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to allocate bindless descriptor sets." );
+        }
+    }
+
+    /// Destroy the sets.  The layout is owned by the layout cache.  No command buffer in flight may be using them.
+    void Teardown()
+    {
+        vkDestroyDescriptorPool( m_device, m_pool, nullptr );
+        m_pool = VK_NULL_HANDLE;
+        m_sets.clear();
+        m_buffers.clear();
+        m_textures.clear();
+        m_dirtyBuffers.clear();
+        m_dirtyTextures.clear();
+    }
+
+    /// Point buffer slot \p i_slot at \p i_range bytes of \p i_buffer from \p i_offset.
+    void SetBuffer( uint32_t i_slot, VkBuffer i_buffer, VkDeviceSize i_offset, VkDeviceSize i_range )
+    {
+        BufferSlot& slot = m_buffers.at( i_slot );
+        if ( slot.m_info.buffer == i_buffer && slot.m_info.offset == i_offset && slot.m_info.range == i_range )
+        {
+            return;
+        }
+
+        slot.m_info = {i_buffer, i_offset, i_range};
+        MarkDirty( i_slot, slot.m_dirtyFrames, m_dirtyBuffers );
+    }
+
+    /// Point texture slot \p i_slot at \p i_imageView, in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, sampled with
+    /// \p i_sampler.  A null \p i_imageView leaves the descriptor unwritten, so shaders must not read the slot.
+    void SetTexture( uint32_t i_slot, VkImageView i_imageView, VkSampler i_sampler )
+    {
+        TextureSlot& slot = m_textures.at( i_slot );
+        if ( slot.m_info.imageView == i_imageView && slot.m_info.sampler == i_sampler )
+        {
+            return;
+        }
+
+        slot.m_info = {i_sampler, i_imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        MarkDirty( i_slot, slot.m_dirtyFrames, m_dirtyTextures );
+    }
+
+    /// Write the slots changed since the set of frame in flight \p i_frameIndex was last updated, in a single call
+    /// to vkUpdateDescriptorSets.  The previous frame drawn with the set must have completed.
+    ///
+    /// \return the number of descriptors written.
+    uint32_t Update( size_t i_frameIndex )
+    {
+        const uint32_t frameMask = 1u << i_frameIndex;
+
+        std::vector< VkWriteDescriptorSet > writes;
+        for ( uint32_t slotIndex : m_dirtyBuffers )
+        {
+            BufferSlot& slot = m_buffers[ slotIndex ];
+            if ( ( slot.m_dirtyFrames & frameMask ) != 0 )
+            {
+                writes.push_back( MakeWrite( i_frameIndex, s_bufferBinding, slotIndex ) );
+                writes.back().descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                writes.back().pBufferInfo    = &slot.m_info;
+                slot.m_dirtyFrames &= ~frameMask;
+            }
+        }
+
+        for ( uint32_t slotIndex : m_dirtyTextures )
+        {
+            TextureSlot& slot = m_textures[ slotIndex ];
+            if ( ( slot.m_dirtyFrames & frameMask ) != 0 )
+            {
+                // Partially bound, so a cleared slot keeps its stale descriptor, which is never read.
+                if ( slot.m_info.imageView != VK_NULL_HANDLE )
+                {
+                    writes.push_back( MakeWrite( i_frameIndex, s_textureBinding, slotIndex ) );
+                    writes.back().descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                    writes.back().pImageInfo     = &slot.m_info;
+                }
+
+                slot.m_dirtyFrames &= ~frameMask;
+            }
+        }
+
+        // Slots written to every set no longer need to be visited.
+        m_dirtyBuffers.erase(
+            std::remove_if( m_dirtyBuffers.begin(),
+                            m_dirtyBuffers.end(),
+                            [this]( uint32_t i_slot ) { return m_buffers[ i_slot ].m_dirtyFrames == 0; } ),
+            m_dirtyBuffers.end() );
+        m_dirtyTextures.erase(
+            std::remove_if( m_dirtyTextures.begin(),
+                            m_dirtyTextures.end(),
+                            [this]( uint32_t i_slot ) { return m_textures[ i_slot ].m_dirtyFrames == 0; } ),
+            m_dirtyTextures.end() );
+
+        if ( !writes.empty() )
+        {
+            vkUpdateDescriptorSets( m_device, static_cast< uint32_t >( writes.size() ), writes.data(), 0, nullptr );
+        }
+
+        m_writeCount += writes.size();
+        return static_cast< uint32_t >( writes.size() );
+    }
+
+    /// Layout of the sets, owned by the layout cache.
+    VkDescriptorSetLayout GetLayout() const
+    {
+        return m_layout;
+    }
+
+    /// Set of frame in flight \p i_frameIndex.
+    VkDescriptorSet GetSet( size_t i_frameIndex ) const
+    {
+        return m_sets[ i_frameIndex ];
+    }
+
+    /// Number of buffer slots.
+    uint32_t GetBufferCapacity() const
+    {
+        return static_cast< uint32_t >( m_buffers.size() );
+    }
+
+    /// Number of texture slots.
+    uint32_t GetTextureCapacity() const
+    {
+        return static_cast< uint32_t >( m_textures.size() );
+    }
+
+    /// Number of descriptors written, across all sets.
+    uint64_t GetWriteCount() const
+    {
+        return m_writeCount;
+    }
+
+private:
+    // The descriptor of a slot, and the frames in flight whose set it has not yet been written to.
+    struct BufferSlot
+    {
+        VkDescriptorBufferInfo m_info        = {};
+        uint32_t               m_dirtyFrames = 0;
+    };
+
+    struct TextureSlot
+    {
+        VkDescriptorImageInfo m_info        = {};
+        uint32_t              m_dirtyFrames = 0;
+    };
+
+    // Mark slot i_slot as changed for every set, listing it in io_dirtySlots unless already listed.
+    void MarkDirty( uint32_t i_slot, uint32_t& io_dirtyFrames, std::vector< uint32_t >& io_dirtySlots )
+    {
+        if ( io_dirtyFrames == 0 )
+        {
+            io_dirtySlots.push_back( i_slot );
+        }
+
+        io_dirtyFrames = m_allFramesMask;
+    }
+
+    VkWriteDescriptorSet MakeWrite( size_t i_frameIndex, uint32_t i_binding, uint32_t i_slot ) const
+    {
+        VkWriteDescriptorSet write = {};
+        write.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet               = m_sets[ i_frameIndex ];
+        write.dstBinding           = i_binding;
+        write.dstArrayElement      = i_slot;
+        write.descriptorCount      = 1;
+        return write;
+    }
+
+    VkDevice                       m_device = VK_NULL_HANDLE;
+    VkDescriptorSetLayout          m_layout = VK_NULL_HANDLE;
+    VkDescriptorPool               m_pool   = VK_NULL_HANDLE;
+    std::vector< VkDescriptorSet > m_sets; // Set of each frame in flight.
+    uint32_t                       m_allFramesMask = 0;
+
+    std::vector< BufferSlot >  m_buffers;
+    std::vector< TextureSlot > m_textures;
+    std::vector< uint32_t >    m_dirtyBuffers;  // Slots not yet written to every set.
+    std::vector< uint32_t >    m_dirtyTextures; // Slots not yet written to every set.
+    uint64_t                   m_writeCount = 0;
+};
+
+} // namespace vkbase
@@ -0,0 +1,59 @@
+#pragma once
+
+/// \file vkbase/embeddedShaders.h
+///
+/// SPIR-V compiled into the executable, by the EMBED option of the vulkan_shader CMake function, and looked up by
+/// the file name of the shader.
+
+namespace vkbase
+{
+/// \struct EmbeddedShader
+///
+/// The SPIR-V words of a shader embedded into the executable.
+struct EmbeddedShader
+{
+    const char*     m_name = nullptr; // File name of the compiled shader, such as "shader.vert.spv".
+    const uint32_t* m_code = nullptr;
+    size_t          m_size = 0; // Num bytes.
+};
+
+/// All shaders embedded into the executable, in order of registration.
+inline std::vector< EmbeddedShader >& GetEmbeddedShaders()
+{
+    static std::vector< EmbeddedShader > s_embeddedShaders;
+    return s_embeddedShaders;
+}
+
+/// Find the embedded shader named \p i_name.
+///
+/// \return the shader, or nullptr if no shader of that name was embedded.
+inline const EmbeddedShader* FindEmbeddedShader( const std::string& i_name )
+{
+    for ( const EmbeddedShader& shader : GetEmbeddedShaders() )
+    {
+        if ( i_name == shader.m_name )
+        {
+            return &shader;
+        }
+    }
+
+    return nullptr;
+}
+
+/// \struct EmbeddedShaderRegistration
+///
+/// Adds a shader to GetEmbeddedShaders() on construction.  Each source file generated by the vulkan_shader CMake
+/// function defines one, at namespace scope, so its shader is registered before main is entered.
+struct EmbeddedShaderRegistration
+{
+    EmbeddedShaderRegistration( const char* i_name, const uint32_t* i_code, size_t i_size )
+    {
+        EmbeddedShader shader;
+        shader.m_name = i_name;
+        shader.m_code = i_code;
+        shader.m_size = i_size;
+        GetEmbeddedShaders().push_back( shader );
+    }
+};
+
+} // namespace vkbase
@@ -47,6 +47,36 @@ inline std::string JoinPaths( const std::string& i_lhs, const std::string& i_rhs
     return SanitizePath( path );
 }
 
+/// List the files in the directory \p i_directoryPath whose names end with \p i_suffix.
+///
+/// \param i_directoryPath the directory to list.
+/// \param i_suffix the suffix of the names of the files to list, such as ".ppm".
+///
+/// \return the paths of the files, joined to \p i_directoryPath, sorted by name.
+inline std::vector< std::string > ListFiles( const std::string& i_directoryPath, const std::string& i_suffix )
+{
+    DIR* directory = opendir( i_directoryPath.c_str() );
+    if ( directory == nullptr )
+    {
+        throw std::runtime_error( "Failed to open directory: " + i_directoryPath );
+    }
+
+    std::vector< std::string > filePaths;
+    while ( struct dirent* entry = readdir( directory ) )
+    {
+        std::string name = entry->d_name;
+        if ( name.size() > i_suffix.size() &&
+             name.compare( name.size() - i_suffix.size(), i_suffix.size(), i_suffix ) == 0 )
+        {
+            filePaths.push_back( JoinPaths( i_directoryPath, name ) );
+        }
+    }
+
+    closedir( directory );
+    std::sort( filePaths.begin(), filePaths.end() );
+    return filePaths;
+}
+
 /// Read the file at \p i_filePath, and return an array of binary data.
 ///
 /// \param i_filePath the path to the file to read.
@@ -70,4 +100,96 @@ inline std::vector< char > ReadFile( const std::string& i_filePath )
     return buffer;
 }
 
+/// Check if a file exists, and can be opened for reading, at \p i_filePath.
+inline bool FileExists( const std::string& i_filePath )
+{
+    std::ifstream file( i_filePath );
+    return file.good();
+}
+
+/// Create the directory \p i_directoryPath, and any missing parent directories.
+///
+/// \return true if the directory exists, whether or not it was created by this call.
+inline bool CreateDirectories( const std::string& i_directoryPath )
+{
+    // Create each ancestor in turn, from the root down, then the directory itself.
+    std::string path  = SanitizePath( i_directoryPath );
+    size_t      slash = path.find( '/', 1 );
+    while ( true )
+    {
+        std::string ancestorPath = path.substr( 0, slash );
+        if ( !ancestorPath.empty() && mkdir( ancestorPath.c_str(), 0755 ) != 0 && errno != EEXIST )
+        {
+            return false;
+        }
+
+        if ( slash == std::string::npos )
+        {
+            break;
+        }
+
+        slash = path.find( '/', slash + 1 );
+    }
+
+    struct stat fileStatus;
+    return stat( path.c_str(), &fileStatus ) == 0 && S_ISDIR( fileStatus.st_mode );
+}
+
+/// Write \p i_data to the file at \p i_filePath, atomically, creating its parent directories if missing.
+///
+/// The data is first written to a temporary file of a unique name next to \p i_filePath, which is then renamed
+/// over it, so readers never observe a partially written file, and concurrent writers never write into the same
+/// temporary file.  The last rename wins.
+///
+/// \param i_filePath the path to the file to write.
+/// \param i_data pointer to the data to write.
+/// \param i_size the number of bytes to write.
+///
+/// \return true if the file was successfully written.
+inline bool WriteFileAtomic( const std::string& i_filePath, const void* i_data, size_t i_size )
+{
+    if ( i_filePath.find( '/' ) != std::string::npos && !CreateDirectories( GetParentPath( i_filePath ) ) )
+    {
+        return false;
+    }
+
+    // mkstemp replaces the trailing Xs with a name of its own, and creates the file exclusively.
+    std::string temporaryPath  = i_filePath + ".tmp.XXXXXX";
+    int         fileDescriptor = mkstemp( &temporaryPath[ 0 ] );
+    if ( fileDescriptor < 0 )
+    {
+        return false;
+    }
+
+    const char* data    = static_cast< const char* >( i_data );
+    size_t      written = 0;
+    while ( written < i_size )
+    {
+        ssize_t result = write( fileDescriptor, data + written, i_size - written );
+        if ( result < 0 && errno == EINTR )
+        {
+            continue;
+        }
+
+        if ( result <= 0 )
+        {
+            close( fileDescriptor );
+            remove( temporaryPath.c_str() );
+            return false;
+        }
+
+        written += static_cast< size_t >( result );
+    }
+
+    // mkstemp creates the file readable by the owner only; the cache is shared like any other user file.
+    fchmod( fileDescriptor, 0644 );
+    if ( close( fileDescriptor ) != 0 || rename( temporaryPath.c_str(), i_filePath.c_str() ) != 0 )
+    {
+        remove( temporaryPath.c_str() );
+        return false;
+    }
+
+    return true;
+}
+
 } // namespace vkbase
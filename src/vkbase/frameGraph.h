@@ -0,0 +1,907 @@
+#pragma once
+
+/// \file vkbase/frameGraph.h
+///
+/// A frame graph: render passes declaring the images they read and write, compiled into Vulkan render passes
+/// whose layout transitions and dependencies are derived from those declarations.
+
+namespace vkbase
+{
+/// Handle to an image of a FrameGraph.
+using FrameGraphImage = uint32_t;
+
+/// Handle to a pass of a FrameGraph.
+using FrameGraphPass = uint32_t;
+
+/// \struct FrameGraphImageDesc
+///
+/// Description of an image used by a FrameGraph.
+struct FrameGraphImageDesc
+{
+    VkFormat              m_format  = VK_FORMAT_UNDEFINED;
+    VkExtent2D            m_extent  = {0, 0};
+    VkSampleCountFlagBits m_samples = VK_SAMPLE_COUNT_1_BIT;
+};
+
+/// \struct FrameGraphImageState
+///
+/// The layout of an image, and the stages and accesses using it, before or after the frame graph executes.
+struct FrameGraphImageState
+{
+    VkImageLayout        m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags m_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkAccessFlags        m_access = 0;
+};
+
+/// \class FrameGraph
+///
+/// A sequence of render passes, each declaring the images it renders to and samples from.
+///
+/// Images are either imported, such as the swap chain images, or transient: created by the graph when it is
+/// compiled, and only valid during its execution.  Transient images used by disjoint ranges of passes share
+/// memory.  Transient attachments whose contents never leave their pass, such as most depth buffers, are bound
+/// to lazily allocated memory where the device has it, so tile-based GPUs need not back them at all.
+///
+/// Compiling the graph culls the passes whose output is never used, then creates a VkRenderPass per remaining
+/// pass.  Layout transitions are folded into the attachment descriptions: an image written by a pass is left in
+/// the layout of its next use, and the dependency is expressed as a subpass dependency of the render pass, so
+/// executing the graph records no pipeline barriers of its own.
+///
+/// The graph is rebuilt, rather than modified, when its images change (eg. on swap chain recreation).  The
+/// render passes of a rebuilt graph are compatible with those before, if the formats and sample counts of their
+/// attachments are the same, so pipelines created against them remain usable.
+class FrameGraph
+{
+public:
+    /// Records the commands of a pass, inside its render pass.  Passed the image index given to Execute.
+    using RecordFunction = std::function< void( VkCommandBuffer, uint32_t ) >;
+
+    /// Import an image owned outside the graph.
+    ///
+    /// \param i_imageViews views of the images; the one rendered by each execution is selected by the image index
+    /// passed to Execute.
+    /// \param i_initialState state of the image before the graph executes.
+    /// \param i_finalState state the image is left in, for its use after the graph executes.
+    FrameGraphImage ImportImage( const std::string&                i_name,
+                                 const FrameGraphImageDesc&        i_desc,
+                                 const std::vector< VkImageView >& i_imageViews,
+                                 const FrameGraphImageState&       i_initialState,
+                                 const FrameGraphImageState&       i_finalState )
+    {
+        Image image;
+        image.m_name         = i_name;
+        image.m_desc         = i_desc;
+        image.m_imported     = true;
+        image.m_imageViews   = i_imageViews;
+        image.m_initialState = i_initialState;
+        image.m_finalState   = i_finalState;
+        m_images.push_back( std::move( image ) );
+        return static_cast< FrameGraphImage >( m_images.size() - 1 );
+    }
+
+    /// Declare a transient image, created by Compile.  Its contents are undefined before its first use in each
+    /// execution.
+    FrameGraphImage CreateImage( const std::string& i_name, const FrameGraphImageDesc& i_desc )
+    {
+        Image image;
+        image.m_name = i_name;
+        image.m_desc = i_desc;
+        m_images.push_back( std::move( image ) );
+        return static_cast< FrameGraphImage >( m_images.size() - 1 );
+    }
+
+    /// Add a pass, executed after the passes added before it.
+    ///
+    /// \param i_contents whether \p i_record records the commands of the pass inline, or executes secondary
+    /// command buffers.
+    FrameGraphPass AddPass( const std::string& i_name, VkSubpassContents i_contents, RecordFunction i_record )
+    {
+        Pass pass;
+        pass.m_name     = i_name;
+        pass.m_contents = i_contents;
+        pass.m_record   = std::move( i_record );
+        m_passes.push_back( std::move( pass ) );
+        return static_cast< FrameGraphPass >( m_passes.size() - 1 );
+    }
+
+    /// Render \p i_pass into \p i_image, as its next color attachment.
+    ///
+    /// \param i_loadOp VK_ATTACHMENT_LOAD_OP_LOAD to read the contents left by earlier passes.
+    void AddColorAttachment( FrameGraphPass           i_pass,
+                             FrameGraphImage          i_image,
+                             VkAttachmentLoadOp       i_loadOp,
+                             const VkClearColorValue& i_clearValue = {} )
+    {
+        Attachment attachment;
+        attachment.m_image            = i_image;
+        attachment.m_loadOp           = i_loadOp;
+        attachment.m_clearValue.color = i_clearValue;
+        m_passes[ i_pass ].m_colorAttachments.push_back( attachment );
+        AddUse( i_pass,
+                i_image,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                    ( i_loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0 ),
+                /* i_write */ true,
+                i_loadOp == VK_ATTACHMENT_LOAD_OP_LOAD );
+    }
+
+    /// Resolve the multisampled color attachment \p i_image of \p i_pass into \p i_resolveImage, at the end of
+    /// the subpass.  The resolve replaces the whole of \p i_resolveImage, so its previous contents are discarded.
+    void AddResolveAttachment( FrameGraphPass i_pass, FrameGraphImage i_image, FrameGraphImage i_resolveImage )
+    {
+        for ( Attachment& attachment : m_passes[ i_pass ].m_colorAttachments )
+        {
+            if ( attachment.m_image == i_image )
+            {
+                attachment.m_resolveImage = i_resolveImage;
+                AddUse( i_pass,
+                        i_resolveImage,
+                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                        /* i_write */ true,
+                        /* i_read */ false );
+                return;
+            }
+        }
+
+        throw std::runtime_error( "Image " + m_images[ i_image ].m_name + " is not a color attachment of pass " +
+                                  m_passes[ i_pass ].m_name + "." );
+    }
+
+    /// Depth test \p i_pass against \p i_image.
+    void SetDepthAttachment( FrameGraphPass                  i_pass,
+                             FrameGraphImage                 i_image,
+                             VkAttachmentLoadOp              i_loadOp,
+                             const VkClearDepthStencilValue& i_clearValue = {1.0f, 0} )
+    {
+        Attachment attachment;
+        attachment.m_image                   = i_image;
+        attachment.m_loadOp                  = i_loadOp;
+        attachment.m_clearValue.depthStencil = i_clearValue;
+        m_passes[ i_pass ].m_depthAttachment = attachment;
+        AddUse( i_pass,
+                i_image,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                /* i_write */ true,
+                i_loadOp == VK_ATTACHMENT_LOAD_OP_LOAD );
+    }
+
+    /// Sample \p i_image from shaders at \p i_stages of \p i_pass.  The record function binds GetImageView.
+    void AddSampledImage( FrameGraphPass i_pass, FrameGraphImage i_image, VkPipelineStageFlags i_stages )
+    {
+        AddUse( i_pass,
+                i_image,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                i_stages,
+                VK_ACCESS_SHADER_READ_BIT,
+                /* i_write */ false,
+                /* i_read */ true );
+    }
+
+    /// Cull unused passes, create the render passes and framebuffers, and the transient images.
+    void Compile( VkDevice i_device, MemoryAllocator& io_allocator )
+    {
+        m_device = i_device;
+        CullPasses();
+        CreateTransientImages( io_allocator );
+        for ( Pass& pass : m_passes )
+        {
+            if ( pass.m_culled )
+            {
+                continue;
+            }
+
+            CreateRenderPass( pass );
+            CreateFramebuffers( pass );
+        }
+    }
+
+    /// Record the passes into \p i_commandBuffer, rendering to the \p i_imageIndex'th view of imported images.
+    void Execute( VkCommandBuffer i_commandBuffer, uint32_t i_imageIndex ) const
+    {
+        for ( const Pass& pass : m_passes )
+        {
+            if ( pass.m_culled )
+            {
+                continue;
+            }
+
+            VkRenderPassBeginInfo renderPassInfo = {};
+            renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass            = pass.m_renderPass;
+            renderPassInfo.framebuffer           = pass.m_framebuffers[ i_imageIndex % pass.m_framebuffers.size() ];
+            renderPassInfo.renderArea.offset     = {0, 0};
+            renderPassInfo.renderArea.extent     = pass.m_extent;
+            renderPassInfo.clearValueCount       = static_cast< uint32_t >( pass.m_clearValues.size() );
+            renderPassInfo.pClearValues          = pass.m_clearValues.data();
+
+            vkCmdBeginRenderPass( i_commandBuffer, &renderPassInfo, pass.m_contents );
+            pass.m_record( i_commandBuffer, i_imageIndex );
+            vkCmdEndRenderPass( i_commandBuffer );
+        }
+    }
+
+    /// Destroy the render passes, framebuffers and transient images.  No submission may be using them.
+    void Teardown( MemoryAllocator& io_allocator )
+    {
+        for ( Pass& pass : m_passes )
+        {
+            for ( VkFramebuffer framebuffer : pass.m_framebuffers )
+            {
+                vkDestroyFramebuffer( m_device, framebuffer, nullptr );
+            }
+
+            vkDestroyRenderPass( m_device, pass.m_renderPass, nullptr );
+        }
+
+        for ( Image& image : m_images )
+        {
+            if ( image.m_imported )
+            {
+                continue;
+            }
+
+            for ( VkImageView imageView : image.m_imageViews )
+            {
+                vkDestroyImageView( m_device, imageView, nullptr );
+            }
+
+            vkDestroyImage( m_device, image.m_image, nullptr );
+        }
+
+        for ( const MemoryAllocation& allocation : m_allocations )
+        {
+            io_allocator.Free( allocation );
+        }
+
+        m_images.clear();
+        m_passes.clear();
+        m_allocations.clear();
+    }
+
+    /// The render pass of \p i_pass, for creating pipelines and secondary command buffers rendering in it.
+    VkRenderPass GetRenderPass( FrameGraphPass i_pass ) const
+    {
+        return m_passes[ i_pass ].m_renderPass;
+    }
+
+    /// The framebuffer \p i_pass renders to, given the image index passed to Execute.
+    VkFramebuffer GetFramebuffer( FrameGraphPass i_pass, uint32_t i_imageIndex ) const
+    {
+        const std::vector< VkFramebuffer >& framebuffers = m_passes[ i_pass ].m_framebuffers;
+        return framebuffers[ i_imageIndex % framebuffers.size() ];
+    }
+
+    /// A view of the transient \p i_image.
+    VkImageView GetImageView( FrameGraphImage i_image ) const
+    {
+        return m_images[ i_image ].m_imageViews[ 0 ];
+    }
+
+    /// The number of passes executed, after culling.
+    uint32_t GetPassCount() const
+    {
+        return static_cast< uint32_t >(
+            std::count_if( m_passes.begin(), m_passes.end(), []( const Pass& i_pass ) { return !i_pass.m_culled; } ) );
+    }
+
+    /// The number of subpass dependencies synchronizing the passes with each other, and with the use of imported
+    /// images outside the graph.
+    uint32_t GetDependencyCount() const
+    {
+        return m_dependencyCount;
+    }
+
+    /// The number of transient images bound to lazily allocated memory.
+    uint32_t GetLazilyAllocatedImageCount() const
+    {
+        return m_lazilyAllocatedImageCount;
+    }
+
+    /// The memory bound to transient images, and the memory they would need without aliasing.
+    void GetTransientMemorySize( VkDeviceSize& o_size, VkDeviceSize& o_unaliasedSize ) const
+    {
+        o_size          = 0;
+        o_unaliasedSize = 0;
+        for ( const MemoryAllocation& allocation : m_allocations )
+        {
+            o_size += allocation.m_size;
+        }
+
+        for ( const Image& image : m_images )
+        {
+            o_unaliasedSize += image.m_memoryRequirements.size;
+        }
+    }
+
+private:
+    static constexpr FrameGraphImage s_noImage = UINT32_MAX;
+
+    // A use of an image by a pass.
+    struct Use
+    {
+        FrameGraphPass       m_pass;
+        VkImageLayout        m_layout;
+        VkPipelineStageFlags m_stages;
+        VkAccessFlags        m_access;
+        bool                 m_write;
+        bool                 m_read;
+    };
+
+    struct Image
+    {
+        std::string                m_name;
+        FrameGraphImageDesc        m_desc;
+        bool                       m_imported = false;
+        std::vector< VkImageView > m_imageViews; // One per image index if imported, else a single view.
+        FrameGraphImageState       m_initialState;
+        FrameGraphImageState       m_finalState;
+        std::vector< Use >         m_uses; // In pass order, excluding culled passes once compiled.
+
+        // Transient images only.
+        VkImage              m_image              = VK_NULL_HANDLE;
+        VkMemoryRequirements m_memoryRequirements = {};
+        size_t               m_memorySlot         = 0; // Index of the memory range shared with other transient images.
+        bool                 m_lazilyAllocated    = false; // Are its contents only used within a single pass?
+    };
+
+    struct Attachment
+    {
+        FrameGraphImage    m_image        = s_noImage;
+        VkAttachmentLoadOp m_loadOp       = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        VkClearValue       m_clearValue   = {};
+        FrameGraphImage    m_resolveImage = s_noImage; // Image a color attachment is resolved into.
+    };
+
+    struct Pass
+    {
+        std::string                    m_name;
+        VkSubpassContents              m_contents;
+        RecordFunction                 m_record;
+        std::vector< Attachment >      m_colorAttachments;
+        std::optional< Attachment >    m_depthAttachment;
+        std::vector< FrameGraphImage > m_images; // All images used by the pass.
+        bool                           m_culled = false;
+
+        // Created by Compile.
+        VkRenderPass                   m_renderPass = VK_NULL_HANDLE;
+        std::vector< VkFramebuffer >   m_framebuffers;     // One per view of the imported images it renders to.
+        std::vector< FrameGraphImage > m_attachmentImages; // In the order of the render pass attachments.
+        std::vector< VkClearValue >    m_clearValues;      // One per attachment.
+        VkExtent2D                     m_extent = {0, 0};
+    };
+
+    // A memory range bound to transient images used by disjoint ranges of passes.
+    struct MemorySlot
+    {
+        VkMemoryRequirements           m_requirements;
+        std::vector< FrameGraphImage > m_images;
+        bool                           m_lazilyAllocated; // Are the images all transient attachments?
+    };
+
+    void AddUse( FrameGraphPass       i_pass,
+                 FrameGraphImage      i_image,
+                 VkImageLayout        i_layout,
+                 VkPipelineStageFlags i_stages,
+                 VkAccessFlags        i_access,
+                 bool                 i_write,
+                 bool                 i_read )
+    {
+        Pass& pass = m_passes[ i_pass ];
+        if ( std::find( pass.m_images.begin(), pass.m_images.end(), i_image ) != pass.m_images.end() )
+        {
+            throw std::runtime_error( "Image " + m_images[ i_image ].m_name + " is used more than once by pass " +
+                                      pass.m_name + "." );
+        }
+
+        pass.m_images.push_back( i_image );
+        m_images[ i_image ].m_uses.push_back( {i_pass, i_layout, i_stages, i_access, i_write, i_read} );
+    }
+
+    // Cull the passes whose writes are neither imported images nor read by a later pass, walking backwards so a
+    // pass is only kept alive by the passes which are themselves kept.
+    void CullPasses()
+    {
+        std::vector< bool > isRead( m_images.size(), false );
+        for ( size_t passIndex = m_passes.size(); passIndex-- > 0; )
+        {
+            Pass& pass = m_passes[ passIndex ];
+
+            pass.m_culled = true;
+            for ( FrameGraphImage image : pass.m_images )
+            {
+                if ( FindUse( image, static_cast< FrameGraphPass >( passIndex ) ).m_write &&
+                     ( m_images[ image ].m_imported || isRead[ image ] ) )
+                {
+                    pass.m_culled = false;
+                }
+            }
+
+            if ( pass.m_culled )
+            {
+                continue;
+            }
+
+            for ( FrameGraphImage image : pass.m_images )
+            {
+                const Use& use = FindUse( image, static_cast< FrameGraphPass >( passIndex ) );
+                isRead[ image ] = use.m_read || ( isRead[ image ] && !use.m_write );
+            }
+        }
+
+        for ( Image& image : m_images )
+        {
+            std::vector< Use >& uses = image.m_uses;
+            uses.erase( std::remove_if( uses.begin(),
+                                        uses.end(),
+                                        [this]( const Use& i_use ) { return m_passes[ i_use.m_pass ].m_culled; } ),
+                        uses.end() );
+        }
+    }
+
+    const Use& FindUse( FrameGraphImage i_image, FrameGraphPass i_pass ) const
+    {
+        for ( const Use& use : m_images[ i_image ].m_uses )
+        {
+            if ( use.m_pass == i_pass )
+            {
+                return use;
+            }
+        }
+
+        throw std::runtime_error( "Image " + m_images[ i_image ].m_name + " is not used by the pass." );
+    }
+
+    // Create the transient images, and bind those whose uses do not overlap to the same memory.
+    void CreateTransientImages( MemoryAllocator& io_allocator )
+    {
+        std::vector< FrameGraphImage > transientImages;
+        for ( size_t imageIndex = 0; imageIndex < m_images.size(); ++imageIndex )
+        {
+            Image& image = m_images[ imageIndex ];
+            if ( image.m_imported || image.m_uses.empty() )
+            {
+                continue;
+            }
+
+            if ( image.m_uses.front().m_read && !image.m_uses.front().m_write )
+            {
+                throw std::runtime_error( "Transient image " + image.m_name + " is read before being written." );
+            }
+
+            CreateTransientImage( image );
+            transientImages.push_back( static_cast< FrameGraphImage >( imageIndex ) );
+        }
+
+        // Visit the largest images first, so the smaller ones fit into the memory ranges they create.
+        std::sort( transientImages.begin(),
+                   transientImages.end(),
+                   [this]( FrameGraphImage i_lhs, FrameGraphImage i_rhs ) {
+                       return m_images[ i_lhs ].m_memoryRequirements.size >
+                              m_images[ i_rhs ].m_memoryRequirements.size;
+                   } );
+
+        std::vector< MemorySlot > slots;
+        for ( FrameGraphImage imageIndex : transientImages )
+        {
+            Image&                      image        = m_images[ imageIndex ];
+            const VkMemoryRequirements& requirements = image.m_memoryRequirements;
+
+            size_t slotIndex = 0;
+            for ( ; slotIndex < slots.size(); ++slotIndex )
+            {
+                MemorySlot& slot = slots[ slotIndex ];
+                bool        fits = ( slot.m_requirements.memoryTypeBits & requirements.memoryTypeBits ) != 0 &&
+                            slot.m_lazilyAllocated == image.m_lazilyAllocated;
+                for ( FrameGraphImage other : slot.m_images )
+                {
+                    fits = fits && !IsOverlapping( m_images[ other ], image );
+                }
+
+                if ( fits )
+                {
+                    break;
+                }
+            }
+
+            if ( slotIndex == slots.size() )
+            {
+                slots.push_back( {requirements, {}, image.m_lazilyAllocated} );
+            }
+
+            MemorySlot& slot                  = slots[ slotIndex ];
+            slot.m_requirements.size          = std::max( slot.m_requirements.size, requirements.size );
+            slot.m_requirements.alignment     = std::max( slot.m_requirements.alignment, requirements.alignment );
+            slot.m_requirements.memoryTypeBits &= requirements.memoryTypeBits;
+            slot.m_images.push_back( imageIndex );
+            image.m_memorySlot = slotIndex;
+        }
+
+        for ( const MemorySlot& slot : slots )
+        {
+            VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            if ( slot.m_lazilyAllocated &&
+                 io_allocator.HasMemoryType( slot.m_requirements.memoryTypeBits,
+                                             properties | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT ) )
+            {
+                properties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+                m_lazilyAllocatedImageCount += static_cast< uint32_t >( slot.m_images.size() );
+            }
+
+            MemoryAllocation allocation = io_allocator.Allocate( slot.m_requirements, properties );
+            m_allocations.push_back( allocation );
+
+            for ( FrameGraphImage imageIndex : slot.m_images )
+            {
+                Image& image = m_images[ imageIndex ];
+                if ( vkBindImageMemory( m_device, image.m_image, allocation.m_memory, allocation.m_offset ) !=
+                     VK_SUCCESS )
+                {
+                    throw std::runtime_error( "Failed to bind memory of transient image " + image.m_name + "." );
+                }
+
+                CreateTransientImageView( image );
+            }
+        }
+
+        m_memorySlots = std::move( slots );
+    }
+
+    void CreateTransientImage( Image& io_image )
+    {
+        // An attachment which is neither loaded nor stored never needs to be backed by memory outside of the
+        // tile memory of the GPU.
+        const Use& firstUse        = io_image.m_uses.front();
+        io_image.m_lazilyAllocated = io_image.m_uses.size() == 1 && IsAttachment( firstUse ) && !firstUse.m_read;
+
+        VkImageUsageFlags usage = io_image.m_lazilyAllocated ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0;
+        for ( const Use& use : io_image.m_uses )
+        {
+            switch ( use.m_layout )
+            {
+            case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+                usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+                break;
+            case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+                usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+                break;
+            default:
+                usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+                break;
+            }
+        }
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType         = VK_IMAGE_TYPE_2D;
+        imageInfo.format            = io_image.m_desc.m_format;
+        imageInfo.extent            = {io_image.m_desc.m_extent.width, io_image.m_desc.m_extent.height, 1};
+        imageInfo.mipLevels         = 1;
+        imageInfo.arrayLayers       = 1;
+        imageInfo.samples           = io_image.m_desc.m_samples;
+        imageInfo.tiling            = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage             = usage;
+        imageInfo.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+        if ( vkCreateImage( m_device, &imageInfo, nullptr, &io_image.m_image ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create transient image " + io_image.m_name + "." );
+        }
+
+        vkGetImageMemoryRequirements( m_device, io_image.m_image, &io_image.m_memoryRequirements );
+    }
+
+    void CreateTransientImageView( Image& io_image )
+    {
+        VkImageViewCreateInfo viewInfo           = {};
+        viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image                           = io_image.m_image;
+        viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format                          = io_image.m_desc.m_format;
+        viewInfo.subresourceRange.aspectMask     = GetAspectMask( io_image.m_desc.m_format );
+        viewInfo.subresourceRange.baseMipLevel   = 0;
+        viewInfo.subresourceRange.levelCount     = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount     = 1;
+
+        VkImageView imageView;
+        if ( vkCreateImageView( m_device, &viewInfo, nullptr, &imageView ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create view of transient image " + io_image.m_name + "." );
+        }
+
+        io_image.m_imageViews = {imageView};
+    }
+
+    static VkImageAspectFlags GetAspectMask( VkFormat i_format )
+    {
+        switch ( i_format )
+        {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+    }
+
+    // Do the passes using two images overlap?
+    static bool IsOverlapping( const Image& i_lhs, const Image& i_rhs )
+    {
+        return i_lhs.m_uses.front().m_pass <= i_rhs.m_uses.back().m_pass &&
+               i_rhs.m_uses.front().m_pass <= i_lhs.m_uses.back().m_pass;
+    }
+
+    // Describe how the pass uses each of its attachments, and the dependencies with the uses before and after it.
+    //
+    // An attachment is left in the layout of the image's next use, or the final state of an imported image, with
+    // a dependency from the pass to the reads which follow it.  Images sampled by the pass are then already in the
+    // right layout, so only need a dependency from the commands before the pass if they are not covered by one
+    // already.  The first use of a transient image waits for the last use of its memory, by an earlier image
+    // sharing it or by the previous execution of the graph.
+    void CreateRenderPass( Pass& io_pass )
+    {
+        if ( io_pass.m_colorAttachments.empty() && !io_pass.m_depthAttachment.has_value() )
+        {
+            throw std::runtime_error( "Pass " + io_pass.m_name + " has no attachments." );
+        }
+
+        const FrameGraphPass passIndex = static_cast< FrameGraphPass >( &io_pass - m_passes.data() );
+
+        VkSubpassDependency incoming = {};
+        incoming.srcSubpass          = VK_SUBPASS_EXTERNAL;
+        incoming.dstSubpass          = 0;
+        for ( FrameGraphImage imageIndex : io_pass.m_images )
+        {
+            const Image& image   = m_images[ imageIndex ];
+            const Use&   use     = FindUse( imageIndex, passIndex );
+            const Use*   prevUse = &use == &image.m_uses.front() ? nullptr : &use - 1;
+            if ( prevUse == nullptr && image.m_imported )
+            {
+                if ( !IsAttachment( use ) && image.m_initialState.m_layout != use.m_layout )
+                {
+                    throw std::runtime_error( "Imported image " + image.m_name +
+                                              " must be imported in the layout of its first use." );
+                }
+
+                const FrameGraphImageState& initialState = image.m_initialState;
+                AddDependency( incoming, initialState.m_stages, initialState.m_access, use.m_stages, use.m_access );
+            }
+            else if ( prevUse == nullptr )
+            {
+                for ( FrameGraphImage other : m_memorySlots[ image.m_memorySlot ].m_images )
+                {
+                    const Use& lastUse = m_images[ other ].m_uses.back();
+                    AddDependency( incoming, lastUse.m_stages, lastUse.m_access, use.m_stages, use.m_access );
+                }
+            }
+            else if ( !IsAttachment( *prevUse ) && use.m_write )
+            {
+                // Reads by an earlier pass, which left the image as it was, must complete before it is written.
+                AddDependency( incoming, prevUse->m_stages, 0, use.m_stages, use.m_access );
+            }
+
+            if ( !IsAttachment( use ) && image.m_imported && &use == &image.m_uses.back() &&
+                 image.m_finalState.m_layout != use.m_layout )
+            {
+                throw std::runtime_error( "Imported image " + image.m_name +
+                                          " must be written by its last use, to be left in its final layout." );
+            }
+        }
+
+        VkSubpassDependency outgoing = {};
+        outgoing.srcSubpass          = 0;
+        outgoing.dstSubpass          = VK_SUBPASS_EXTERNAL;
+
+        // Each color attachment is followed by the attachment it is resolved into, if any.
+        std::vector< VkAttachmentDescription > attachments;
+        std::vector< VkAttachmentReference >   colorReferences;
+        std::vector< VkAttachmentReference >   resolveReferences;
+        bool                                   resolve        = false;
+        VkAttachmentReference                  depthReference = {};
+        for ( const Attachment& attachment : io_pass.m_colorAttachments )
+        {
+            colorReferences.push_back( AddAttachment( io_pass, attachment, outgoing, attachments ) );
+            resolveReferences.push_back( {VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED} );
+            if ( attachment.m_resolveImage != s_noImage )
+            {
+                Attachment resolveAttachment;
+                resolveAttachment.m_image  = attachment.m_resolveImage;
+                resolveAttachment.m_loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                resolveReferences.back()   = AddAttachment( io_pass, resolveAttachment, outgoing, attachments );
+                resolve                    = true;
+            }
+        }
+
+        if ( io_pass.m_depthAttachment.has_value() )
+        {
+            depthReference = AddAttachment( io_pass, io_pass.m_depthAttachment.value(), outgoing, attachments );
+        }
+
+        VkSubpassDescription subpass    = {};
+        subpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount    = static_cast< uint32_t >( colorReferences.size() );
+        subpass.pColorAttachments       = colorReferences.data();
+        subpass.pResolveAttachments     = resolve ? resolveReferences.data() : nullptr;
+        subpass.pDepthStencilAttachment = io_pass.m_depthAttachment.has_value() ? &depthReference : nullptr;
+
+        std::vector< VkSubpassDependency > dependencies;
+        for ( const VkSubpassDependency& dependency : {incoming, outgoing} )
+        {
+            if ( dependency.srcStageMask != 0 )
+            {
+                dependencies.push_back( dependency );
+            }
+        }
+        m_dependencyCount += static_cast< uint32_t >( dependencies.size() );
+
+        VkRenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount        = static_cast< uint32_t >( attachments.size() );
+        renderPassInfo.pAttachments           = attachments.data();
+        renderPassInfo.subpassCount           = 1;
+        renderPassInfo.pSubpasses             = &subpass;
+        renderPassInfo.dependencyCount        = static_cast< uint32_t >( dependencies.size() );
+        renderPassInfo.pDependencies          = dependencies.data();
+
+        if ( vkCreateRenderPass( m_device, &renderPassInfo, nullptr, &io_pass.m_renderPass ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create render pass " + io_pass.m_name + "." );
+        }
+    }
+
+    // Describe how \p i_attachment of the pass is loaded, stored and transitioned, and add its dependency on the
+    // uses after the pass to \p io_outgoing.
+    //
+    // \return the reference of the subpass to the attachment.
+    VkAttachmentReference AddAttachment( Pass&                                   io_pass,
+                                         const Attachment&                       i_attachment,
+                                         VkSubpassDependency&                    io_outgoing,
+                                         std::vector< VkAttachmentDescription >& io_descriptions )
+    {
+        const FrameGraphPass passIndex = static_cast< FrameGraphPass >( &io_pass - m_passes.data() );
+        const Image&         image     = m_images[ i_attachment.m_image ];
+        const Use&           use       = FindUse( i_attachment.m_image, passIndex );
+        const size_t         useIndex  = &use - image.m_uses.data();
+
+        // Leave the attachment ready for the uses up to its next write, which all share its next layout.
+        FrameGraphImageState nextState = {use.m_layout, 0, 0};
+        if ( useIndex + 1 < image.m_uses.size() )
+        {
+            nextState.m_layout = image.m_uses[ useIndex + 1 ].m_layout;
+            for ( size_t nextIndex = useIndex + 1; nextIndex < image.m_uses.size(); ++nextIndex )
+            {
+                const Use& nextUse = image.m_uses[ nextIndex ];
+                nextState.m_stages |= nextUse.m_stages;
+                nextState.m_access |= nextUse.m_access;
+                if ( nextUse.m_write || IsAttachment( nextUse ) )
+                {
+                    break;
+                }
+            }
+        }
+        else if ( image.m_imported )
+        {
+            nextState = image.m_finalState;
+        }
+
+        if ( nextState.m_stages != 0 )
+        {
+            AddDependency( io_outgoing, use.m_stages, use.m_access, nextState.m_stages, nextState.m_access );
+        }
+
+        // The layout the image was left in by its previous use.  Only the contents of the first use may be
+        // discarded by a transition from the undefined layout: a later transition would not be ordered after
+        // the previous use, whose dependency only covers the attachment accesses of this pass.
+        VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if ( useIndex > 0 )
+        {
+            const Use& prevUse = image.m_uses[ useIndex - 1 ];
+            initialLayout      = IsAttachment( prevUse ) ? use.m_layout : prevUse.m_layout;
+        }
+        else if ( i_attachment.m_loadOp == VK_ATTACHMENT_LOAD_OP_LOAD )
+        {
+            initialLayout = image.m_initialState.m_layout;
+        }
+
+        VkAttachmentDescription description = {};
+        description.format                  = image.m_desc.m_format;
+        description.samples                 = image.m_desc.m_samples;
+        description.loadOp                  = i_attachment.m_loadOp;
+        description.storeOp = useIndex + 1 < image.m_uses.size() || image.m_imported
+                                  ? VK_ATTACHMENT_STORE_OP_STORE
+                                  : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        description.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        description.initialLayout  = initialLayout;
+        description.finalLayout    = nextState.m_layout;
+
+        VkAttachmentReference reference = {};
+        reference.attachment            = static_cast< uint32_t >( io_descriptions.size() );
+        reference.layout                = use.m_layout;
+
+        io_descriptions.push_back( description );
+        io_pass.m_attachmentImages.push_back( i_attachment.m_image );
+        io_pass.m_clearValues.push_back( i_attachment.m_clearValue );
+        io_pass.m_extent = image.m_desc.m_extent;
+        return reference;
+    }
+
+    // Create a framebuffer per view of the imported images the pass renders to, or a single framebuffer if it
+    // only renders to transient images.
+    void CreateFramebuffers( Pass& io_pass )
+    {
+        size_t framebufferCount = 1;
+        for ( FrameGraphImage imageIndex : io_pass.m_attachmentImages )
+        {
+            framebufferCount = std::max( framebufferCount, m_images[ imageIndex ].m_imageViews.size() );
+        }
+
+        io_pass.m_framebuffers.resize( framebufferCount );
+        for ( size_t framebufferIndex = 0; framebufferIndex < framebufferCount; ++framebufferIndex )
+        {
+            std::vector< VkImageView > imageViews;
+            for ( FrameGraphImage imageIndex : io_pass.m_attachmentImages )
+            {
+                const std::vector< VkImageView >& views = m_images[ imageIndex ].m_imageViews;
+                imageViews.push_back( views[ framebufferIndex % views.size() ] );
+            }
+
+            VkFramebufferCreateInfo framebufferInfo = {};
+            framebufferInfo.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass              = io_pass.m_renderPass;
+            framebufferInfo.attachmentCount         = static_cast< uint32_t >( imageViews.size() );
+            framebufferInfo.pAttachments            = imageViews.data();
+            framebufferInfo.width                   = io_pass.m_extent.width;
+            framebufferInfo.height                  = io_pass.m_extent.height;
+            framebufferInfo.layers                  = 1;
+
+            VkFramebuffer& framebuffer = io_pass.m_framebuffers[ framebufferIndex ];
+            if ( vkCreateFramebuffer( m_device, &framebufferInfo, nullptr, &framebuffer ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to create framebuffer of pass " + io_pass.m_name + "." );
+            }
+        }
+    }
+
+    static bool IsAttachment( const Use& i_use )
+    {
+        return i_use.m_layout != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
+    static void AddDependency( VkSubpassDependency& io_dependency,
+                               VkPipelineStageFlags i_srcStages,
+                               VkAccessFlags        i_srcAccess,
+                               VkPipelineStageFlags i_dstStages,
+                               VkAccessFlags        i_dstAccess )
+    {
+        // Only writes need to be made available.
+        constexpr VkAccessFlags writeAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                              VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        io_dependency.srcStageMask |= i_srcStages;
+        io_dependency.srcAccessMask |= i_srcAccess & writeAccess;
+        io_dependency.dstStageMask |= i_dstStages;
+        io_dependency.dstAccessMask |= i_dstAccess;
+    }
+
+    VkDevice                        m_device = VK_NULL_HANDLE;
+    std::vector< Image >            m_images;
+    std::vector< Pass >             m_passes;
+    std::vector< MemorySlot >       m_memorySlots;
+    std::vector< MemoryAllocation > m_allocations;
+    uint32_t                        m_dependencyCount           = 0;
+    uint32_t                        m_lazilyAllocatedImageCount = 0;
+};
+
+} // namespace vkbase
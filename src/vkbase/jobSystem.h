@@ -0,0 +1,159 @@
+#pragma once
+
+/// \file vkbase/jobSystem.h
+///
+/// A pool of worker threads, for splitting work such as command buffer recording across cores.
+
+namespace vkbase
+{
+/// \class JobSystem
+///
+/// Runs batches of jobs across a fixed set of threads: the calling thread, and persistent worker threads.
+///
+/// Each job is passed the index of the thread running it, in [0, GetThreadCount()), so per-thread resources
+/// such as command pools can be used without further synchronization.  The calling thread is thread 0.
+class JobSystem
+{
+public:
+    /// Construct a job system running jobs on \p i_threadCount threads, including the calling thread.
+    explicit JobSystem( size_t i_threadCount )
+        : m_threadCount( std::max( i_threadCount, size_t( 1 ) ) )
+    {
+        for ( size_t threadIndex = 1; threadIndex < m_threadCount; ++threadIndex )
+        {
+            m_threads.emplace_back( &JobSystem::WorkerLoop, this, threadIndex );
+        }
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_exit = true;
+        }
+
+        m_wakeCondition.notify_all();
+        for ( std::thread& thread : m_threads )
+        {
+            thread.join();
+        }
+    }
+
+    JobSystem( const JobSystem& ) = delete;
+    JobSystem& operator=( const JobSystem& ) = delete;
+
+    /// The number of threads jobs are run on, including the calling thread.
+    size_t GetThreadCount() const
+    {
+        return m_threadCount;
+    }
+
+    /// Run \p i_function( jobIndex, threadIndex ) for each job index in [0, \p i_jobCount), and wait for all of
+    /// them to complete.  The first exception thrown by a job is rethrown on the calling thread.
+    void ParallelFor( size_t i_jobCount, const std::function< void( size_t, size_t ) >& i_function )
+    {
+        if ( m_threadCount == 1 || i_jobCount <= 1 )
+        {
+            for ( size_t jobIndex = 0; jobIndex < i_jobCount; ++jobIndex )
+            {
+                i_function( jobIndex, 0 );
+            }
+
+            return;
+        }
+
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_function       = &i_function;
+            m_jobCount       = i_jobCount;
+            m_pendingWorkers = m_threads.size();
+            m_exception      = nullptr;
+            m_nextJobIndex.store( 0, std::memory_order_relaxed );
+            m_generation++;
+        }
+
+        m_wakeCondition.notify_all();
+        RunJobs( 0 );
+
+        std::unique_lock< std::mutex > lock( m_mutex );
+        m_doneCondition.wait( lock, [this]() { return m_pendingWorkers == 0; } );
+        m_function = nullptr;
+
+        if ( m_exception != nullptr )
+        {
+            std::rethrow_exception( m_exception );
+        }
+    }
+
+private:
+    // Claim and run jobs of the current batch, until none remain.
+    void RunJobs( size_t i_threadIndex )
+    {
+        for ( ;; )
+        {
+            size_t jobIndex = m_nextJobIndex.fetch_add( 1, std::memory_order_relaxed );
+            if ( jobIndex >= m_jobCount )
+            {
+                return;
+            }
+
+            try
+            {
+                ( *m_function )( jobIndex, i_threadIndex );
+            }
+            catch ( ... )
+            {
+                std::lock_guard< std::mutex > lock( m_mutex );
+                if ( m_exception == nullptr )
+                {
+                    m_exception = std::current_exception();
+                }
+            }
+        }
+    }
+
+    // Wait for each batch of jobs, and help run it.
+    void WorkerLoop( size_t i_threadIndex )
+    {
+        uint64_t generation = 0;
+        for ( ;; )
+        {
+            {
+                std::unique_lock< std::mutex > lock( m_mutex );
+                m_wakeCondition.wait( lock, [&]() { return m_exit || m_generation != generation; } );
+                if ( m_exit )
+                {
+                    return;
+                }
+
+                generation = m_generation;
+            }
+
+            RunJobs( i_threadIndex );
+
+            std::lock_guard< std::mutex > lock( m_mutex );
+            if ( --m_pendingWorkers == 0 )
+            {
+                m_doneCondition.notify_one();
+            }
+        }
+    }
+
+    size_t                     m_threadCount;
+    std::vector< std::thread > m_threads;
+
+    std::mutex              m_mutex;
+    std::condition_variable m_wakeCondition; // Signals a new batch of jobs, or exit, to the workers.
+    std::condition_variable m_doneCondition; // Signals that every worker has finished the batch.
+
+    // The current batch of jobs.
+    const std::function< void( size_t, size_t ) >* m_function = nullptr;
+    size_t                                         m_jobCount = 0;
+    std::atomic< size_t >                          m_nextJobIndex{0};
+    size_t                                         m_pendingWorkers = 0; // Workers yet to finish the batch.
+    uint64_t                                       m_generation     = 0; // Number of batches started.
+    std::exception_ptr                             m_exception;
+    bool                                           m_exit = false;
+};
+
+} // namespace vkbase
@@ -0,0 +1,301 @@
+#pragma once
+
+/// \file vkbase/memoryAllocator.h
+///
+/// Sub-allocation of device memory from large blocks, to stay far below maxMemoryAllocationCount and to
+/// amortize the cost of vkAllocateMemory.
+
+namespace vkbase
+{
+/// Find the index of a memory type allowed by \p i_typeFilter, which has all of \p i_properties.
+///
+/// \return the memory type index, or UINT32_MAX if there is no such memory type.
+inline uint32_t FindMemoryTypeIndex( const VkPhysicalDeviceMemoryProperties& i_memoryProperties,
+                                     uint32_t                                i_typeFilter,
+                                     VkMemoryPropertyFlags                   i_properties )
+{
+    for ( uint32_t typeIndex = 0; typeIndex < i_memoryProperties.memoryTypeCount; ++typeIndex )
+    {
+        if ( ( i_typeFilter & ( 1 << typeIndex ) ) &&
+             ( i_memoryProperties.memoryTypes[ typeIndex ].propertyFlags & i_properties ) == i_properties )
+        {
+            return typeIndex;
+        }
+    }
+
+    return UINT32_MAX;
+}
+
+/// \struct MemoryAllocation
+///
+/// A range of device memory, sub-allocated by the MemoryAllocator.
+struct MemoryAllocation
+{
+    VkDeviceMemory m_memory          = VK_NULL_HANDLE; // The memory block the range belongs to.
+    VkDeviceSize   m_offset          = 0;              // Offset of the range into the block.
+    VkDeviceSize   m_size            = 0;              // Size of the range.
+    uint32_t       m_memoryTypeIndex = 0;              // Memory type of the block.
+    void*          m_mappedData      = nullptr; // Host pointer to the start of the range, if host visible.
+};
+
+/// \class MemoryAllocator
+///
+/// Allocates large VkDeviceMemory blocks per memory type, and sub-allocates ranges from them by first fit.
+///
+/// Host visible blocks are persistently mapped.  Every range is aligned to bufferImageGranularity, so buffers
+/// and optimal tiling images can share blocks.  Requests larger than a block, or for lazily allocated memory,
+/// get a dedicated allocation: lazily allocated memory is only backed as the image bound to it needs, so
+/// sharing a block would gain nothing.
+class MemoryAllocator
+{
+public:
+    /// Default size of each memory block.
+    static constexpr VkDeviceSize s_defaultBlockSize = 64 * 1024 * 1024;
+
+    /// Initialize the allocator for \p i_device.
+    ///
+    /// \param i_blockSize size of each memory block.
+    void Init( VkPhysicalDevice i_physicalDevice, VkDevice i_device, VkDeviceSize i_blockSize = s_defaultBlockSize )
+    {
+        m_device    = i_device;
+        m_blockSize = i_blockSize;
+        vkGetPhysicalDeviceMemoryProperties( i_physicalDevice, &m_memoryProperties );
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties( i_physicalDevice, &properties );
+        m_bufferImageGranularity = properties.limits.bufferImageGranularity;
+    }
+
+    /// Allocate a range of memory meeting \p i_requirements, with all of \p i_properties.
+    MemoryAllocation Allocate( const VkMemoryRequirements& i_requirements, VkMemoryPropertyFlags i_properties )
+    {
+        uint32_t memoryTypeIndex =
+            FindMemoryTypeIndex( m_memoryProperties, i_requirements.memoryTypeBits, i_properties );
+        if ( memoryTypeIndex == UINT32_MAX )
+        {
+            throw std::runtime_error( "Failed to find suitable memory type." );
+        }
+
+        VkDeviceSize alignment = std::max( i_requirements.alignment, m_bufferImageGranularity );
+        VkDeviceSize size      = AlignUp( i_requirements.size, m_bufferImageGranularity );
+
+        // Dedicated allocation for requests which do not fit in a block, or which are lazily allocated.
+        if ( size > m_blockSize || ( i_properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT ) )
+        {
+            MemoryBlock& block = CreateBlock( memoryTypeIndex, size, /* i_dedicated */ true );
+            return SubAllocate( block, 0, size );
+        }
+
+        for ( std::unique_ptr< MemoryBlock >& block : m_blocks )
+        {
+            if ( block->m_memoryTypeIndex != memoryTypeIndex || block->m_dedicated )
+            {
+                continue;
+            }
+
+            VkDeviceSize offset = 0;
+            if ( FindFreeRange( *block, size, alignment, offset ) )
+            {
+                return SubAllocate( *block, offset, size );
+            }
+        }
+
+        MemoryBlock& block = CreateBlock( memoryTypeIndex, m_blockSize, /* i_dedicated */ false );
+        return SubAllocate( block, 0, size );
+    }
+
+    /// Check if there is a memory type allowed by \p i_typeFilter, which has all of \p i_properties.
+    bool HasMemoryType( uint32_t i_typeFilter, VkMemoryPropertyFlags i_properties ) const
+    {
+        return FindMemoryTypeIndex( m_memoryProperties, i_typeFilter, i_properties ) != UINT32_MAX;
+    }
+
+    /// Return \p i_allocation to its block.  Dedicated blocks are freed immediately.
+    void Free( const MemoryAllocation& i_allocation )
+    {
+        if ( i_allocation.m_memory == VK_NULL_HANDLE )
+        {
+            return;
+        }
+
+        for ( size_t blockIndex = 0; blockIndex < m_blocks.size(); ++blockIndex )
+        {
+            MemoryBlock& block = *m_blocks[ blockIndex ];
+            if ( block.m_memory != i_allocation.m_memory )
+            {
+                continue;
+            }
+
+            m_allocationCount--;
+            if ( block.m_dedicated )
+            {
+                DestroyBlock( block );
+                m_blocks.erase( m_blocks.begin() + blockIndex );
+                return;
+            }
+
+            // Return the range, and coalesce it with its free neighbours.
+            std::map< VkDeviceSize, VkDeviceSize >::iterator rangeIt =
+                block.m_freeRanges.emplace( i_allocation.m_offset, i_allocation.m_size ).first;
+            std::map< VkDeviceSize, VkDeviceSize >::iterator nextIt = std::next( rangeIt );
+            if ( nextIt != block.m_freeRanges.end() && rangeIt->first + rangeIt->second == nextIt->first )
+            {
+                rangeIt->second += nextIt->second;
+                block.m_freeRanges.erase( nextIt );
+            }
+
+            if ( rangeIt != block.m_freeRanges.begin() )
+            {
+                std::map< VkDeviceSize, VkDeviceSize >::iterator prevIt = std::prev( rangeIt );
+                if ( prevIt->first + prevIt->second == rangeIt->first )
+                {
+                    prevIt->second += rangeIt->second;
+                    block.m_freeRanges.erase( rangeIt );
+                }
+            }
+
+            return;
+        }
+
+        throw std::runtime_error( "Freeing memory which was not allocated by this allocator." );
+    }
+
+    /// Free all memory blocks.  Every allocation must have been freed, or be no longer in use.
+    void Teardown()
+    {
+        for ( std::unique_ptr< MemoryBlock >& block : m_blocks )
+        {
+            DestroyBlock( *block );
+        }
+
+        m_blocks.clear();
+        m_allocationCount = 0;
+    }
+
+    /// The number of VkDeviceMemory allocations made by this allocator.
+    size_t GetBlockCount() const
+    {
+        return m_blocks.size();
+    }
+
+    /// The number of live sub-allocations.
+    size_t GetAllocationCount() const
+    {
+        return m_allocationCount;
+    }
+
+private:
+    // A VkDeviceMemory allocation, and its free ranges keyed by offset.
+    struct MemoryBlock
+    {
+        VkDeviceMemory                         m_memory          = VK_NULL_HANDLE;
+        VkDeviceSize                           m_size            = 0;
+        uint32_t                               m_memoryTypeIndex = 0;
+        bool                                   m_dedicated       = false;
+        void*                                  m_mappedData      = nullptr;
+        std::map< VkDeviceSize, VkDeviceSize > m_freeRanges;
+    };
+
+    static VkDeviceSize AlignUp( VkDeviceSize i_value, VkDeviceSize i_alignment )
+    {
+        return ( i_value + i_alignment - 1 ) / i_alignment * i_alignment;
+    }
+
+    MemoryBlock& CreateBlock( uint32_t i_memoryTypeIndex, VkDeviceSize i_size, bool i_dedicated )
+    {
+        std::unique_ptr< MemoryBlock > block( new MemoryBlock() );
+        block->m_size            = i_size;
+        block->m_memoryTypeIndex = i_memoryTypeIndex;
+        block->m_dedicated       = i_dedicated;
+        block->m_freeRanges.emplace( 0, i_size );
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize       = i_size;
+        allocInfo.memoryTypeIndex      = i_memoryTypeIndex;
+        if ( vkAllocateMemory( m_device, &allocInfo, nullptr, &block->m_memory ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to allocate memory block." );
+        }
+
+        if ( m_memoryProperties.memoryTypes[ i_memoryTypeIndex ].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT )
+        {
+            if ( vkMapMemory( m_device, block->m_memory, 0, VK_WHOLE_SIZE, 0, &block->m_mappedData ) != VK_SUCCESS )
+            {
+                vkFreeMemory( m_device, block->m_memory, nullptr );
+                throw std::runtime_error( "Failed to map memory block." );
+            }
+        }
+
+        m_blocks.push_back( std::move( block ) );
+        return *m_blocks.back();
+    }
+
+    void DestroyBlock( MemoryBlock& io_block )
+    {
+        if ( io_block.m_mappedData != nullptr )
+        {
+            vkUnmapMemory( m_device, io_block.m_memory );
+        }
+
+        vkFreeMemory( m_device, io_block.m_memory, nullptr );
+        io_block.m_memory = VK_NULL_HANDLE;
+    }
+
+    // Find the first free range of \p i_block which can hold \p i_size bytes at \p i_alignment.
+    static bool
+    FindFreeRange( const MemoryBlock& i_block, VkDeviceSize i_size, VkDeviceSize i_alignment, VkDeviceSize& o_offset )
+    {
+        for ( const std::pair< const VkDeviceSize, VkDeviceSize >& range : i_block.m_freeRanges )
+        {
+            VkDeviceSize offset = AlignUp( range.first, i_alignment );
+            if ( offset + i_size <= range.first + range.second )
+            {
+                o_offset = offset;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Carve [i_offset, i_offset + i_size) out of the free range containing it.
+    MemoryAllocation SubAllocate( MemoryBlock& io_block, VkDeviceSize i_offset, VkDeviceSize i_size )
+    {
+        std::map< VkDeviceSize, VkDeviceSize >::iterator rangeIt = std::prev( io_block.m_freeRanges.upper_bound( i_offset ) );
+        VkDeviceSize rangeOffset = rangeIt->first;
+        VkDeviceSize rangeEnd    = rangeIt->first + rangeIt->second;
+        io_block.m_freeRanges.erase( rangeIt );
+
+        // Padding introduced by alignment, and the tail of the range, remain free.
+        if ( i_offset > rangeOffset )
+        {
+            io_block.m_freeRanges.emplace( rangeOffset, i_offset - rangeOffset );
+        }
+
+        if ( i_offset + i_size < rangeEnd )
+        {
+            io_block.m_freeRanges.emplace( i_offset + i_size, rangeEnd - ( i_offset + i_size ) );
+        }
+
+        MemoryAllocation allocation;
+        allocation.m_memory          = io_block.m_memory;
+        allocation.m_offset          = i_offset;
+        allocation.m_size            = i_size;
+        allocation.m_memoryTypeIndex = io_block.m_memoryTypeIndex;
+        allocation.m_mappedData =
+            io_block.m_mappedData != nullptr ? static_cast< char* >( io_block.m_mappedData ) + i_offset : nullptr;
+
+        m_allocationCount++;
+        return allocation;
+    }
+
+    VkDevice                         m_device                 = VK_NULL_HANDLE;
+    VkDeviceSize                     m_blockSize              = s_defaultBlockSize;
+    VkDeviceSize                     m_bufferImageGranularity = 1;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties       = {};
+    std::vector< std::unique_ptr< MemoryBlock > > m_blocks;
+    size_t                                        m_allocationCount = 0;
+};
+
+} // namespace vkbase
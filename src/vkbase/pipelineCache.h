@@ -0,0 +1,145 @@
+#pragma once
+
+/// \file vkbase/pipelineCache.h
+///
+/// Persistent pipeline cache, serialized to disk so pipelines are not re-compiled on every run.
+
+namespace vkbase
+{
+/// \struct PipelineCacheHeader
+///
+/// The header found at the beginning of pipeline cache data, as laid out by
+/// VK_PIPELINE_CACHE_HEADER_VERSION_ONE.
+struct PipelineCacheHeader
+{
+    uint32_t m_headerLength;
+    uint32_t m_headerVersion;
+    uint32_t m_vendorID;
+    uint32_t m_deviceID;
+    uint8_t  m_pipelineCacheUUID[ VK_UUID_SIZE ];
+};
+
+static_assert( sizeof( PipelineCacheHeader ) == 16 + VK_UUID_SIZE, "Unexpected pipeline cache header size." );
+
+/// Check if the pipeline cache data \p i_data was produced by the device described by \p i_properties.
+///
+/// Drivers should reject incompatible data themselves, but some do not, so the header is validated
+/// before handing the data over.
+inline bool IsPipelineCacheCompatible( const std::vector< char >& i_data, const VkPhysicalDeviceProperties& i_properties )
+{
+    if ( i_data.size() < sizeof( PipelineCacheHeader ) )
+    {
+        return false;
+    }
+
+    PipelineCacheHeader header;
+    memcpy( &header, i_data.data(), sizeof( PipelineCacheHeader ) );
+
+    return header.m_headerLength >= sizeof( PipelineCacheHeader ) &&
+           header.m_headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.m_vendorID == i_properties.vendorID && header.m_deviceID == i_properties.deviceID &&
+           memcmp( header.m_pipelineCacheUUID, i_properties.pipelineCacheUUID, VK_UUID_SIZE ) == 0;
+}
+
+/// Create a pipeline cache for \p i_device, seeded with the data stored at \p i_filePath.
+///
+/// The stored data is discarded if it is missing, or does not match the vendor, device, and pipeline cache
+/// UUID of \p i_properties, in which case an empty cache is created.
+///
+/// \param i_device the logical device.
+/// \param i_properties the properties of the physical device, used to validate the stored data.
+/// \param i_filePath the path to the stored cache data.  An empty path creates an empty cache.
+/// \param o_loaded set to true if the stored data was used.
+///
+/// \return the pipeline cache.
+inline VkPipelineCache CreatePipelineCache( VkDevice                          i_device,
+                                            const VkPhysicalDeviceProperties& i_properties,
+                                            const std::string&                i_filePath,
+                                            bool&                             o_loaded )
+{
+    std::vector< char > data;
+    if ( !i_filePath.empty() && FileExists( i_filePath ) )
+    {
+        data = ReadFile( i_filePath );
+        if ( !IsPipelineCacheCompatible( data, i_properties ) )
+        {
+            printf( "Discarding incompatible pipeline cache: %s.\n", i_filePath.c_str() );
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo = {};
+    createInfo.sType                     = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize           = data.size();
+    createInfo.pInitialData              = data.empty() ? nullptr : data.data();
+
+    VkPipelineCache pipelineCache;
+    if ( vkCreatePipelineCache( i_device, &createInfo, nullptr, &pipelineCache ) != VK_SUCCESS )
+    {
+        throw std::runtime_error( "Failed to create pipeline cache." );
+    }
+
+    o_loaded = !data.empty();
+    return pipelineCache;
+}
+
+/// Write the contents of \p i_pipelineCache to \p i_filePath, atomically.
+///
+/// \return true if the cache was written.
+inline bool SavePipelineCache( VkDevice i_device, VkPipelineCache i_pipelineCache, const std::string& i_filePath )
+{
+    size_t dataSize = 0;
+    if ( vkGetPipelineCacheData( i_device, i_pipelineCache, &dataSize, nullptr ) != VK_SUCCESS )
+    {
+        return false;
+    }
+
+    std::vector< char > data( dataSize );
+    if ( vkGetPipelineCacheData( i_device, i_pipelineCache, &dataSize, data.data() ) != VK_SUCCESS )
+    {
+        return false;
+    }
+
+    return WriteFileAtomic( i_filePath, data.data(), dataSize );
+}
+
+/// Get the name of the pipeline cache file of the device described by \p i_properties: \p i_prefix, followed by
+/// its vendor and device IDs and pipeline cache UUID, so that each device keeps a cache of its own.
+inline std::string GetPipelineCacheFileName( const std::string&                i_prefix,
+                                             const VkPhysicalDeviceProperties& i_properties )
+{
+    char ids[ 32 ];
+    snprintf( ids, sizeof( ids ), "-%04x-%04x-", i_properties.vendorID, i_properties.deviceID );
+
+    std::string fileName = i_prefix + ids;
+    for ( uint8_t byte : i_properties.pipelineCacheUUID )
+    {
+        char hex[ 3 ];
+        snprintf( hex, sizeof( hex ), "%02x", byte );
+        fileName += hex;
+    }
+
+    return fileName + ".pipelinecache";
+}
+
+/// Get the default location of the pipeline cache file named \p i_fileName, in the user's cache directory.  The
+/// directory may not exist yet; it is created when the cache is first saved.
+///
+/// \return the path, or an empty string if there is no cache directory.
+inline std::string GetDefaultPipelineCachePath( const std::string& i_fileName )
+{
+    const char* cacheHome = getenv( "XDG_CACHE_HOME" );
+    if ( cacheHome != nullptr && cacheHome[ 0 ] != '\0' )
+    {
+        return JoinPaths( cacheHome, i_fileName );
+    }
+
+    if ( const char* home = getenv( "HOME" ) )
+    {
+        return JoinPaths( JoinPaths( home, ".cache" ), i_fileName );
+    }
+
+    return std::string();
+}
+
+} // namespace vkbase
@@ -0,0 +1,177 @@
+#pragma once
+
+/// \file vkbase/pipelinePermutations.h
+///
+/// Variants of a pipeline, compiled in parallel and looked up by their state.
+
+namespace vkbase
+{
+/// \struct PipelineVariant
+///
+/// The state varying between the permutations of a graphics pipeline: primitive topology, face culling,
+/// blending, and the values of specialization constants.
+struct PipelineVariant
+{
+    VkPrimitiveTopology m_topology    = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkCullModeFlags     m_cullMode    = VK_CULL_MODE_BACK_BIT;
+    bool                m_blendEnable = false;
+
+    // Specialization constants, applied to every shader stage: the map entries, and the data they index into.
+    std::vector< VkSpecializationMapEntry > m_specializationEntries;
+    std::vector< uint8_t >                  m_specializationData;
+
+    /// Describe the specialization constants of the variant in \p o_info, which points into the variant.
+    ///
+    /// \return \p o_info, or nullptr if the variant has no specialization constants.
+    const VkSpecializationInfo* GetSpecializationInfo( VkSpecializationInfo& o_info ) const
+    {
+        if ( m_specializationEntries.empty() )
+        {
+            return nullptr;
+        }
+
+        o_info               = {};
+        o_info.mapEntryCount = static_cast< uint32_t >( m_specializationEntries.size() );
+        o_info.pMapEntries   = m_specializationEntries.data();
+        o_info.dataSize      = m_specializationData.size();
+        o_info.pData         = m_specializationData.data();
+        return &o_info;
+    }
+
+    bool operator==( const PipelineVariant& i_other ) const
+    {
+        if ( m_topology != i_other.m_topology || m_cullMode != i_other.m_cullMode ||
+             m_blendEnable != i_other.m_blendEnable || m_specializationData != i_other.m_specializationData ||
+             m_specializationEntries.size() != i_other.m_specializationEntries.size() )
+        {
+            return false;
+        }
+
+        for ( size_t entryIndex = 0; entryIndex < m_specializationEntries.size(); ++entryIndex )
+        {
+            const VkSpecializationMapEntry& entry      = m_specializationEntries[ entryIndex ];
+            const VkSpecializationMapEntry& otherEntry = i_other.m_specializationEntries[ entryIndex ];
+            if ( entry.constantID != otherEntry.constantID || entry.offset != otherEntry.offset ||
+                 entry.size != otherEntry.size )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+/// \struct PipelineVariantHash
+///
+/// Hash of the state of a PipelineVariant, for looking pipelines up by it.
+struct PipelineVariantHash
+{
+    size_t operator()( const PipelineVariant& i_variant ) const
+    {
+        const uint32_t state[] = {static_cast< uint32_t >( i_variant.m_topology ),
+                                  static_cast< uint32_t >( i_variant.m_cullMode ),
+                                  static_cast< uint32_t >( i_variant.m_blendEnable )};
+
+        uint64_t hash = HashBytes( state, sizeof( state ) );
+        for ( const VkSpecializationMapEntry& entry : i_variant.m_specializationEntries )
+        {
+            const uint64_t fields[] = {entry.constantID, entry.offset, entry.size};
+            hash                    = HashBytes( fields, sizeof( fields ), hash );
+        }
+
+        hash = HashBytes( i_variant.m_specializationData.data(), i_variant.m_specializationData.size(), hash );
+        return static_cast< size_t >( hash );
+    }
+};
+
+/// \class PipelinePermutations
+///
+/// Pipelines built for a set of PipelineVariant, and looked up by variant.
+///
+/// Building compiles the pipelines of all variants in parallel, one per job of a JobSystem.  The build function
+/// is expected to create each pipeline against a single VkPipelineCache shared by all threads: pipeline caches
+/// are internally synchronized unless created with VK_PIPELINE_CACHE_CREATE_EXTERNALLY_SYNCHRONIZED_BIT_EXT, so
+/// each thread both benefits from, and contributes to, the same cache.
+class PipelinePermutations
+{
+public:
+    /// Creates the pipeline of a variant.  Called from several threads at once.
+    using BuildFunction = std::function< VkPipeline( const PipelineVariant& ) >;
+
+    /// Build the pipelines of those of \p i_variants not already built, in parallel on \p io_jobSystem.  If any
+    /// pipeline fails to build, those built by this call are destroyed, and the exception rethrown.
+    ///
+    /// \return the number of pipelines built.
+    size_t Build( VkDevice                              i_device,
+                  JobSystem&                            io_jobSystem,
+                  const std::vector< PipelineVariant >& i_variants,
+                  const BuildFunction&                  i_function )
+    {
+        // Skip variants already built, and duplicates.
+        std::vector< const PipelineVariant* >                      variants;
+        std::unordered_set< PipelineVariant, PipelineVariantHash > seen;
+        for ( const PipelineVariant& variant : i_variants )
+        {
+            if ( m_pipelines.find( variant ) == m_pipelines.end() && seen.insert( variant ).second )
+            {
+                variants.push_back( &variant );
+            }
+        }
+
+        // Each job writes only its own element, so the results need no locking.
+        std::vector< VkPipeline > pipelines( variants.size(), VK_NULL_HANDLE );
+        try
+        {
+            io_jobSystem.ParallelFor( variants.size(), [&]( size_t i_jobIndex, size_t ) {
+                pipelines[ i_jobIndex ] = i_function( *variants[ i_jobIndex ] );
+            } );
+        }
+        catch ( ... )
+        {
+            for ( VkPipeline pipeline : pipelines )
+            {
+                vkDestroyPipeline( i_device, pipeline, nullptr );
+            }
+
+            throw;
+        }
+
+        for ( size_t variantIndex = 0; variantIndex < variants.size(); ++variantIndex )
+        {
+            m_pipelines.emplace( *variants[ variantIndex ], pipelines[ variantIndex ] );
+        }
+
+        return variants.size();
+    }
+
+    /// Destroy all pipelines.  No command buffer in flight may be using them.
+    void Teardown( VkDevice i_device )
+    {
+        for ( const std::pair< const PipelineVariant, VkPipeline >& entry : m_pipelines )
+        {
+            vkDestroyPipeline( i_device, entry.second, nullptr );
+        }
+
+        m_pipelines.clear();
+    }
+
+    /// The pipeline built for \p i_variant, or VK_NULL_HANDLE if it was not built.
+    VkPipeline Find( const PipelineVariant& i_variant ) const
+    {
+        std::unordered_map< PipelineVariant, VkPipeline, PipelineVariantHash >::const_iterator pipelineIt =
+            m_pipelines.find( i_variant );
+        return pipelineIt != m_pipelines.end() ? pipelineIt->second : VK_NULL_HANDLE;
+    }
+
+    /// Number of pipelines built.
+    size_t GetCount() const
+    {
+        return m_pipelines.size();
+    }
+
+private:
+    std::unordered_map< PipelineVariant, VkPipeline, PipelineVariantHash > m_pipelines;
+};
+
+} // namespace vkbase
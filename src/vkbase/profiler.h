@@ -0,0 +1,318 @@
+#pragma once
+
+/// \file vkbase/profiler.h
+///
+/// Lightweight frame profiling: scoped CPU timers and GPU timestamp samples are pushed into a lock-free ring
+/// buffer, then drained into percentile summaries and Chrome trace (chrome://tracing) JSON.
+
+namespace vkbase
+{
+/// Get the current time of the steady clock, in nanoseconds.
+inline uint64_t GetTimeNanoseconds()
+{
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(
+               std::chrono::steady_clock::now().time_since_epoch() )
+        .count();
+}
+
+/// \struct ProfileSample
+///
+/// A single timed interval of a profiled phase.
+struct ProfileSample
+{
+    uint32_t m_phase       = 0; // Index of the phase, as registered with the Profiler.
+    uint64_t m_frameNumber = 0; // The frame this sample belongs to.
+    uint64_t m_startTime   = 0; // Start of the interval, in nanoseconds on the steady clock.
+    uint64_t m_duration    = 0; // Duration of the interval, in nanoseconds.
+};
+
+/// \class ProfileSampleRing
+///
+/// Fixed capacity, lock-free, single-producer single-consumer ring buffer of ProfileSample(s).
+///
+/// The producer never blocks: samples pushed while the ring is full are dropped, and counted.
+class ProfileSampleRing
+{
+public:
+    /// Construct a ring holding up to \p i_capacity samples, which must be a power of two.
+    explicit ProfileSampleRing( size_t i_capacity )
+        : m_samples( i_capacity )
+        , m_mask( i_capacity - 1 )
+    {
+        if ( i_capacity == 0 || ( i_capacity & m_mask ) != 0 )
+        {
+            throw std::runtime_error( "Profile sample ring capacity must be a power of two." );
+        }
+    }
+
+    /// Push \p i_sample into the ring.  Only to be called from the producer thread.
+    ///
+    /// \return false if the ring was full, and the sample was dropped.
+    bool Push( const ProfileSample& i_sample )
+    {
+        const uint64_t writeIndex = m_writeIndex.load( std::memory_order_relaxed );
+        if ( writeIndex - m_readIndex.load( std::memory_order_acquire ) >= m_samples.size() )
+        {
+            m_droppedCount.fetch_add( 1, std::memory_order_relaxed );
+            return false;
+        }
+
+        m_samples[ writeIndex & m_mask ] = i_sample;
+        m_writeIndex.store( writeIndex + 1, std::memory_order_release );
+        return true;
+    }
+
+    /// Pop the oldest sample into \p o_sample.  Only to be called from the consumer thread.
+    ///
+    /// \return false if the ring was empty.
+    bool Pop( ProfileSample& o_sample )
+    {
+        const uint64_t readIndex = m_readIndex.load( std::memory_order_relaxed );
+        if ( readIndex == m_writeIndex.load( std::memory_order_acquire ) )
+        {
+            return false;
+        }
+
+        o_sample = m_samples[ readIndex & m_mask ];
+        m_readIndex.store( readIndex + 1, std::memory_order_release );
+        return true;
+    }
+
+    /// The number of samples dropped because the ring was full.
+    uint64_t GetDroppedCount() const
+    {
+        return m_droppedCount.load( std::memory_order_relaxed );
+    }
+
+private:
+    std::vector< ProfileSample > m_samples;
+    uint64_t                     m_mask;
+    std::atomic< uint64_t >      m_writeIndex{0};
+    std::atomic< uint64_t >      m_readIndex{0};
+    std::atomic< uint64_t >      m_droppedCount{0};
+};
+
+/// Compute the \p i_percentile (between 0 and 100) of \p io_values, by nearest rank.  The values are
+/// partially reordered.
+inline uint64_t ComputePercentile( std::vector< uint64_t >& io_values, double i_percentile )
+{
+    if ( io_values.empty() )
+    {
+        return 0;
+    }
+
+    size_t rank = static_cast< size_t >( std::ceil( i_percentile / 100.0 * io_values.size() ) );
+    rank        = std::min( std::max( rank, size_t( 1 ) ), io_values.size() ) - 1;
+    std::nth_element( io_values.begin(), io_values.begin() + rank, io_values.end() );
+    return io_values[ rank ];
+}
+
+/// \class Profiler
+///
+/// Collects samples of named phases.  Recording (on the render thread) only pushes into the sample ring;
+/// Drain moves the samples into the summary and trace storage, and may be called from another thread.
+class Profiler
+{
+public:
+    /// Construct a profiler for the phases named \p i_phaseNames.  Samples refer to phases by their index
+    /// in this list.
+    ///
+    /// \param i_phaseNames display names of the phases.
+    /// \param i_keepTrace if true, samples are retained for WriteChromeTrace.
+    explicit Profiler( const std::vector< std::string >& i_phaseNames, bool i_keepTrace = false )
+        : m_phaseNames( i_phaseNames )
+        , m_phaseWindows( i_phaseNames.size() )
+        , m_keepTrace( i_keepTrace )
+    {
+    }
+
+    /// Enable, or disable, retaining samples for WriteChromeTrace.
+    void SetKeepTrace( bool i_keepTrace )
+    {
+        m_keepTrace = i_keepTrace;
+    }
+
+    /// Record a sample of \p i_phase, for frame \p i_frameNumber.
+    void Record( uint32_t i_phase, uint64_t i_frameNumber, uint64_t i_startTime, uint64_t i_duration )
+    {
+        ProfileSample sample;
+        sample.m_phase       = i_phase;
+        sample.m_frameNumber = i_frameNumber;
+        sample.m_startTime   = i_startTime;
+        sample.m_duration    = i_duration;
+        m_ring.Push( sample );
+    }
+
+    /// Move all recorded samples out of the ring buffer, into the summary (and trace) storage.
+    void Drain()
+    {
+        ProfileSample sample;
+        while ( m_ring.Pop( sample ) )
+        {
+            if ( sample.m_phase >= m_phaseWindows.size() )
+            {
+                continue;
+            }
+
+            m_phaseWindows[ sample.m_phase ].Add( sample.m_duration );
+            if ( m_keepTrace && m_trace.size() < s_maxTraceSamples )
+            {
+                m_trace.push_back( sample );
+            }
+        }
+    }
+
+    /// Print the p50, p95 and p99 durations of each phase, for the samples drained since the previous
+    /// summary.  The percentiles are taken over the most recent s_summaryWindowSize samples of each phase;
+    /// the sample count and maximum cover all of them.  The summary samples are then cleared.
+    void PrintSummary()
+    {
+        Drain();
+
+        printf( "%-20s %8s %10s %10s %10s %10s\n", "Phase", "Samples", "p50 (ms)", "p95 (ms)", "p99 (ms)", "max (ms)" );
+        for ( size_t phaseIndex = 0; phaseIndex < m_phaseNames.size(); ++phaseIndex )
+        {
+            PhaseWindow& window = m_phaseWindows[ phaseIndex ];
+            if ( window.m_count == 0 )
+            {
+                continue;
+            }
+
+            uint64_t p50 = ComputePercentile( window.m_durations, 50.0 );
+            uint64_t p95 = ComputePercentile( window.m_durations, 95.0 );
+            uint64_t p99 = ComputePercentile( window.m_durations, 99.0 );
+            printf( "%-20s %8llu %10.3f %10.3f %10.3f %10.3f\n",
+                    m_phaseNames[ phaseIndex ].c_str(),
+                    static_cast< unsigned long long >( window.m_count ),
+                    p50 * 1e-6,
+                    p95 * 1e-6,
+                    p99 * 1e-6,
+                    window.m_max * 1e-6 );
+            window.Clear();
+        }
+
+        if ( m_ring.GetDroppedCount() > 0 )
+        {
+            printf( "Dropped %llu profile samples.\n", static_cast< unsigned long long >( m_ring.GetDroppedCount() ) );
+        }
+    }
+
+    /// Write the retained samples to \p i_filePath, in the Chrome trace event JSON format.  Each phase is
+    /// drawn on its own track.
+    ///
+    /// \return true if the file was written.
+    bool WriteChromeTrace( const std::string& i_filePath )
+    {
+        Drain();
+
+        std::ofstream file( i_filePath );
+        if ( !file.is_open() )
+        {
+            return false;
+        }
+
+        uint64_t epoch = m_trace.empty() ? 0 : m_trace.front().m_startTime;
+        for ( const ProfileSample& sample : m_trace )
+        {
+            epoch = std::min( epoch, sample.m_startTime );
+        }
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        for ( size_t phaseIndex = 0; phaseIndex < m_phaseNames.size(); ++phaseIndex )
+        {
+            file << ( phaseIndex == 0 ? "" : "," ) << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                 << phaseIndex << ",\"args\":{\"name\":\"" << m_phaseNames[ phaseIndex ] << "\"}}";
+        }
+
+        char buffer[ 64 ];
+        for ( const ProfileSample& sample : m_trace )
+        {
+            file << ",{\"name\":\"" << m_phaseNames[ sample.m_phase ] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                 << sample.m_phase;
+            snprintf( buffer, sizeof( buffer ), "%.3f", ( sample.m_startTime - epoch ) * 1e-3 );
+            file << ",\"ts\":" << buffer;
+            snprintf( buffer, sizeof( buffer ), "%.3f", sample.m_duration * 1e-3 );
+            file << ",\"dur\":" << buffer << ",\"args\":{\"frame\":" << sample.m_frameNumber << "}}";
+        }
+
+        file << "]}\n";
+        return file.good();
+    }
+
+private:
+    // Upper bound of samples retained for the trace, to bound memory use of long runs.
+    static constexpr size_t s_maxTraceSamples = 1 << 20;
+
+    // Upper bound of durations retained per phase for the percentiles, between summaries.
+    static constexpr size_t s_summaryWindowSize = 8192;
+
+    // The durations of a phase since the last summary: a bounded window of samples for the percentiles,
+    // and the streaming count and maximum of all of them.
+    struct PhaseWindow
+    {
+        void Add( uint64_t i_duration )
+        {
+            if ( m_durations.size() < s_summaryWindowSize )
+            {
+                m_durations.push_back( i_duration );
+            }
+            else
+            {
+                // Percentiles reorder the window, but it is cleared right after, so any slot holds a sample
+                // of the current window.
+                m_durations[ m_count % s_summaryWindowSize ] = i_duration;
+            }
+
+            m_count += 1;
+            m_max = std::max( m_max, i_duration );
+        }
+
+        void Clear()
+        {
+            m_durations.clear();
+            m_count = 0;
+            m_max   = 0;
+        }
+
+        std::vector< uint64_t > m_durations;
+        uint64_t                m_count = 0;
+        uint64_t                m_max   = 0;
+    };
+
+    std::vector< std::string >   m_phaseNames;
+    ProfileSampleRing            m_ring{4096};
+    std::vector< PhaseWindow >   m_phaseWindows; // Per-phase durations since the last summary.
+    bool                         m_keepTrace = false;
+    std::vector< ProfileSample > m_trace;
+};
+
+/// \class ScopedTimer
+///
+/// Records the duration of its own lifetime as a sample of a Profiler phase.
+class ScopedTimer
+{
+public:
+    ScopedTimer( Profiler& i_profiler, uint32_t i_phase, uint64_t i_frameNumber )
+        : m_profiler( i_profiler )
+        , m_phase( i_phase )
+        , m_frameNumber( i_frameNumber )
+        , m_startTime( GetTimeNanoseconds() )
+    {
+    }
+
+    ~ScopedTimer()
+    {
+        m_profiler.Record( m_phase, m_frameNumber, m_startTime, GetTimeNanoseconds() - m_startTime );
+    }
+
+    ScopedTimer( const ScopedTimer& ) = delete;
+    ScopedTimer& operator=( const ScopedTimer& ) = delete;
+
+private:
+    Profiler& m_profiler;
+    uint32_t  m_phase;
+    uint64_t  m_frameNumber;
+    uint64_t  m_startTime;
+};
+
+} // namespace vkbase
@@ -0,0 +1,221 @@
+#pragma once
+
+/// \file vkbase/queue.h
+///
+/// Device queues, the submissions made to them, and the barriers which transfer ownership of buffers and images
+/// between queue families.
+
+namespace vkbase
+{
+/// \class Submission
+///
+/// The command buffers of a submission to a Queue, and the semaphores it waits on and signals.  Holds a small,
+/// fixed number of each, so building a submission every frame does not allocate.
+///
+/// Timeline semaphores are waited on and signaled with a value; the value of a binary semaphore is ignored.
+class Submission
+{
+public:
+    /// Upper bound of the command buffers, wait semaphores, and signal semaphores of a submission.
+    static constexpr uint32_t s_maxCount = 4;
+
+    /// Execute \p i_commandBuffer, after the command buffers added before it.
+    void AddCommandBuffer( VkCommandBuffer i_commandBuffer )
+    {
+        Append( m_commandBuffers, m_commandBufferCount, i_commandBuffer );
+    }
+
+    /// Wait for \p i_semaphore to be signaled, or to reach \p i_value if it is a timeline semaphore, before
+    /// executing \p i_stages of the command buffers.
+    void Wait( VkSemaphore i_semaphore, VkPipelineStageFlags i_stages, uint64_t i_value = 0 )
+    {
+        // Append checks the capacity, so the parallel arrays are written after it.
+        Append( m_waitSemaphores, m_waitSemaphoreCount, i_semaphore );
+        m_waitStages[ m_waitSemaphoreCount - 1 ] = i_stages;
+        m_waitValues[ m_waitSemaphoreCount - 1 ] = i_value;
+        m_hasTimelineValues |= i_value != 0;
+    }
+
+    /// Signal \p i_semaphore, or set it to \p i_value if it is a timeline semaphore, once the command buffers
+    /// have completed.
+    void Signal( VkSemaphore i_semaphore, uint64_t i_value = 0 )
+    {
+        Append( m_signalSemaphores, m_signalSemaphoreCount, i_semaphore );
+        m_signalValues[ m_signalSemaphoreCount - 1 ] = i_value;
+        m_hasTimelineValues |= i_value != 0;
+    }
+
+    /// The submit info describing this submission.  If any timeline semaphore values were given, they are
+    /// described by \p o_timelineInfo, chained to the submit info.  Both point into this object, so must not
+    /// outlive it.
+    VkSubmitInfo GetSubmitInfo( VkTimelineSemaphoreSubmitInfoKHR& o_timelineInfo ) const
+    {
+        VkSubmitInfo submitInfo         = {};
+        submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount   = m_waitSemaphoreCount;
+        submitInfo.pWaitSemaphores      = m_waitSemaphores.data();
+        submitInfo.pWaitDstStageMask    = m_waitStages.data();
+        submitInfo.commandBufferCount   = m_commandBufferCount;
+        submitInfo.pCommandBuffers      = m_commandBuffers.data();
+        submitInfo.signalSemaphoreCount = m_signalSemaphoreCount;
+        submitInfo.pSignalSemaphores    = m_signalSemaphores.data();
+
+        if ( m_hasTimelineValues )
+        {
+            o_timelineInfo                           = {};
+            o_timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+            o_timelineInfo.waitSemaphoreValueCount   = m_waitSemaphoreCount;
+            o_timelineInfo.pWaitSemaphoreValues      = m_waitValues.data();
+            o_timelineInfo.signalSemaphoreValueCount = m_signalSemaphoreCount;
+            o_timelineInfo.pSignalSemaphoreValues    = m_signalValues.data();
+            submitInfo.pNext                         = &o_timelineInfo;
+        }
+
+        return submitInfo;
+    }
+
+private:
+    template < typename ValueT >
+    static void Append( std::array< ValueT, s_maxCount >& io_values, uint32_t& io_count, ValueT i_value )
+    {
+        if ( io_count == s_maxCount )
+        {
+            throw std::runtime_error( "Too many command buffers or semaphores in submission." );
+        }
+
+        io_values[ io_count++ ] = i_value;
+    }
+
+    std::array< VkCommandBuffer, s_maxCount >      m_commandBuffers       = {};
+    std::array< VkSemaphore, s_maxCount >          m_waitSemaphores       = {};
+    std::array< VkPipelineStageFlags, s_maxCount > m_waitStages           = {};
+    std::array< VkSemaphore, s_maxCount >          m_signalSemaphores     = {};
+    std::array< uint64_t, s_maxCount >             m_waitValues           = {};
+    std::array< uint64_t, s_maxCount >             m_signalValues         = {};
+    uint32_t                                       m_commandBufferCount   = 0;
+    uint32_t                                       m_waitSemaphoreCount   = 0;
+    uint32_t                                       m_signalSemaphoreCount = 0;
+    bool                                           m_hasTimelineValues    = false;
+};
+
+/// \class Queue
+///
+/// A device queue, and the index of the queue family it belongs to.
+///
+/// Several Queue objects may refer to the same VkQueue, when a device has no dedicated queue family for a kind of
+/// work.  Resources shared between queues of different families need their ownership transferred, see
+/// MakeBufferOwnershipTransfer and MakeImageOwnershipTransfer.
+class Queue
+{
+public:
+    /// Get the \p i_queueIndex'th queue of family \p i_familyIndex, from \p i_device.
+    void Init( VkDevice i_device, uint32_t i_familyIndex, uint32_t i_queueIndex = 0 )
+    {
+        m_familyIndex = i_familyIndex;
+        vkGetDeviceQueue( i_device, i_familyIndex, i_queueIndex, &m_queue );
+    }
+
+    /// The queue.
+    VkQueue Get() const
+    {
+        return m_queue;
+    }
+
+    /// The index of the queue family of the queue.
+    uint32_t GetFamilyIndex() const
+    {
+        return m_familyIndex;
+    }
+
+    /// Does \p i_other belong to a different queue family, so resources need their ownership transferred to it?
+    bool IsOtherFamily( const Queue& i_other ) const
+    {
+        return m_familyIndex != i_other.m_familyIndex;
+    }
+
+    /// Submit \p i_submission, signaling \p i_fence once it has completed.
+    VkResult Submit( const Submission& i_submission, VkFence i_fence = VK_NULL_HANDLE ) const
+    {
+        VkTimelineSemaphoreSubmitInfoKHR timelineInfo;
+        VkSubmitInfo                     submitInfo = i_submission.GetSubmitInfo( timelineInfo );
+        return vkQueueSubmit( m_queue, 1, &submitInfo, i_fence );
+    }
+
+    /// Wait for all submissions to the queue to complete.
+    void WaitIdle() const
+    {
+        vkQueueWaitIdle( m_queue );
+    }
+
+private:
+    VkQueue  m_queue       = VK_NULL_HANDLE;
+    uint32_t m_familyIndex = VK_QUEUE_FAMILY_IGNORED;
+};
+
+/// Make the release, and acquire, barriers transferring ownership of a range of \p i_buffer from the queue family
+/// of \p i_srcQueue to that of \p i_dstQueue.
+///
+/// The release barrier is recorded on \p i_srcQueue after \p i_srcAccess writes, and the acquire barrier on
+/// \p i_dstQueue before \p i_dstAccess reads, in a submission waiting on a semaphore signaled after the release.
+/// If both queues belong to the same family, the barriers are plain memory barriers; the release barrier then
+/// provides the whole dependency, and the acquire barrier has no access to make visible.
+inline void MakeBufferOwnershipTransfer( VkBuffer               i_buffer,
+                                         VkDeviceSize           i_offset,
+                                         VkDeviceSize           i_size,
+                                         const Queue&           i_srcQueue,
+                                         VkAccessFlags          i_srcAccess,
+                                         const Queue&           i_dstQueue,
+                                         VkAccessFlags          i_dstAccess,
+                                         VkBufferMemoryBarrier& o_release,
+                                         VkBufferMemoryBarrier& o_acquire )
+{
+    const bool transfer = i_srcQueue.IsOtherFamily( i_dstQueue );
+
+    o_release                     = {};
+    o_release.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    o_release.srcAccessMask       = i_srcAccess;
+    o_release.dstAccessMask       = transfer ? 0 : i_dstAccess;
+    o_release.srcQueueFamilyIndex = transfer ? i_srcQueue.GetFamilyIndex() : VK_QUEUE_FAMILY_IGNORED;
+    o_release.dstQueueFamilyIndex = transfer ? i_dstQueue.GetFamilyIndex() : VK_QUEUE_FAMILY_IGNORED;
+    o_release.buffer              = i_buffer;
+    o_release.offset              = i_offset;
+    o_release.size                = i_size;
+
+    o_acquire               = o_release;
+    o_acquire.srcAccessMask = 0;
+    o_acquire.dstAccessMask = transfer ? i_dstAccess : 0;
+}
+
+/// Make the release, and acquire, barriers transferring ownership of \p i_range of \p i_image, in \p i_layout,
+/// from the queue family of \p i_srcQueue to that of \p i_dstQueue.  The layout is kept across the transfer.
+///
+/// The barriers are recorded as those of MakeBufferOwnershipTransfer.
+inline void MakeImageOwnershipTransfer( VkImage                        i_image,
+                                        const VkImageSubresourceRange& i_range,
+                                        VkImageLayout                  i_layout,
+                                        const Queue&                   i_srcQueue,
+                                        VkAccessFlags                  i_srcAccess,
+                                        const Queue&                   i_dstQueue,
+                                        VkAccessFlags                  i_dstAccess,
+                                        VkImageMemoryBarrier&          o_release,
+                                        VkImageMemoryBarrier&          o_acquire )
+{
+    const bool transfer = i_srcQueue.IsOtherFamily( i_dstQueue );
+
+    o_release                     = {};
+    o_release.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    o_release.srcAccessMask       = i_srcAccess;
+    o_release.dstAccessMask       = transfer ? 0 : i_dstAccess;
+    o_release.oldLayout           = i_layout;
+    o_release.newLayout           = i_layout;
+    o_release.srcQueueFamilyIndex = transfer ? i_srcQueue.GetFamilyIndex() : VK_QUEUE_FAMILY_IGNORED;
+    o_release.dstQueueFamilyIndex = transfer ? i_dstQueue.GetFamilyIndex() : VK_QUEUE_FAMILY_IGNORED;
+    o_release.image               = i_image;
+    o_release.subresourceRange    = i_range;
+
+    o_acquire               = o_release;
+    o_acquire.srcAccessMask = 0;
+    o_acquire.dstAccessMask = transfer ? i_dstAccess : 0;
+}
+
+} // namespace vkbase
@@ -0,0 +1,263 @@
+#pragma once
+
+/// \file vkbase/shaderRegistry.h
+///
+/// Memory mapped SPIR-V files, and a registry creating each shader module once for the lifetime of the device.
+
+namespace vkbase
+{
+/// Magic number found in the first word of a SPIR-V module.
+static constexpr uint32_t s_spirvMagicNumber = 0x07230203;
+
+/// \class MappedFile
+///
+/// A file mapped read-only into memory, for the lifetime of the object.  The pages are read by the kernel on
+/// first access, so no copy of the file is made in user memory.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator=( const MappedFile& ) = delete;
+
+    ~MappedFile()
+    {
+        Unmap();
+    }
+
+    /// Map the whole file at \p i_filePath.
+    void Map( const std::string& i_filePath )
+    {
+        Unmap();
+
+        int fileDescriptor = open( i_filePath.c_str(), O_RDONLY );
+        if ( fileDescriptor < 0 )
+        {
+            throw std::runtime_error( "Failed to open file: " + i_filePath );
+        }
+
+        struct stat fileStatus;
+        if ( fstat( fileDescriptor, &fileStatus ) != 0 )
+        {
+            close( fileDescriptor );
+            throw std::runtime_error( "Failed to query file size: " + i_filePath );
+        }
+
+        // An empty file cannot be mapped, and is left for the caller to reject.
+        m_size = static_cast< size_t >( fileStatus.st_size );
+        if ( m_size > 0 )
+        {
+            m_data = mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0 );
+        }
+
+        // The mapping holds its own reference to the file.
+        close( fileDescriptor );
+
+        if ( m_data == MAP_FAILED )
+        {
+            m_data = nullptr;
+            m_size = 0;
+            throw std::runtime_error( "Failed to map file: " + i_filePath );
+        }
+    }
+
+    /// Unmap the file, if mapped.
+    void Unmap()
+    {
+        if ( m_data != nullptr )
+        {
+            munmap( m_data, m_size );
+        }
+
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    /// Start of the mapped file, aligned to a page.
+    const void* GetData() const
+    {
+        return m_data;
+    }
+
+    /// Size of the mapped file, in bytes.
+    size_t GetSize() const
+    {
+        return m_size;
+    }
+
+private:
+    void*  m_data = nullptr;
+    size_t m_size = 0;
+};
+
+/// Check that \p i_size bytes at \p i_code are plausibly a SPIR-V module: a whole number of 4-byte aligned words,
+/// starting with the SPIR-V magic number.  Throws naming \p i_name otherwise.
+inline void ValidateSpirv( const void* i_code, size_t i_size, const std::string& i_name )
+{
+    if ( i_size < sizeof( uint32_t ) || i_size % sizeof( uint32_t ) != 0 )
+    {
+        throw std::runtime_error( "SPIR-V size is not a multiple of 4 bytes: " + i_name );
+    }
+
+    if ( reinterpret_cast< uintptr_t >( i_code ) % alignof( uint32_t ) != 0 )
+    {
+        throw std::runtime_error( "SPIR-V code is not 4-byte aligned: " + i_name );
+    }
+
+    if ( *static_cast< const uint32_t* >( i_code ) != s_spirvMagicNumber )
+    {
+        throw std::runtime_error( "Missing SPIR-V magic number: " + i_name );
+    }
+}
+
+/// 64-bit FNV-1a hash of the \p i_size bytes at \p i_data.  Pass the hash of preceding data as \p i_hash to hash
+/// several ranges as one.
+inline uint64_t HashBytes( const void* i_data, size_t i_size, uint64_t i_hash = 0xcbf29ce484222325ull )
+{
+    const uint8_t* bytes = static_cast< const uint8_t* >( i_data );
+    uint64_t       hash  = i_hash;
+    for ( size_t byteIndex = 0; byteIndex < i_size; ++byteIndex )
+    {
+        hash = ( hash ^ bytes[ byteIndex ] ) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+/// \class ShaderRegistry
+///
+/// Shader modules created from SPIR-V files, or from SPIR-V embedded into the executable, cached for the lifetime
+/// of the device.
+///
+/// The first request for a path maps the file, validates it, and hands the mapped words straight to
+/// vkCreateShaderModule; later requests for the path, such as when pipelines are rebuilt on resize, return the
+/// cached module without touching the filesystem.  Shaders with identical contents share one module, looked up by
+/// the hash of their contents, and confirmed by comparing them with the code the module was created from.
+class ShaderRegistry
+{
+public:
+    /// Prepare to create shader modules on \p i_device.
+    void Init( VkDevice i_device )
+    {
+        m_device = i_device;
+    }
+
+    /// Destroy all shader modules.  No pipeline may be in the process of being created from them.
+    void Teardown()
+    {
+        for ( const Module& module : m_modules )
+        {
+            vkDestroyShaderModule( m_device, module.m_module, nullptr );
+        }
+
+        m_modules.clear();
+        m_modulesByHash.clear();
+        m_modulesByPath.clear();
+    }
+
+    /// Get the shader module of the SPIR-V file at \p i_filePath, creating it on first request.  The module is
+    /// owned by the registry, and must not be destroyed by the caller.
+    VkShaderModule GetShaderModule( const std::string& i_filePath )
+    {
+        std::unordered_map< std::string, size_t >::const_iterator pathIt = m_modulesByPath.find( i_filePath );
+        if ( pathIt != m_modulesByPath.end() )
+        {
+            ++m_cacheHitCount;
+            return m_modules[ pathIt->second ].m_module;
+        }
+
+        // The driver copies the code, so the file is unmapped as soon as the module is created.
+        MappedFile file;
+        file.Map( i_filePath );
+        ++m_fileLoadCount;
+        return CreateShaderModule( i_filePath, file.GetData(), file.GetSize() );
+    }
+
+    /// Get the shader module of the \p i_size bytes of SPIR-V at \p i_code, named \p i_name, creating it on first
+    /// request for the name.  Used for shaders embedded into the executable, which are never read from a file.
+    VkShaderModule GetShaderModule( const std::string& i_name, const uint32_t* i_code, size_t i_size )
+    {
+        std::unordered_map< std::string, size_t >::const_iterator pathIt = m_modulesByPath.find( i_name );
+        if ( pathIt != m_modulesByPath.end() )
+        {
+            ++m_cacheHitCount;
+            return m_modules[ pathIt->second ].m_module;
+        }
+
+        return CreateShaderModule( i_name, i_code, i_size );
+    }
+
+    /// Number of files mapped, one per distinct path requested.
+    size_t GetFileLoadCount() const
+    {
+        return m_fileLoadCount;
+    }
+
+    /// Number of requests served from the cache, without touching the filesystem.
+    size_t GetCacheHitCount() const
+    {
+        return m_cacheHitCount;
+    }
+
+    /// Number of distinct shader modules created.
+    size_t GetModuleCount() const
+    {
+        return m_modules.size();
+    }
+
+private:
+    // A shader module, and a copy of the code it was created from, to tell apart contents with colliding hashes.
+    struct Module
+    {
+        std::vector< uint8_t > m_code;
+        VkShaderModule         m_module = VK_NULL_HANDLE;
+    };
+
+    // Validate the code, and create its module unless one of identical contents exists, recording it under
+    // i_name.
+    VkShaderModule CreateShaderModule( const std::string& i_name, const void* i_code, size_t i_size )
+    {
+        ValidateSpirv( i_code, i_size, i_name );
+
+        // A matching hash only nominates a module; its code must be identical to be shared.
+        uint64_t hash = HashBytes( i_code, i_size );
+        using HashIterator = std::unordered_multimap< uint64_t, size_t >::const_iterator;
+        std::pair< HashIterator, HashIterator > candidates = m_modulesByHash.equal_range( hash );
+        for ( HashIterator candidateIt = candidates.first; candidateIt != candidates.second; ++candidateIt )
+        {
+            const Module& module = m_modules[ candidateIt->second ];
+            if ( module.m_code.size() == i_size && memcmp( module.m_code.data(), i_code, i_size ) == 0 )
+            {
+                m_modulesByPath[ i_name ] = candidateIt->second;
+                return module.m_module;
+            }
+        }
+
+        VkShaderModuleCreateInfo createInfo = {};
+        createInfo.sType                    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize                 = i_size; // Num bytes.
+        createInfo.pCode                    = static_cast< const uint32_t* >( i_code );
+
+        VkShaderModule shaderModule;
+        if ( vkCreateShaderModule( m_device, &createInfo, nullptr, &shaderModule ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create shader module: " + i_name );
+        }
+
+        const uint8_t* bytes = static_cast< const uint8_t* >( i_code );
+        m_modules.push_back( {std::vector< uint8_t >( bytes, bytes + i_size ), shaderModule} );
+        m_modulesByHash.emplace( hash, m_modules.size() - 1 );
+        m_modulesByPath[ i_name ] = m_modules.size() - 1;
+        return shaderModule;
+    }
+
+    VkDevice                                    m_device = VK_NULL_HANDLE;
+    std::vector< Module >                       m_modules;       // Each distinct content, and its module.
+    std::unordered_multimap< uint64_t, size_t > m_modulesByHash; // Index into m_modules, by content hash.
+    std::unordered_map< std::string, size_t >   m_modulesByPath; // Index into m_modules of each path, or name.
+    size_t                                      m_fileLoadCount = 0;
+    size_t                                      m_cacheHitCount = 0;
+};
+
+} // namespace vkbase
@@ -0,0 +1,223 @@
+#pragma once
+
+/// \file vkbase/shaderWatcher.h
+///
+/// Watching GLSL sources for changes, and recompiling them to SPIR-V on a background thread.
+
+namespace vkbase
+{
+/// \struct WatchedShader
+///
+/// A GLSL source file watched by a ShaderWatcher, and the file name of the SPIR-V it compiles to.
+struct WatchedShader
+{
+    std::string m_sourcePath;
+    std::string m_name; // File name of the compiled shader, such as "shader.vert.spv".
+};
+
+/// \struct CompiledShader
+///
+/// SPIR-V recompiled by a ShaderWatcher, after its source changed.
+struct CompiledShader
+{
+    std::string m_name; // File name of the compiled shader, as watched.
+    std::string m_path; // Path to the compiled SPIR-V.
+};
+
+/// \class ShaderWatcher
+///
+/// Polls the modification time of GLSL source files on a background thread, and recompiles the ones which
+/// changed with an external compiler, such as glslc.  The shaders compiled in one poll are handed to a callback,
+/// on the background thread, so the caller can build pipelines from them without stalling its own thread.
+///
+/// Each compile writes to a path of its own, so the SPIR-V of an earlier compile is never overwritten while in
+/// use.  A source which fails to compile is reported by the compiler, and skipped until it changes again.
+class ShaderWatcher
+{
+public:
+    /// Called with the shaders compiled in one poll.  Their files are removed once it returns.
+    using CompileFunction = std::function< void( const std::vector< CompiledShader >& ) >;
+
+    ShaderWatcher() = default;
+
+    ShaderWatcher( const ShaderWatcher& ) = delete;
+    ShaderWatcher& operator=( const ShaderWatcher& ) = delete;
+
+    ~ShaderWatcher()
+    {
+        Stop();
+    }
+
+    /// Start watching \p i_shaders.  Their current modification times are the baseline, so nothing is compiled
+    /// until a source changes.
+    ///
+    /// \param i_compilerPath the GLSL compiler, invoked as `<compiler> -o <output> <source>`.
+    /// \param i_outputDirectory directory the SPIR-V is compiled into.
+    /// \param i_pollInterval time between polls of the sources.
+    /// \param i_function called with the shaders compiled in each poll which compiled any.
+    void Start( const std::string&                  i_compilerPath,
+                const std::string&                  i_outputDirectory,
+                const std::vector< WatchedShader >& i_shaders,
+                std::chrono::milliseconds           i_pollInterval,
+                CompileFunction                     i_function )
+    {
+        Stop();
+
+        m_compilerPath    = i_compilerPath;
+        m_outputDirectory = i_outputDirectory;
+        m_pollInterval    = i_pollInterval;
+        m_function        = std::move( i_function );
+        m_sources.clear();
+        for ( const WatchedShader& shader : i_shaders )
+        {
+            Source source;
+            source.m_shader = shader;
+            GetModifiedTime( shader.m_sourcePath, source.m_modifiedTime, source.m_size );
+            m_sources.push_back( source );
+        }
+
+        m_exit   = false;
+        m_thread = std::thread( &ShaderWatcher::WatchLoop, this );
+    }
+
+    /// Stop watching, waiting for a compile, or callback, in progress to finish.
+    void Stop()
+    {
+        if ( !m_thread.joinable() )
+        {
+            return;
+        }
+
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_exit = true;
+        }
+
+        m_wakeCondition.notify_all();
+        m_thread.join();
+    }
+
+    /// Number of compiles which succeeded, and failed.
+    void GetCompileCounts( uint64_t& o_succeeded, uint64_t& o_failed ) const
+    {
+        o_succeeded = m_succeededCount.load();
+        o_failed    = m_failedCount.load();
+    }
+
+private:
+    // A watched source, and its modification time and size when last compiled, or when watching started.
+    struct Source
+    {
+        WatchedShader m_shader;
+        int64_t       m_modifiedTime = -1;
+        int64_t       m_size         = -1;
+    };
+
+    // Get the modification time of the file at i_filePath, in nanoseconds, and its size.  The size tells apart
+    // saves within the timestamp granularity of filesystems which do not record nanoseconds.  Both are -1 if the
+    // file does not exist.
+    static void GetModifiedTime( const std::string& i_filePath, int64_t& o_modifiedTime, int64_t& o_size )
+    {
+        struct stat fileStatus;
+        if ( stat( i_filePath.c_str(), &fileStatus ) != 0 )
+        {
+            o_modifiedTime = -1;
+            o_size         = -1;
+            return;
+        }
+
+        o_modifiedTime = static_cast< int64_t >( fileStatus.st_mtim.tv_sec ) * 1000000000 +
+                         static_cast< int64_t >( fileStatus.st_mtim.tv_nsec );
+        o_size         = static_cast< int64_t >( fileStatus.st_size );
+    }
+
+    void WatchLoop()
+    {
+        std::unique_lock< std::mutex > lock( m_mutex );
+        while ( !m_wakeCondition.wait_for( lock, m_pollInterval, [this]() { return m_exit; } ) )
+        {
+            lock.unlock();
+            Poll();
+            lock.lock();
+        }
+    }
+
+    // Compile the sources modified since the previous poll, and hand the ones which compiled to the callback.
+    void Poll()
+    {
+        std::vector< CompiledShader > compiledShaders;
+        for ( Source& source : m_sources )
+        {
+            int64_t modifiedTime = 0;
+            int64_t size         = 0;
+            GetModifiedTime( source.m_shader.m_sourcePath, modifiedTime, size );
+            if ( ( modifiedTime == source.m_modifiedTime && size == source.m_size ) || modifiedTime < 0 )
+            {
+                continue;
+            }
+
+            source.m_modifiedTime = modifiedTime;
+            source.m_size         = size;
+
+            std::string fileName = "shaderWatcher-" + std::to_string( getpid() ) + "-" +
+                                   std::to_string( ++m_compileNumber ) + "-" + source.m_shader.m_name;
+
+            CompiledShader compiledShader;
+            compiledShader.m_name = source.m_shader.m_name;
+            compiledShader.m_path = JoinPaths( m_outputDirectory, fileName );
+            if ( Compile( source.m_shader.m_sourcePath, compiledShader.m_path ) )
+            {
+                printf( "Recompiled %s.\n", source.m_shader.m_sourcePath.c_str() );
+                compiledShaders.push_back( compiledShader );
+                m_succeededCount++;
+            }
+            else
+            {
+                printf( "Failed to compile %s.\n", source.m_shader.m_sourcePath.c_str() );
+                m_failedCount++;
+            }
+        }
+
+        if ( compiledShaders.empty() )
+        {
+            return;
+        }
+
+        m_function( compiledShaders );
+        for ( const CompiledShader& compiledShader : compiledShaders )
+        {
+            remove( compiledShader.m_path.c_str() );
+        }
+    }
+
+    // Compile i_sourcePath into i_outputPath, returning whether the compiler succeeded.  Diagnostics are printed by
+    // the compiler itself.
+    bool Compile( const std::string& i_sourcePath, const std::string& i_outputPath ) const
+    {
+        std::string command = "\"" + m_compilerPath + "\" -o \"" + i_outputPath + "\" \"" + i_sourcePath + "\"";
+        if ( std::system( command.c_str() ) != 0 )
+        {
+            remove( i_outputPath.c_str() );
+            return false;
+        }
+
+        return true;
+    }
+
+    std::string               m_compilerPath;
+    std::string               m_outputDirectory;
+    std::chrono::milliseconds m_pollInterval{0};
+    CompileFunction           m_function;
+    std::vector< Source >     m_sources;
+    uint64_t                  m_compileNumber = 0;
+
+    std::atomic< uint64_t > m_succeededCount{0};
+    std::atomic< uint64_t > m_failedCount{0};
+
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_wakeCondition;
+    bool                    m_exit = false;
+};
+
+} // namespace vkbase
@@ -0,0 +1,137 @@
+#pragma once
+
+/// \file vkbase/specialization.h
+///
+/// Specialization constants of shaders, described by C++ types so that their map entries are laid out at compile
+/// time.
+
+namespace vkbase
+{
+/// \struct SpecializationConstant
+///
+/// Declares a specialization constant of a shader: its constant_id, and the C++ type of its value.  Booleans are
+/// VkBool32.
+template < uint32_t ConstantID, typename ValueT >
+struct SpecializationConstant
+{
+    static_assert( std::is_same< ValueT, uint32_t >::value || std::is_same< ValueT, int32_t >::value ||
+                       std::is_same< ValueT, float >::value || std::is_same< ValueT, double >::value,
+                   "Specialization constants are 32-bit integers, VkBool32, float, or double." );
+
+    static constexpr uint32_t s_constantID = ConstantID;
+    using ValueType                        = ValueT;
+};
+
+/// Lay out the values of \p ConstantTs, a list of SpecializationConstant, one after the other with natural
+/// alignment, and return their map entries.
+template < typename... ConstantTs >
+constexpr std::array< VkSpecializationMapEntry, sizeof...( ConstantTs ) > MakeSpecializationMapEntries()
+{
+    const uint32_t constantIDs[] = {ConstantTs::s_constantID...};
+    const size_t   sizes[]       = {sizeof( typename ConstantTs::ValueType )...};
+
+    std::array< VkSpecializationMapEntry, sizeof...( ConstantTs ) > entries = {};
+    uint32_t                                                        offset  = 0;
+    for ( size_t constantIndex = 0; constantIndex < sizeof...( ConstantTs ); ++constantIndex )
+    {
+        const uint32_t size                 = static_cast< uint32_t >( sizes[ constantIndex ] );
+        offset                              = ( offset + size - 1 ) / size * size;
+        entries[ constantIndex ].constantID = constantIDs[ constantIndex ];
+        entries[ constantIndex ].offset     = offset;
+        entries[ constantIndex ].size       = size;
+        offset += size;
+    }
+
+    return entries;
+}
+
+/// Check that no two of \p ConstantTs, a list of SpecializationConstant, share a constant_id.
+template < typename... ConstantTs >
+constexpr bool HasUniqueConstantIDs()
+{
+    const uint32_t constantIDs[] = {ConstantTs::s_constantID...};
+    for ( size_t lhsIndex = 0; lhsIndex < sizeof...( ConstantTs ); ++lhsIndex )
+    {
+        for ( size_t rhsIndex = lhsIndex + 1; rhsIndex < sizeof...( ConstantTs ); ++rhsIndex )
+        {
+            if ( constantIDs[ lhsIndex ] == constantIDs[ rhsIndex ] )
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/// \class Specialization
+///
+/// Values of the specialization constants \p ConstantTs, a list of SpecializationConstant, of a shader.
+///
+/// The map entries are computed at compile time, and shared by every instance; an instance only holds the values,
+/// which are set and read by the index of their constant in \p ConstantTs, with their declared type.  For example:
+///
+/// \code
+/// using CullSpecialization = Specialization< SpecializationConstant< 0, uint32_t >,   // Workgroup size.
+///                                            SpecializationConstant< 1, VkBool32 > >; // Compact the output.
+/// CullSpecialization specialization;
+/// specialization.Set< 0 >( 128 );
+/// VkSpecializationInfo info = specialization.GetInfo();
+/// \endcode
+template < typename... ConstantTs >
+class Specialization
+{
+public:
+    static_assert( sizeof...( ConstantTs ) > 0, "A specialization needs at least one constant." );
+    static_assert( HasUniqueConstantIDs< ConstantTs... >(), "Specialization constant IDs must be unique." );
+
+    /// The C++ type of the value of the \p Index'th constant.
+    template < size_t Index >
+    using ValueType = typename std::tuple_element< Index, std::tuple< ConstantTs... > >::type::ValueType;
+
+    /// Map entries of the constants, in the order they are declared.
+    static constexpr std::array< VkSpecializationMapEntry, sizeof...( ConstantTs ) > s_mapEntries =
+        MakeSpecializationMapEntries< ConstantTs... >();
+
+    /// Size of the values of all constants, in bytes.
+    static constexpr size_t s_dataSize = s_mapEntries.back().offset + s_mapEntries.back().size;
+
+    /// Set the value of the \p Index'th constant.
+    template < size_t Index >
+    void Set( ValueType< Index > i_value )
+    {
+        memcpy( m_data.data() + s_mapEntries[ Index ].offset, &i_value, sizeof( i_value ) );
+    }
+
+    /// The value of the \p Index'th constant.
+    template < size_t Index >
+    ValueType< Index > Get() const
+    {
+        ValueType< Index > value;
+        memcpy( &value, m_data.data() + s_mapEntries[ Index ].offset, sizeof( value ) );
+        return value;
+    }
+
+    /// Specialization info for a shader stage, pointing into this object, so must not outlive it.
+    VkSpecializationInfo GetInfo() const
+    {
+        VkSpecializationInfo info = {};
+        info.mapEntryCount        = static_cast< uint32_t >( s_mapEntries.size() );
+        info.pMapEntries          = s_mapEntries.data();
+        info.dataSize             = m_data.size();
+        info.pData                = m_data.data();
+        return info;
+    }
+
+    /// Copy the constants into \p io_variant, so pipelines built for it are specialized with them.
+    void ApplyTo( PipelineVariant& io_variant ) const
+    {
+        io_variant.m_specializationEntries.assign( s_mapEntries.begin(), s_mapEntries.end() );
+        io_variant.m_specializationData.assign( m_data.begin(), m_data.end() );
+    }
+
+private:
+    std::array< uint8_t, s_dataSize > m_data = {};
+};
+
+} // namespace vkbase
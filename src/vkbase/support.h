@@ -76,4 +76,23 @@ bool CheckVulkanExtensionsSupport( const std::vector< const char* >& i_requested
     return missingExtensionsCount == 0;
 }
 
+/// Check if the optional instance extension \p i_extensionName is supported.
+inline bool IsVulkanExtensionSupported( const char* i_extensionName )
+{
+    uint32_t availableExtensionsCount = 0;
+    vkEnumerateInstanceExtensionProperties( nullptr, &availableExtensionsCount, nullptr );
+    std::vector< VkExtensionProperties > availableExtensions( availableExtensionsCount );
+    vkEnumerateInstanceExtensionProperties( nullptr, &availableExtensionsCount, availableExtensions.data() );
+
+    for ( const VkExtensionProperties& extension : availableExtensions )
+    {
+        if ( strcmp( extension.extensionName, i_extensionName ) == 0 )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 } // namespace vkbase
@@ -0,0 +1,1271 @@
+#pragma once
+
+/// \file vkbase/texture.h
+///
+/// Streaming of textures into device local images: decoding on worker threads, uploads through a staging ring on
+/// the transfer queue, mip generation, and eviction of least recently used mips to stay within a memory budget.
+
+namespace vkbase
+{
+/// \struct DecodedImage
+///
+/// An image decoded into host memory, as tightly packed rows of 8-bit RGBA texels.
+struct DecodedImage
+{
+    uint32_t               m_width  = 0;
+    uint32_t               m_height = 0;
+    std::vector< uint8_t > m_texels;
+};
+
+/// Read the whitespace separated header field of a PPM file at \p io_offset into \p i_data, skipping comments.
+inline std::string ReadPpmField( const char* i_data, size_t i_size, size_t& io_offset )
+{
+    while ( io_offset < i_size )
+    {
+        if ( i_data[ io_offset ] == '#' )
+        {
+            while ( io_offset < i_size && i_data[ io_offset ] != '\n' )
+            {
+                ++io_offset;
+            }
+        }
+        else if ( isspace( static_cast< unsigned char >( i_data[ io_offset ] ) ) )
+        {
+            ++io_offset;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    std::string field;
+    while ( io_offset < i_size && !isspace( static_cast< unsigned char >( i_data[ io_offset ] ) ) )
+    {
+        field.push_back( i_data[ io_offset++ ] );
+    }
+
+    return field;
+}
+
+/// Decode the binary PPM (P6) file at \p i_filePath into \p o_image, with opaque alpha.  Only 8-bit channels are
+/// supported, as written by the --output option of the examples.
+inline void DecodePpm( const std::string& i_filePath, DecodedImage& o_image )
+{
+    MappedFile file;
+    file.Map( i_filePath );
+
+    const char* data   = static_cast< const char* >( file.GetData() );
+    size_t      size   = file.GetSize();
+    size_t      offset = 0;
+    if ( ReadPpmField( data, size, offset ) != "P6" )
+    {
+        throw std::runtime_error( "Not a binary PPM file: " + i_filePath );
+    }
+
+    unsigned long width    = strtoul( ReadPpmField( data, size, offset ).c_str(), nullptr, 10 );
+    unsigned long height   = strtoul( ReadPpmField( data, size, offset ).c_str(), nullptr, 10 );
+    unsigned long maxValue = strtoul( ReadPpmField( data, size, offset ).c_str(), nullptr, 10 );
+    if ( width == 0 || height == 0 || width > 16384 || height > 16384 || maxValue != 255 )
+    {
+        throw std::runtime_error( "Unsupported PPM dimensions or channel depth: " + i_filePath );
+    }
+
+    // A single whitespace character separates the header from the texels.
+    ++offset;
+
+    const size_t texelCount = static_cast< size_t >( width ) * height;
+    if ( offset > size || size - offset < texelCount * 3 )
+    {
+        throw std::runtime_error( "Truncated PPM file: " + i_filePath );
+    }
+
+    o_image.m_width  = static_cast< uint32_t >( width );
+    o_image.m_height = static_cast< uint32_t >( height );
+    o_image.m_texels.resize( texelCount * 4 );
+
+    const uint8_t* rgb = reinterpret_cast< const uint8_t* >( data + offset );
+    for ( size_t texelIndex = 0; texelIndex < texelCount; ++texelIndex )
+    {
+        o_image.m_texels[ texelIndex * 4 + 0 ] = rgb[ texelIndex * 3 + 0 ];
+        o_image.m_texels[ texelIndex * 4 + 1 ] = rgb[ texelIndex * 3 + 1 ];
+        o_image.m_texels[ texelIndex * 4 + 2 ] = rgb[ texelIndex * 3 + 2 ];
+        o_image.m_texels[ texelIndex * 4 + 3 ] = 255;
+    }
+}
+
+/// Number of levels of a full mip chain of an image of \p i_width by \p i_height texels, down to 1x1.
+inline uint32_t GetMipLevelCount( uint32_t i_width, uint32_t i_height )
+{
+    uint32_t levelCount = 1;
+    for ( uint32_t size = std::max( i_width, i_height ); size > 1; size >>= 1 )
+    {
+        ++levelCount;
+    }
+
+    return levelCount;
+}
+
+/// \class TextureStreamer
+///
+/// Streams a fixed set of textures, identified by index, into device local images on demand.
+///
+/// Textures used by a frame are requested with Request().  Those which are not resident are decoded on worker
+/// threads, by a function supplied by the caller.  Update(), called once per frame, uploads the decoded texels
+/// through a staging ring on the transfer queue, then generates the mip chain with vkCmdBlitImage on the graphics
+/// queue, which owns the image from then on.  Update() never waits on the workers, nor on the device: it takes
+/// the decoded images which are ready, uploads as much of them as fits in the staging ring, and continues with the
+/// rest in later frames.
+///
+/// Resident images are kept within a memory budget: the smaller of a fixed budget, and what VK_EXT_memory_budget
+/// reports as available to the process, if enabled.  When an upload would exceed it, the least recently used
+/// textures lose their finest mips, by copying the remaining mips into a smaller image, until it fits; a texture
+/// left with a single mip is evicted entirely.  Textures used by the frame being prepared are never evicted.  A
+/// texture which lost mips is streamed again, in full, when next requested.
+///
+/// The decoded images held at once are bounded by the number of textures streamed at once, so the host memory
+/// used is bounded too.
+class TextureStreamer
+{
+public:
+    /// Decodes the texture of the given index into a DecodedImage.  Called on the worker threads.
+    using DecodeFunction = std::function< void( uint32_t, DecodedImage& ) >;
+
+    /// Format of the streamed images.  Blitting, and linear filtering, of it is supported by every device.
+    static constexpr VkFormat s_format = VK_FORMAT_R8G8B8A8_UNORM;
+
+    /// Number of batches of uploads in flight at once.
+    static constexpr uint32_t s_batchCount = 3;
+
+    /// Number of textures streamed at once, per decode thread.
+    static constexpr uint32_t s_streamingTexturesPerThread = 2;
+
+    /// Number of frames a decoded texture which did not fit in the budget waits before it is decoded again.
+    static constexpr uint64_t s_admissionRetryFrames = 30;
+
+    TextureStreamer() = default;
+
+    TextureStreamer( const TextureStreamer& ) = delete;
+    TextureStreamer& operator=( const TextureStreamer& ) = delete;
+
+    ~TextureStreamer()
+    {
+        StopDecodeThreads();
+    }
+
+    /// Prepare to stream \p i_textureCount textures, and start the decode threads.
+    ///
+    /// \param i_transferQueue queue the texels are copied into the images on.  Rows are copied a few at a time, so
+    /// if its family does not support copies at the granularity of a texel, the graphics queue is used instead.
+    /// \param i_graphicsQueue queue the mips are generated on, and the images are sampled from.
+    /// \param i_stagingCapacity size of the staging ring, in bytes.  Each of the s_batchCount batches in flight
+    /// uploads into an equal share of it, which must hold a row of the widest texture.
+    /// \param i_budget upper bound of the memory of the resident images, in bytes.
+    /// \param i_memoryBudgetEnabled whether VK_EXT_memory_budget, and VK_KHR_get_physical_device_properties2,
+    /// are enabled, to further bound the budget by the memory available to the process.
+    void Init( VkInstance       i_instance,
+               VkPhysicalDevice i_physicalDevice,
+               VkDevice         i_device,
+               MemoryAllocator& io_allocator,
+               const Queue&     i_transferQueue,
+               const Queue&     i_graphicsQueue,
+               uint32_t         i_textureCount,
+               size_t           i_decodeThreadCount,
+               VkDeviceSize     i_stagingCapacity,
+               VkDeviceSize     i_budget,
+               bool             i_memoryBudgetEnabled,
+               DecodeFunction   i_decodeFunction )
+    {
+        m_physicalDevice = i_physicalDevice;
+        m_device         = i_device;
+        m_allocator      = &io_allocator;
+        m_transferQueue  = i_transferQueue;
+        m_graphicsQueue  = i_graphicsQueue;
+        m_fixedBudget    = i_budget;
+        if ( !IsTexelTransferGranularity( i_physicalDevice, m_transferQueue.GetFamilyIndex() ) )
+        {
+            printf( "The transfer queue cannot copy single rows of an image, texture uploads use the graphics "
+                    "queue.\n" );
+            m_transferQueue = m_graphicsQueue;
+        }
+
+        m_budget         = i_budget;
+        m_decodeFunction = std::move( i_decodeFunction );
+        m_textures.assign( i_textureCount, Texture() );
+
+        if ( i_memoryBudgetEnabled )
+        {
+            m_getMemoryProperties2 = reinterpret_cast< PFN_vkGetPhysicalDeviceMemoryProperties2KHR >(
+                vkGetInstanceProcAddr( i_instance, "vkGetPhysicalDeviceMemoryProperties2KHR" ) );
+        }
+
+        m_stagingRing.Init( m_device, *m_allocator, i_stagingCapacity );
+        for ( Batch& batch : m_batches )
+        {
+            CreateCommandBuffer( m_transferQueue, batch.m_transferCommandPool, batch.m_transferCommandBuffer );
+            CreateCommandBuffer( m_graphicsQueue, batch.m_graphicsCommandPool, batch.m_graphicsCommandBuffer );
+
+            VkSemaphoreCreateInfo semaphoreInfo = {};
+            semaphoreInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            if ( vkCreateSemaphore( m_device, &semaphoreInfo, nullptr, &batch.m_transferSemaphore ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to create texture upload semaphore." );
+            }
+
+            VkFenceCreateInfo fenceInfo = {};
+            fenceInfo.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if ( vkCreateFence( m_device, &fenceInfo, nullptr, &batch.m_fence ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to create texture upload fence." );
+            }
+        }
+
+        const size_t threadCount = std::max( i_decodeThreadCount, size_t( 1 ) );
+        m_maxStreamingCount      = static_cast< uint32_t >( threadCount ) * s_streamingTexturesPerThread;
+        m_exit                   = false;
+        for ( size_t threadIndex = 0; threadIndex < threadCount; ++threadIndex )
+        {
+            m_decodeThreads.emplace_back( &TextureStreamer::DecodeLoop, this );
+        }
+    }
+
+    /// Stop the decode threads, and destroy all images and upload resources.  The device must be idle.
+    void Teardown()
+    {
+        StopDecodeThreads();
+
+        for ( Texture& texture : m_textures )
+        {
+            DestroyImage( texture.m_image, texture.m_imageView, texture.m_allocation );
+        }
+
+        for ( Upload& upload : m_uploads )
+        {
+            DestroyImage( upload.m_image, upload.m_imageView, upload.m_allocation );
+        }
+
+        for ( RetiredImage& retiredImage : m_retiredImages )
+        {
+            DestroyImage( retiredImage.m_image, retiredImage.m_imageView, retiredImage.m_allocation );
+        }
+
+        for ( Batch& batch : m_batches )
+        {
+            vkDestroyCommandPool( m_device, batch.m_transferCommandPool, nullptr );
+            vkDestroyCommandPool( m_device, batch.m_graphicsCommandPool, nullptr );
+            vkDestroySemaphore( m_device, batch.m_transferSemaphore, nullptr );
+            vkDestroyFence( m_device, batch.m_fence, nullptr );
+            batch = Batch();
+        }
+
+        m_stagingRing.Teardown( m_device, *m_allocator );
+        m_textures.clear();
+        m_uploads.clear();
+        m_retiredImages.clear();
+        m_decodedImages.clear();
+        m_residentSize = 0;
+    }
+
+    /// Mark texture \p i_textureIndex as used by frame \p i_frameNumber, and start streaming it if it is not
+    /// resident, or lost mips.  Does nothing if as many textures as allowed are already streaming; the texture is
+    /// expected to be requested again by later frames.
+    void Request( uint32_t i_textureIndex, uint64_t i_frameNumber )
+    {
+        Texture& texture        = m_textures.at( i_textureIndex );
+        texture.m_lastUsedFrame = i_frameNumber;
+        if ( texture.m_streaming || texture.m_failed || i_frameNumber < texture.m_retryFrame ||
+             ( texture.m_image != VK_NULL_HANDLE && texture.m_droppedLevelCount == 0 ) ||
+             m_streamingCount >= m_maxStreamingCount )
+        {
+            return;
+        }
+
+        texture.m_streaming = true;
+        ++m_streamingCount;
+        {
+            std::lock_guard< std::mutex > lock( m_decodeMutex );
+            m_decodeRequests.push_back( i_textureIndex );
+        }
+
+        m_decodeCondition.notify_one();
+    }
+
+    /// Advance streaming, without blocking, before recording frame \p i_frameNumber: release the resources of the
+    /// batches which completed, upload decoded textures, evict mips to stay within the budget, and submit the
+    /// resulting batch.  Images replaced, or evicted, are destroyed once frame \p i_frameNumber - 1, the last
+    /// which may have sampled them, is no later than \p i_completedFrameNumber.
+    void Update( uint64_t i_frameNumber, uint64_t i_completedFrameNumber )
+    {
+        ReleaseCompletedBatches( i_completedFrameNumber );
+        CollectDecodedImages();
+        UpdateBudget();
+
+        // Every batch is still in flight.
+        if ( m_batchNumber - m_completedBatchNumber >= s_batchCount )
+        {
+            return;
+        }
+
+        Batch& batch       = m_batches[ m_batchNumber % s_batchCount ];
+        m_transferRecorded = false;
+        m_graphicsRecorded = false;
+        m_uploadSizeLeft   = m_stagingRing.GetCapacity() / s_batchCount;
+
+        // Continue the uploads started by earlier batches, then start uploading the decoded images which fit in
+        // the budget, for as long as the staging ring has room.
+        for ( Upload& upload : m_uploads )
+        {
+            UploadRows( batch, upload );
+        }
+
+        while ( !m_decodedImages.empty() && m_uploadSizeLeft > 0 )
+        {
+            std::pair< uint32_t, DecodedImage > decodedImage = std::move( m_decodedImages.front() );
+            m_decodedImages.pop_front();
+            StartUpload( batch, decodedImage.first, std::move( decodedImage.second ), i_frameNumber );
+        }
+
+        // The budget may have shrunk, when other processes allocated memory.
+        EvictToFit( batch, 0, i_frameNumber );
+
+        // Generate the mips of the textures whose texels were all copied, and make them resident.
+        for ( size_t uploadIndex = 0; uploadIndex < m_uploads.size(); )
+        {
+            Upload& upload = m_uploads[ uploadIndex ];
+            if ( upload.m_uploadedRowCount < upload.m_texels.m_height )
+            {
+                ++uploadIndex;
+                continue;
+            }
+
+            FinishUpload( batch, upload, i_frameNumber );
+            m_uploads.erase( m_uploads.begin() + uploadIndex );
+        }
+
+        SubmitBatch( batch );
+    }
+
+    /// The view of the resident image of texture \p i_textureIndex, covering all its resident mips, or
+    /// VK_NULL_HANDLE if it is not resident.  Valid until the next Update().
+    VkImageView GetImageView( uint32_t i_textureIndex ) const
+    {
+        return m_textures.at( i_textureIndex ).m_imageView;
+    }
+
+    /// Number of textures.
+    size_t GetTextureCount() const
+    {
+        return m_textures.size();
+    }
+
+    /// Number of textures resident, with at least one mip.
+    size_t GetResidentCount() const
+    {
+        size_t residentCount = 0;
+        for ( const Texture& texture : m_textures )
+        {
+            residentCount += texture.m_image != VK_NULL_HANDLE ? 1 : 0;
+        }
+
+        return residentCount;
+    }
+
+    /// Memory of the resident images, and of those being uploaded, in bytes.
+    VkDeviceSize GetResidentSize() const
+    {
+        return m_residentSize;
+    }
+
+    /// The current memory budget of the resident images, in bytes.
+    VkDeviceSize GetBudget() const
+    {
+        return m_budget;
+    }
+
+    /// Number of textures uploaded, including those streamed again after losing mips.
+    uint64_t GetUploadCount() const
+    {
+        return m_uploadCount;
+    }
+
+    /// Number of bytes of texels copied through the staging ring.
+    uint64_t GetUploadedSize() const
+    {
+        return m_uploadedSize;
+    }
+
+    /// Number of mips evicted, and of textures evicted entirely.
+    void GetEvictionCounts( uint64_t& o_evictedMipCount, uint64_t& o_evictedTextureCount ) const
+    {
+        o_evictedMipCount     = m_evictedMipCount;
+        o_evictedTextureCount = m_evictedTextureCount;
+    }
+
+private:
+    // A texture, and its resident image, if any.
+    struct Texture
+    {
+        VkImage          m_image     = VK_NULL_HANDLE; // Resident image, or VK_NULL_HANDLE.
+        VkImageView      m_imageView = VK_NULL_HANDLE;
+        MemoryAllocation m_allocation;
+        uint32_t         m_width             = 0; // Size of the finest mip of the full texture.
+        uint32_t         m_height            = 0;
+        uint32_t         m_levelCount        = 0; // Mips of the full texture.
+        uint32_t         m_droppedLevelCount = 0; // Finest mips evicted from the resident image.
+        uint64_t         m_lastUsedFrame     = 0;
+        uint64_t         m_retryFrame        = 0;     // Frame from which the texture may be decoded again.
+        bool             m_streaming         = false; // Being decoded, or uploaded.
+        bool             m_failed            = false; // Failed to decode, so never requested again.
+    };
+
+    // A decoded texture being copied into a new image, possibly over several batches.
+    struct Upload
+    {
+        uint32_t         m_textureIndex = 0;
+        DecodedImage     m_texels;
+        VkImage          m_image     = VK_NULL_HANDLE;
+        VkImageView      m_imageView = VK_NULL_HANDLE;
+        MemoryAllocation m_allocation;
+        uint32_t         m_levelCount       = 0;
+        uint32_t         m_uploadedRowCount = 0; // Rows of the finest mip copied so far.
+    };
+
+    // Command buffers, and synchronization, of a batch of uploads and evictions.  The transfer queue copies the
+    // texels, then the graphics queue acquires the images, generates their mips, and copies evicted images.
+    struct Batch
+    {
+        VkCommandPool   m_transferCommandPool   = VK_NULL_HANDLE;
+        VkCommandBuffer m_transferCommandBuffer = VK_NULL_HANDLE;
+        VkCommandPool   m_graphicsCommandPool   = VK_NULL_HANDLE;
+        VkCommandBuffer m_graphicsCommandBuffer = VK_NULL_HANDLE;
+        VkSemaphore     m_transferSemaphore     = VK_NULL_HANDLE; // Signaled once the copies have completed.
+        VkFence         m_fence                 = VK_NULL_HANDLE; // Signaled once the whole batch has completed.
+    };
+
+    // An image no longer resident, destroyed once the frames which may sample it, and the batch which may copy
+    // out of it, have completed.
+    struct RetiredImage
+    {
+        VkImage          m_image     = VK_NULL_HANDLE;
+        VkImageView      m_imageView = VK_NULL_HANDLE;
+        MemoryAllocation m_allocation;
+        uint64_t         m_frameNumber = 0;
+        uint64_t         m_batchNumber = 0;
+    };
+
+    // Does queue family i_familyIndex copy images at the granularity of a single texel?  Graphics and compute
+    // families always do; a dedicated transfer family may only copy whole mip levels, or coarser blocks.
+    static bool IsTexelTransferGranularity( VkPhysicalDevice i_physicalDevice, uint32_t i_familyIndex )
+    {
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties( i_physicalDevice, &familyCount, nullptr );
+        std::vector< VkQueueFamilyProperties > families( familyCount );
+        vkGetPhysicalDeviceQueueFamilyProperties( i_physicalDevice, &familyCount, families.data() );
+
+        const VkExtent3D& granularity = families.at( i_familyIndex ).minImageTransferGranularity;
+        return granularity.width == 1 && granularity.height == 1 && granularity.depth == 1;
+    }
+
+    void CreateCommandBuffer( const Queue& i_queue, VkCommandPool& o_pool, VkCommandBuffer& o_commandBuffer )
+    {
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex        = i_queue.GetFamilyIndex();
+        poolInfo.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        if ( vkCreateCommandPool( m_device, &poolInfo, nullptr, &o_pool ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create texture upload command pool." );
+        }
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool                 = o_pool;
+        allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount          = 1;
+        if ( vkAllocateCommandBuffers( m_device, &allocInfo, &o_commandBuffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to allocate texture upload command buffer." );
+        }
+    }
+
+    // Begin recording io_commandBuffer, if not already recording it for this batch.
+    static void BeginRecording( VkCommandBuffer i_commandBuffer, bool& io_recorded )
+    {
+        if ( io_recorded )
+        {
+            return;
+        }
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if ( vkBeginCommandBuffer( i_commandBuffer, &beginInfo ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to begin recording texture upload command buffer." );
+        }
+
+        io_recorded = true;
+    }
+
+    void StopDecodeThreads()
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_decodeMutex );
+            m_exit = true;
+        }
+
+        m_decodeCondition.notify_all();
+        for ( std::thread& thread : m_decodeThreads )
+        {
+            thread.join();
+        }
+
+        m_decodeThreads.clear();
+    }
+
+    // Decode the requested textures, until stopped.
+    void DecodeLoop()
+    {
+        for ( ;; )
+        {
+            uint32_t textureIndex = 0;
+            {
+                std::unique_lock< std::mutex > lock( m_decodeMutex );
+                m_decodeCondition.wait( lock, [this]() { return m_exit || !m_decodeRequests.empty(); } );
+                if ( m_exit )
+                {
+                    return;
+                }
+
+                textureIndex = m_decodeRequests.front();
+                m_decodeRequests.pop_front();
+            }
+
+            DecodedImage image;
+            bool         decoded = true;
+            try
+            {
+                m_decodeFunction( textureIndex, image );
+                if ( image.m_width == 0 || image.m_height == 0 ||
+                     image.m_texels.size() != static_cast< size_t >( image.m_width ) * image.m_height * 4 )
+                {
+                    throw std::runtime_error( "Decoded image has no texels, or the wrong number of them." );
+                }
+
+                // Each batch only uploads into its share of the ring.
+                if ( VkDeviceSize( image.m_width ) * 4 > m_stagingRing.GetCapacity() / s_batchCount )
+                {
+                    throw std::runtime_error(
+                        "A row of the decoded image does not fit in the share of the staging ring of a batch." );
+                }
+            }
+            catch ( const std::exception& i_exception )
+            {
+                printf( "Failed to decode texture %u: %s\n", textureIndex, i_exception.what() );
+                decoded = false;
+            }
+
+            std::lock_guard< std::mutex > lock( m_decodeMutex );
+            if ( decoded )
+            {
+                m_decodedQueue.emplace_back( textureIndex, std::move( image ) );
+            }
+            else
+            {
+                m_failedQueue.push_back( textureIndex );
+            }
+        }
+    }
+
+    // Take the images decoded since the previous update, unless a decode thread holds the lock.
+    void CollectDecodedImages()
+    {
+        std::unique_lock< std::mutex > lock( m_decodeMutex, std::try_to_lock );
+        if ( !lock.owns_lock() )
+        {
+            return;
+        }
+
+        for ( std::pair< uint32_t, DecodedImage >& decodedImage : m_decodedQueue )
+        {
+            m_decodedImages.push_back( std::move( decodedImage ) );
+        }
+
+        for ( uint32_t textureIndex : m_failedQueue )
+        {
+            m_textures[ textureIndex ].m_failed    = true;
+            m_textures[ textureIndex ].m_streaming = false;
+            --m_streamingCount;
+        }
+
+        m_decodedQueue.clear();
+        m_failedQueue.clear();
+    }
+
+    // Bound the fixed budget by the memory of the device local heaps available to the process.  The resident
+    // images are included in the heap usage, so are added back.
+    void UpdateBudget()
+    {
+        m_budget = m_fixedBudget;
+        if ( m_getMemoryProperties2 == nullptr )
+        {
+            return;
+        }
+
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2KHR memoryProperties = {};
+        memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+        memoryProperties.pNext = &budgetProperties;
+        m_getMemoryProperties2( m_physicalDevice, &memoryProperties );
+
+        VkDeviceSize heapBudget = 0;
+        VkDeviceSize heapUsage  = 0;
+        for ( uint32_t heapIndex = 0; heapIndex < memoryProperties.memoryProperties.memoryHeapCount; ++heapIndex )
+        {
+            if ( memoryProperties.memoryProperties.memoryHeaps[ heapIndex ].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT )
+            {
+                heapBudget += budgetProperties.heapBudget[ heapIndex ];
+                heapUsage += budgetProperties.heapUsage[ heapIndex ];
+            }
+        }
+
+        const VkDeviceSize otherUsage = heapUsage > m_residentSize ? heapUsage - m_residentSize : 0;
+        m_budget = std::min( m_fixedBudget, heapBudget > otherUsage ? heapBudget - otherUsage : 0 );
+    }
+
+    // Mark the batches whose fence is signaled as complete, release their staging memory, and destroy the images
+    // retired before them, and before i_completedFrameNumber.
+    void ReleaseCompletedBatches( uint64_t i_completedFrameNumber )
+    {
+        // Batches complete in the order they were submitted; batch N was recorded into m_batches[ N - 1 ].
+        while ( m_completedBatchNumber < m_batchNumber )
+        {
+            Batch& batch = m_batches[ m_completedBatchNumber % s_batchCount ];
+            if ( vkGetFenceStatus( m_device, batch.m_fence ) != VK_SUCCESS )
+            {
+                break;
+            }
+
+            vkResetFences( m_device, 1, &batch.m_fence );
+            vkResetCommandPool( m_device, batch.m_transferCommandPool, 0 );
+            vkResetCommandPool( m_device, batch.m_graphicsCommandPool, 0 );
+            ++m_completedBatchNumber;
+        }
+
+        m_stagingRing.Release( m_completedBatchNumber );
+
+        // Images are retired in non-decreasing order of both numbers, so the ready ones are at the front.
+        while ( !m_retiredImages.empty() && m_retiredImages.front().m_frameNumber <= i_completedFrameNumber &&
+                m_retiredImages.front().m_batchNumber <= m_completedBatchNumber )
+        {
+            RetiredImage& retiredImage = m_retiredImages.front();
+            DestroyImage( retiredImage.m_image, retiredImage.m_imageView, retiredImage.m_allocation );
+            m_retiredImages.pop_front();
+        }
+    }
+
+    // Create an image of i_levelCount mips, the finest of i_width by i_height texels, without binding memory.
+    VkImage CreateImage( uint32_t i_width, uint32_t i_height, uint32_t i_levelCount ) const
+    {
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType         = VK_IMAGE_TYPE_2D;
+        imageInfo.format            = s_format;
+        imageInfo.extent            = {i_width, i_height, 1};
+        imageInfo.mipLevels         = i_levelCount;
+        imageInfo.arrayLayers       = 1;
+        imageInfo.samples           = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling            = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage =
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkImage image;
+        if ( vkCreateImage( m_device, &imageInfo, nullptr, &image ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create texture image." );
+        }
+
+        return image;
+    }
+
+    // Allocate, and bind, the memory of i_image, and create a view of all its mips.
+    void BindImage( VkImage                     i_image,
+                    const VkMemoryRequirements& i_requirements,
+                    uint32_t                    i_levelCount,
+                    MemoryAllocation&           o_allocation,
+                    VkImageView&                o_imageView )
+    {
+        o_allocation = m_allocator->Allocate( i_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+        if ( vkBindImageMemory( m_device, i_image, o_allocation.m_memory, o_allocation.m_offset ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to bind texture image memory." );
+        }
+
+        VkImageViewCreateInfo viewInfo           = {};
+        viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image                           = i_image;
+        viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format                          = s_format;
+        viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel   = 0;
+        viewInfo.subresourceRange.levelCount     = i_levelCount;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount     = 1;
+        if ( vkCreateImageView( m_device, &viewInfo, nullptr, &o_imageView ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create texture image view." );
+        }
+
+        m_residentSize += o_allocation.m_size;
+    }
+
+    void DestroyImage( VkImage& io_image, VkImageView& io_imageView, MemoryAllocation& io_allocation )
+    {
+        vkDestroyImageView( m_device, io_imageView, nullptr );
+        vkDestroyImage( m_device, io_image, nullptr );
+        m_allocator->Free( io_allocation );
+        io_image      = VK_NULL_HANDLE;
+        io_imageView  = VK_NULL_HANDLE;
+        io_allocation = MemoryAllocation();
+    }
+
+    // Retire the resident image of io_texture, leaving it without one.  i_readByBatch is whether the batch being
+    // recorded reads from the image, so it must also complete before the image is destroyed.
+    void RetireImage( Texture& io_texture, uint64_t i_frameNumber, bool i_readByBatch )
+    {
+        RetiredImage retiredImage;
+        retiredImage.m_image       = io_texture.m_image;
+        retiredImage.m_imageView   = io_texture.m_imageView;
+        retiredImage.m_allocation  = io_texture.m_allocation;
+        retiredImage.m_frameNumber = i_frameNumber - 1;
+        retiredImage.m_batchNumber = i_readByBatch ? m_batchNumber + 1 : m_batchNumber;
+        m_retiredImages.push_back( retiredImage );
+
+        m_residentSize -= io_texture.m_allocation.m_size;
+        io_texture.m_image             = VK_NULL_HANDLE;
+        io_texture.m_imageView         = VK_NULL_HANDLE;
+        io_texture.m_allocation        = MemoryAllocation();
+        io_texture.m_droppedLevelCount = 0;
+    }
+
+    static VkImageMemoryBarrier MakeImageBarrier( VkImage       i_image,
+                                                  uint32_t      i_baseLevel,
+                                                  uint32_t      i_levelCount,
+                                                  VkImageLayout i_oldLayout,
+                                                  VkImageLayout i_newLayout,
+                                                  VkAccessFlags i_srcAccess,
+                                                  VkAccessFlags i_dstAccess )
+    {
+        VkImageMemoryBarrier barrier            = {};
+        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask                   = i_srcAccess;
+        barrier.dstAccessMask                   = i_dstAccess;
+        barrier.oldLayout                       = i_oldLayout;
+        barrier.newLayout                       = i_newLayout;
+        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image                           = i_image;
+        barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel   = i_baseLevel;
+        barrier.subresourceRange.levelCount     = i_levelCount;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount     = 1;
+        return barrier;
+    }
+
+    // Create the image of a decoded texture, and start copying its texels into it, if it fits in the budget after
+    // evicting mips of other textures.  Otherwise, the decoded texels are dropped, and the texture decoded again
+    // when requested after s_admissionRetryFrames.
+    void StartUpload( Batch& io_batch, uint32_t i_textureIndex, DecodedImage i_texels, uint64_t i_frameNumber )
+    {
+        Texture& texture = m_textures[ i_textureIndex ];
+
+        Upload upload;
+        upload.m_textureIndex = i_textureIndex;
+        upload.m_texels       = std::move( i_texels );
+        upload.m_levelCount   = GetMipLevelCount( upload.m_texels.m_width, upload.m_texels.m_height );
+        upload.m_image        = CreateImage( upload.m_texels.m_width, upload.m_texels.m_height, upload.m_levelCount );
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements( m_device, upload.m_image, &requirements );
+        if ( !EvictToFit( io_batch, requirements.size, i_frameNumber ) )
+        {
+            vkDestroyImage( m_device, upload.m_image, nullptr );
+            texture.m_streaming  = false;
+            texture.m_retryFrame = i_frameNumber + s_admissionRetryFrames;
+            --m_streamingCount;
+            return;
+        }
+
+        BindImage( upload.m_image, requirements, upload.m_levelCount, upload.m_allocation, upload.m_imageView );
+
+        // Every mip is written by a transfer: the finest by copies, the others by blits.
+        VkImageMemoryBarrier barrier = MakeImageBarrier( upload.m_image,
+                                                         0,
+                                                         upload.m_levelCount,
+                                                         VK_IMAGE_LAYOUT_UNDEFINED,
+                                                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                         0,
+                                                         VK_ACCESS_TRANSFER_WRITE_BIT );
+        BeginRecording( io_batch.m_transferCommandBuffer, m_transferRecorded );
+        vkCmdPipelineBarrier( io_batch.m_transferCommandBuffer,
+                              VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              0,
+                              0,
+                              nullptr,
+                              0,
+                              nullptr,
+                              1,
+                              &barrier );
+
+        m_uploads.push_back( std::move( upload ) );
+        UploadRows( io_batch, m_uploads.back() );
+    }
+
+    // Copy as many of the remaining rows of the finest mip of io_upload as fit in the staging ring, and in the
+    // share of the ring left to this batch.
+    void UploadRows( Batch& io_batch, Upload& io_upload )
+    {
+        const uint32_t     width    = io_upload.m_texels.m_width;
+        const uint32_t     height   = io_upload.m_texels.m_height;
+        const VkDeviceSize rowPitch = VkDeviceSize( width ) * 4;
+        while ( io_upload.m_uploadedRowCount < height )
+        {
+            // No whole row fits in the share of the ring left to this batch.
+            if ( m_uploadSizeLeft < rowPitch )
+            {
+                m_uploadSizeLeft = 0;
+                return;
+            }
+
+            const VkDeviceSize remainingSize = rowPitch * ( height - io_upload.m_uploadedRowCount );
+            const VkDeviceSize requestedSize = std::min( remainingSize, m_uploadSizeLeft / rowPitch * rowPitch );
+
+            VkDeviceSize stagingOffset = 0;
+            VkDeviceSize size          = m_stagingRing.Reserve( requestedSize, 16, stagingOffset );
+            if ( size == 0 )
+            {
+                // The ring is full until earlier batches complete.
+                m_uploadSizeLeft = 0;
+                return;
+            }
+
+            // A reservation cut short by the end of the ring may hold no whole row; it is released along with the
+            // batch, and the next reservation starts at the beginning of the ring.
+            m_uploadSizeLeft -= std::min( size, m_uploadSizeLeft );
+            const uint32_t rowCount = static_cast< uint32_t >( size / rowPitch );
+            if ( rowCount == 0 )
+            {
+                continue;
+            }
+
+            memcpy( m_stagingRing.GetMappedData() + stagingOffset,
+                    io_upload.m_texels.m_texels.data() + rowPitch * io_upload.m_uploadedRowCount,
+                    rowPitch * rowCount );
+
+            VkBufferImageCopy region               = {};
+            region.bufferOffset                    = stagingOffset;
+            region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel       = 0;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount     = 1;
+            region.imageOffset                     = {0, static_cast< int32_t >( io_upload.m_uploadedRowCount ), 0};
+            region.imageExtent                     = {width, rowCount, 1};
+
+            BeginRecording( io_batch.m_transferCommandBuffer, m_transferRecorded );
+            vkCmdCopyBufferToImage( io_batch.m_transferCommandBuffer,
+                                    m_stagingRing.GetBuffer(),
+                                    io_upload.m_image,
+                                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                    1,
+                                    &region );
+
+            io_upload.m_uploadedRowCount += rowCount;
+            m_uploadedSize += rowPitch * rowCount;
+        }
+    }
+
+    // Transfer the image of a fully copied upload to the graphics queue, generate its mips, and make it the
+    // resident image of its texture, retiring the one it replaces.
+    void FinishUpload( Batch& io_batch, Upload& io_upload, uint64_t i_frameNumber )
+    {
+        VkImageSubresourceRange range = {};
+        range.aspectMask              = VK_IMAGE_ASPECT_COLOR_BIT;
+        range.levelCount              = io_upload.m_levelCount;
+        range.layerCount              = 1;
+
+        // The copies of earlier batches precede this release on the transfer queue, so are covered by it too.
+        VkImageMemoryBarrier releaseBarrier;
+        VkImageMemoryBarrier acquireBarrier;
+        MakeImageOwnershipTransfer( io_upload.m_image,
+                                    range,
+                                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                    m_transferQueue,
+                                    VK_ACCESS_TRANSFER_WRITE_BIT,
+                                    m_graphicsQueue,
+                                    VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                                    releaseBarrier,
+                                    acquireBarrier );
+
+        BeginRecording( io_batch.m_transferCommandBuffer, m_transferRecorded );
+        vkCmdPipelineBarrier( io_batch.m_transferCommandBuffer,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              0,
+                              0,
+                              nullptr,
+                              0,
+                              nullptr,
+                              1,
+                              &releaseBarrier );
+
+        VkCommandBuffer commandBuffer = io_batch.m_graphicsCommandBuffer;
+        BeginRecording( commandBuffer, m_graphicsRecorded );
+        vkCmdPipelineBarrier( commandBuffer,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              0,
+                              0,
+                              nullptr,
+                              0,
+                              nullptr,
+                              1,
+                              &acquireBarrier );
+
+        // Each mip is blitted from the one before it, once that has been written.
+        int32_t width  = static_cast< int32_t >( io_upload.m_texels.m_width );
+        int32_t height = static_cast< int32_t >( io_upload.m_texels.m_height );
+        for ( uint32_t level = 1; level < io_upload.m_levelCount; ++level )
+        {
+            VkImageMemoryBarrier barrier = MakeImageBarrier( io_upload.m_image,
+                                                             level - 1,
+                                                             1,
+                                                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                                             VK_ACCESS_TRANSFER_WRITE_BIT,
+                                                             VK_ACCESS_TRANSFER_READ_BIT );
+            vkCmdPipelineBarrier( commandBuffer,
+                                  VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                  VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                  0,
+                                  0,
+                                  nullptr,
+                                  0,
+                                  nullptr,
+                                  1,
+                                  &barrier );
+
+            VkImageBlit blit                   = {};
+            blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel       = level - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount     = 1;
+            blit.srcOffsets[ 0 ]               = {0, 0, 0};
+            blit.srcOffsets[ 1 ]               = {width, height, 1};
+            blit.dstSubresource                = blit.srcSubresource;
+            blit.dstSubresource.mipLevel       = level;
+            width                              = std::max( width / 2, 1 );
+            height                             = std::max( height / 2, 1 );
+            blit.dstOffsets[ 0 ]               = {0, 0, 0};
+            blit.dstOffsets[ 1 ]               = {width, height, 1};
+            vkCmdBlitImage( commandBuffer,
+                            io_upload.m_image,
+                            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                            io_upload.m_image,
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            1,
+                            &blit,
+                            VK_FILTER_LINEAR );
+        }
+
+        // All mips but the coarsest were read by a blit; the coarsest was written by the last one.
+        const uint32_t       lastLevel        = io_upload.m_levelCount - 1;
+        VkImageMemoryBarrier readBarriers[ 2 ] = {
+            MakeImageBarrier( io_upload.m_image,
+                              lastLevel,
+                              1,
+                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                              VK_ACCESS_TRANSFER_WRITE_BIT,
+                              VK_ACCESS_SHADER_READ_BIT ),
+            MakeImageBarrier( io_upload.m_image,
+                              0,
+                              lastLevel,
+                              VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                              VK_ACCESS_TRANSFER_READ_BIT,
+                              VK_ACCESS_SHADER_READ_BIT )};
+        vkCmdPipelineBarrier( commandBuffer,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                              0,
+                              0,
+                              nullptr,
+                              0,
+                              nullptr,
+                              lastLevel > 0 ? 2 : 1,
+                              readBarriers );
+
+        Texture& texture = m_textures[ io_upload.m_textureIndex ];
+        if ( texture.m_image != VK_NULL_HANDLE )
+        {
+            RetireImage( texture, i_frameNumber, /* i_readByBatch */ false );
+        }
+
+        texture.m_image             = io_upload.m_image;
+        texture.m_imageView         = io_upload.m_imageView;
+        texture.m_allocation        = io_upload.m_allocation;
+        texture.m_width             = io_upload.m_texels.m_width;
+        texture.m_height            = io_upload.m_texels.m_height;
+        texture.m_levelCount        = io_upload.m_levelCount;
+        texture.m_droppedLevelCount = 0;
+        texture.m_streaming         = false;
+        --m_streamingCount;
+        ++m_uploadCount;
+    }
+
+    // Evict mips of the least recently used textures, other than those used by frame i_frameNumber, until
+    // i_size more bytes fit in the budget.
+    //
+    // \return false if they can not be made to fit.
+    bool EvictToFit( Batch& io_batch, VkDeviceSize i_size, uint64_t i_frameNumber )
+    {
+        while ( m_residentSize + i_size > m_budget )
+        {
+            Texture* leastRecentlyUsed = nullptr;
+            for ( Texture& texture : m_textures )
+            {
+                if ( texture.m_image != VK_NULL_HANDLE && !texture.m_streaming &&
+                     texture.m_lastUsedFrame < i_frameNumber &&
+                     ( leastRecentlyUsed == nullptr || texture.m_lastUsedFrame < leastRecentlyUsed->m_lastUsedFrame ) )
+                {
+                    leastRecentlyUsed = &texture;
+                }
+            }
+
+            if ( leastRecentlyUsed == nullptr )
+            {
+                return false;
+            }
+
+            // Drop as few of the finest mips as leave enough room, estimated from their texels.
+            Texture&           texture       = *leastRecentlyUsed;
+            const uint32_t     residentCount = texture.m_levelCount - texture.m_droppedLevelCount;
+            const VkDeviceSize required      = m_residentSize + i_size - m_budget;
+            VkDeviceSize       droppedSize   = 0;
+            uint32_t           dropCount     = 0;
+            while ( dropCount < residentCount - 1 && droppedSize < required )
+            {
+                const uint32_t level = texture.m_droppedLevelCount + dropCount;
+                droppedSize += VkDeviceSize( std::max( texture.m_width >> level, 1u ) ) *
+                               std::max( texture.m_height >> level, 1u ) * 4;
+                ++dropCount;
+            }
+
+            if ( droppedSize < required || dropCount == 0 )
+            {
+                RetireImage( texture, i_frameNumber, /* i_readByBatch */ false );
+                ++m_evictedTextureCount;
+                m_evictedMipCount += residentCount;
+            }
+            else
+            {
+                DropMips( io_batch, texture, dropCount, i_frameNumber );
+                m_evictedMipCount += dropCount;
+            }
+        }
+
+        return true;
+    }
+
+    // Replace the resident image of io_texture with one lacking its i_dropCount finest mips, copying the others
+    // into it on the graphics queue.
+    void DropMips( Batch& io_batch, Texture& io_texture, uint32_t i_dropCount, uint64_t i_frameNumber )
+    {
+        const uint32_t oldBaseLevel = io_texture.m_droppedLevelCount;
+        const uint32_t newBaseLevel = oldBaseLevel + i_dropCount;
+        const uint32_t levelCount   = io_texture.m_levelCount - newBaseLevel;
+
+        VkImage image = CreateImage( std::max( io_texture.m_width >> newBaseLevel, 1u ),
+                                     std::max( io_texture.m_height >> newBaseLevel, 1u ),
+                                     levelCount );
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements( m_device, image, &requirements );
+
+        MemoryAllocation allocation;
+        VkImageView      imageView = VK_NULL_HANDLE;
+        BindImage( image, requirements, levelCount, allocation, imageView );
+
+        VkCommandBuffer commandBuffer = io_batch.m_graphicsCommandBuffer;
+        BeginRecording( commandBuffer, m_graphicsRecorded );
+
+        // Frames submitted before the batch may still sample the old image.
+        VkImageMemoryBarrier copyBarriers[ 2 ] = {
+            MakeImageBarrier( io_texture.m_image,
+                              0,
+                              io_texture.m_levelCount - oldBaseLevel,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                              VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                              0,
+                              VK_ACCESS_TRANSFER_READ_BIT ),
+            MakeImageBarrier( image,
+                              0,
+                              levelCount,
+                              VK_IMAGE_LAYOUT_UNDEFINED,
+                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              0,
+                              VK_ACCESS_TRANSFER_WRITE_BIT )};
+        vkCmdPipelineBarrier( commandBuffer,
+                              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              0,
+                              0,
+                              nullptr,
+                              0,
+                              nullptr,
+                              2,
+                              copyBarriers );
+
+        std::vector< VkImageCopy > regions( levelCount );
+        for ( uint32_t level = 0; level < levelCount; ++level )
+        {
+            VkImageCopy& region                  = regions[ level ];
+            region                               = {};
+            region.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.srcSubresource.mipLevel       = level + i_dropCount;
+            region.srcSubresource.baseArrayLayer = 0;
+            region.srcSubresource.layerCount     = 1;
+            region.dstSubresource                = region.srcSubresource;
+            region.dstSubresource.mipLevel       = level;
+            region.extent.width                  = std::max( io_texture.m_width >> ( newBaseLevel + level ), 1u );
+            region.extent.height                 = std::max( io_texture.m_height >> ( newBaseLevel + level ), 1u );
+            region.extent.depth                  = 1;
+        }
+
+        vkCmdCopyImage( commandBuffer,
+                        io_texture.m_image,
+                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        image,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        levelCount,
+                        regions.data() );
+
+        VkImageMemoryBarrier readBarrier = MakeImageBarrier( image,
+                                                             0,
+                                                             levelCount,
+                                                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                             VK_ACCESS_TRANSFER_WRITE_BIT,
+                                                             VK_ACCESS_SHADER_READ_BIT );
+        vkCmdPipelineBarrier( commandBuffer,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                              0,
+                              0,
+                              nullptr,
+                              0,
+                              nullptr,
+                              1,
+                              &readBarrier );
+
+        RetireImage( io_texture, i_frameNumber, /* i_readByBatch */ true );
+        io_texture.m_image             = image;
+        io_texture.m_imageView         = imageView;
+        io_texture.m_allocation        = allocation;
+        io_texture.m_droppedLevelCount = newBaseLevel;
+    }
+
+    // Submit the commands recorded into io_batch, if any: the copies to the transfer queue, then the rest to the
+    // graphics queue, waiting on the copies.
+    void SubmitBatch( Batch& io_batch )
+    {
+        if ( !m_transferRecorded && !m_graphicsRecorded )
+        {
+            return;
+        }
+
+        // The graphics submission signals the fence, so is made even if it has no commands of its own.
+        BeginRecording( io_batch.m_graphicsCommandBuffer, m_graphicsRecorded );
+
+        Submission graphicsSubmission;
+        if ( m_transferRecorded )
+        {
+            if ( vkEndCommandBuffer( io_batch.m_transferCommandBuffer ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to record texture upload command buffer." );
+            }
+
+            Submission transferSubmission;
+            transferSubmission.AddCommandBuffer( io_batch.m_transferCommandBuffer );
+            transferSubmission.Signal( io_batch.m_transferSemaphore );
+            if ( m_transferQueue.Submit( transferSubmission ) != VK_SUCCESS )
+            {
+                throw std::runtime_error( "Failed to submit texture upload command buffer." );
+            }
+
+            graphicsSubmission.Wait( io_batch.m_transferSemaphore, VK_PIPELINE_STAGE_TRANSFER_BIT );
+        }
+
+        if ( vkEndCommandBuffer( io_batch.m_graphicsCommandBuffer ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to record texture mip generation command buffer." );
+        }
+
+        graphicsSubmission.AddCommandBuffer( io_batch.m_graphicsCommandBuffer );
+        if ( m_graphicsQueue.Submit( graphicsSubmission, io_batch.m_fence ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to submit texture mip generation command buffer." );
+        }
+
+        m_stagingRing.Commit( ++m_batchNumber );
+    }
+
+    VkPhysicalDevice                            m_physicalDevice       = VK_NULL_HANDLE;
+    VkDevice                                    m_device               = VK_NULL_HANDLE;
+    MemoryAllocator*                            m_allocator            = nullptr;
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR m_getMemoryProperties2 = nullptr;
+    Queue                                       m_transferQueue;
+    Queue                                       m_graphicsQueue;
+    StagingRing                                 m_stagingRing;
+    std::array< Batch, s_batchCount >           m_batches;
+
+    std::vector< Texture >                            m_textures;
+    std::deque< std::pair< uint32_t, DecodedImage > > m_decodedImages; // Decoded, and waiting to be uploaded.
+    std::vector< Upload >                             m_uploads;       // Being copied into their images.
+    std::deque< RetiredImage >                        m_retiredImages;
+    uint32_t                                          m_streamingCount    = 0;
+    uint32_t                                          m_maxStreamingCount = 0;
+
+    VkDeviceSize m_fixedBudget  = 0;
+    VkDeviceSize m_budget       = 0;
+    VkDeviceSize m_residentSize = 0;
+
+    uint64_t     m_batchNumber          = 0; // Number of batches submitted.
+    uint64_t     m_completedBatchNumber = 0; // Number of the latest batch known to have completed.
+    bool         m_transferRecorded     = false;
+    bool         m_graphicsRecorded     = false;
+    VkDeviceSize m_uploadSizeLeft       = 0; // Bytes of the staging ring left to the batch being recorded.
+
+    uint64_t m_uploadCount         = 0;
+    uint64_t m_uploadedSize        = 0;
+    uint64_t m_evictedMipCount     = 0;
+    uint64_t m_evictedTextureCount = 0;
+
+    // Decode threads, the textures they are asked to decode, and the results handed back to Update().
+    DecodeFunction                                     m_decodeFunction;
+    std::vector< std::thread >                         m_decodeThreads;
+    std::mutex                                         m_decodeMutex;
+    std::condition_variable                            m_decodeCondition;
+    std::deque< uint32_t >                             m_decodeRequests;
+    std::vector< std::pair< uint32_t, DecodedImage > > m_decodedQueue;
+    std::vector< uint32_t >                            m_failedQueue;
+    bool                                               m_exit = false;
+};
+
+} // namespace vkbase
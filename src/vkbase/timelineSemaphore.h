@@ -0,0 +1,121 @@
+#pragma once
+
+/// \file vkbase/timelineSemaphore.h
+///
+/// Timeline semaphores, through VK_KHR_timeline_semaphore, for tracking GPU progress with a single counter.
+
+namespace vkbase
+{
+/// Check if \p i_physicalDevice supports the timelineSemaphore feature.  Requires the
+/// VK_KHR_get_physical_device_properties2 instance extension to have been enabled on \p i_instance.
+inline bool IsTimelineSemaphoreSupported( VkInstance i_instance, VkPhysicalDevice i_physicalDevice )
+{
+    PFN_vkGetPhysicalDeviceFeatures2KHR getPhysicalDeviceFeatures2 =
+        reinterpret_cast< PFN_vkGetPhysicalDeviceFeatures2KHR >(
+            vkGetInstanceProcAddr( i_instance, "vkGetPhysicalDeviceFeatures2KHR" ) );
+    if ( getPhysicalDeviceFeatures2 == nullptr )
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+    VkPhysicalDeviceFeatures2KHR features = {};
+    features.sType                        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features.pNext                        = &timelineFeatures;
+    getPhysicalDeviceFeatures2( i_physicalDevice, &features );
+
+    return timelineFeatures.timelineSemaphore == VK_TRUE;
+}
+
+/// \class TimelineSemaphore
+///
+/// A semaphore holding a monotonically increasing 64-bit value, signaled and waited on by queue submissions
+/// with specific values.  The host can query the current value without blocking, or wait for a value to be
+/// reached.
+///
+/// The device must have been created with VK_KHR_timeline_semaphore and the timelineSemaphore feature enabled.
+class TimelineSemaphore
+{
+public:
+    /// Create the semaphore, holding \p i_initialValue.
+    void Init( VkDevice i_device, uint64_t i_initialValue = 0 )
+    {
+        m_device = i_device;
+        m_waitSemaphores =
+            reinterpret_cast< PFN_vkWaitSemaphoresKHR >( vkGetDeviceProcAddr( i_device, "vkWaitSemaphoresKHR" ) );
+        m_getSemaphoreCounterValue = reinterpret_cast< PFN_vkGetSemaphoreCounterValueKHR >(
+            vkGetDeviceProcAddr( i_device, "vkGetSemaphoreCounterValueKHR" ) );
+        if ( m_waitSemaphores == nullptr || m_getSemaphoreCounterValue == nullptr )
+        {
+            throw std::runtime_error( "Failed to load timeline semaphore functions." );
+        }
+
+        VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+        typeInfo.sType                        = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+        typeInfo.semaphoreType                = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+        typeInfo.initialValue                 = i_initialValue;
+
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext                 = &typeInfo;
+        if ( vkCreateSemaphore( i_device, &semaphoreInfo, nullptr, &m_semaphore ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to create timeline semaphore." );
+        }
+    }
+
+    /// Destroy the semaphore.  No submission may be using it.
+    void Teardown()
+    {
+        vkDestroySemaphore( m_device, m_semaphore, nullptr );
+        m_semaphore = VK_NULL_HANDLE;
+    }
+
+    /// Is the semaphore created?
+    bool IsValid() const
+    {
+        return m_semaphore != VK_NULL_HANDLE;
+    }
+
+    /// The semaphore, for submissions waiting on or signaling it.
+    VkSemaphore Get() const
+    {
+        return m_semaphore;
+    }
+
+    /// The current value of the semaphore, without blocking.
+    uint64_t GetCompletedValue() const
+    {
+        uint64_t value = 0;
+        if ( m_getSemaphoreCounterValue( m_device, m_semaphore, &value ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to query timeline semaphore value." );
+        }
+
+        return value;
+    }
+
+    /// Block until the value of the semaphore is at least \p i_value.
+    void Wait( uint64_t i_value ) const
+    {
+        VkSemaphoreWaitInfoKHR waitInfo = {};
+        waitInfo.sType                  = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+        waitInfo.semaphoreCount         = 1;
+        waitInfo.pSemaphores            = &m_semaphore;
+        waitInfo.pValues                = &i_value;
+        if ( m_waitSemaphores( m_device, &waitInfo, UINT64_MAX ) != VK_SUCCESS )
+        {
+            throw std::runtime_error( "Failed to wait on timeline semaphore." );
+        }
+    }
+
+private:
+    VkDevice                          m_device                   = VK_NULL_HANDLE;
+    VkSemaphore                       m_semaphore                = VK_NULL_HANDLE;
+    PFN_vkWaitSemaphoresKHR           m_waitSemaphores           = nullptr;
+    PFN_vkGetSemaphoreCounterValueKHR m_getSemaphoreCounterValue = nullptr;
+};
+
+} // namespace vkbase